@@ -0,0 +1,375 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/sync_env.h>
+
+#include <ros/ros.h>
+#include <ros/package.h>
+#include <sensor_msgs/Image.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using mujoco_ros::Clock;
+using mujoco_ros::Seconds;
+
+struct BenchConfig
+{
+	std::string name;
+	// path to an MJCF file or 'generated' for a scene of free bodies
+	std::string model;
+	int bodies       = 100;
+	int cameras      = 0;
+	int steps        = 10000;
+	int warmup_steps = 1000;
+	XmlRpc::XmlRpcValue plugins;
+};
+
+struct BenchResult
+{
+	std::string name;
+	bool valid         = false;
+	int steps          = 0;
+	double wall_time   = 0;
+	double steps_per_s = 0;
+	double rtf         = 0;
+	double p50         = 0;
+	double p90         = 0;
+	double p99         = 0;
+	double max         = 0;
+};
+
+std::string generateScene(int bodies, int cameras)
+{
+	std::ostringstream xml;
+	xml << "<mujoco model=\"bench_" << bodies << "_bodies\">\n"
+	    << "  <option timestep=\"0.002\"/>\n"
+	    << "  <worldbody>\n"
+	    << "    <light pos=\"0 0 10\"/>\n"
+	    << "    <geom name=\"floor\" type=\"plane\" size=\"20 20 0.1\"/>\n";
+	const int per_row = std::max(1, static_cast<int>(std::ceil(std::sqrt(bodies))));
+	for (int i = 0; i < bodies; ++i) {
+		const double x = 0.3 * (i % per_row) - 0.15 * per_row;
+		const double y = 0.3 * (i / per_row) - 0.15 * per_row;
+		// alternate shapes to exercise different collision pairs
+		const char *shape = i % 3 == 0 ? "sphere\" size=\"0.1" : (i % 3 == 1 ? "box\" size=\"0.08 0.08 0.08" :
+		                                                                      "capsule\" size=\"0.06 0.08");
+		xml << "    <body name=\"body_" << i << "\" pos=\"" << x << " " << y << " " << 0.2 + 0.05 * (i % 7) << "\">\n"
+		    << "      <freejoint/>\n"
+		    << "      <geom type=\"" << shape << "\"/>\n"
+		    << "    </body>\n";
+	}
+	for (int i = 0; i < cameras; ++i) {
+		xml << "    <camera name=\"bench_cam_" << i << "\" pos=\"0 " << -5 - i << " 3\" xyaxes=\"1 0 0 0 0.5 1\"/>\n";
+	}
+	xml << "  </worldbody>\n"
+	    << "</mujoco>\n";
+	return xml.str();
+}
+
+/**
+ * @brief Write a generated scene to a temporary file, generated scenes easily exceed the size of the model queue.
+ * @return path of the written file, empty on failure.
+ */
+std::string writeScene(const std::string &xml)
+{
+	namespace fs = boost::filesystem;
+	boost::system::error_code ec;
+	const fs::path dir = fs::temp_directory_path(ec);
+	if (ec) {
+		return std::string();
+	}
+	const fs::path path = dir / fs::unique_path("mujoco_ros_bench_%%%%-%%%%.xml");
+	std::ofstream file(path.string());
+	file << xml;
+	return file ? path.string() : std::string();
+}
+
+double percentile(const std::vector<double> &sorted, double quantile)
+{
+	if (sorted.empty()) {
+		return 0;
+	}
+	const auto index = static_cast<size_t>(std::ceil(quantile * static_cast<double>(sorted.size()))) - 1;
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+BenchResult runBenchmark(ros::NodeHandle &nh, const BenchConfig &config)
+{
+	BenchResult result;
+	result.name = config.name;
+
+	if (config.plugins.valid()) {
+		nh.setParam(mujoco_ros::plugin_utils::MUJOCO_PLUGIN_PARAM_NAME, config.plugins);
+	} else {
+		nh.deleteParam(mujoco_ros::plugin_utils::MUJOCO_PLUGIN_PARAM_NAME);
+	}
+	nh.setParam("render_offscreen", config.cameras > 0);
+	nh.setParam("no_x", config.cameras == 0);
+
+	std::string model = config.model;
+	if (model == "generated") {
+		model = writeScene(generateScene(config.bodies, config.cameras));
+		if (model.empty()) {
+			ROS_ERROR_STREAM("[" << config.name << "] Failed to write generated scene");
+			return result;
+		}
+	}
+
+	mujoco_ros::SyncEnv env;
+	const bool loaded = env.load(model, 60.);
+	if (model != config.model) {
+		std::remove(model.c_str());
+	}
+	if (!loaded) {
+		ROS_ERROR_STREAM("[" << config.name << "] Failed to load model '" << config.model << "'");
+		env.shutdown();
+		return result;
+	}
+
+	// cameras only render with subscribers
+	std::vector<ros::Subscriber> camera_subs;
+	for (const auto &cam : env.cameraNames()) {
+		camera_subs.emplace_back(nh.subscribe<sensor_msgs::Image>(
+		    env.getNamespace() + "/cameras/" + cam + "/rgb/image_raw", 1, [](const sensor_msgs::ImageConstPtr &) {}));
+	}
+	if (!camera_subs.empty()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	}
+
+	std::vector<double> latencies;
+	env.step(config.warmup_steps);
+
+	const auto start      = Clock::now();
+	const double sim_time = env.step(config.steps, &latencies);
+	result.wall_time      = Seconds(Clock::now() - start).count();
+
+	std::sort(latencies.begin(), latencies.end());
+	result.valid       = true;
+	result.steps       = config.steps;
+	result.steps_per_s = result.wall_time > 0 ? config.steps / result.wall_time : 0;
+	result.rtf         = result.wall_time > 0 ? sim_time / result.wall_time : 0;
+	result.p50         = percentile(latencies, 0.5);
+	result.p90         = percentile(latencies, 0.9);
+	result.p99         = percentile(latencies, 0.99);
+	result.max         = latencies.empty() ? 0 : latencies.back();
+
+	camera_subs.clear();
+	env.shutdown();
+	return result;
+}
+
+BenchConfig makeConfig(const std::string &name, const std::string &model, int steps)
+{
+	BenchConfig config;
+	config.name  = name;
+	config.model = model;
+	config.steps = steps;
+	return config;
+}
+
+/**
+ * @brief Same configurations as config/bench_suite.yaml. Configurations of plugin packages that are not installed are
+ * skipped.
+ */
+std::vector<BenchConfig> defaultSuite()
+{
+	const std::string test_dir = ros::package::getPath("mujoco_ros") + "/test/";
+	std::vector<BenchConfig> suite;
+	suite.emplace_back(makeConfig("pendulum", test_dir + "pendulum_world.xml", 20000));
+	suite.emplace_back(makeConfig("equality", test_dir + "equality_world.xml", 20000));
+	suite.emplace_back(makeConfig("generated_100", "generated", 5000));
+	suite.back().bodies = 100;
+	suite.emplace_back(makeConfig("generated_500", "generated", 2000));
+	suite.back().bodies = 500;
+
+	const std::string sensors_dir = ros::package::getPath("mujoco_ros_sensors");
+	if (!sensors_dir.empty()) {
+		suite.emplace_back(makeConfig("sensors", sensors_dir + "/test/sensors_world.xml", 20000));
+		suite.back().plugins[0]["type"] = "mujoco_ros_sensors/MujocoRosSensorsPlugin";
+	} else {
+		ROS_WARN("mujoco_ros_sensors not found, skipping the sensors benchmark");
+	}
+
+	const std::string laser_dir = ros::package::getPath("mujoco_ros_laser");
+	if (!laser_dir.empty()) {
+		suite.emplace_back(makeConfig("laser", laser_dir + "/assets/laser_world.xml", 5000));
+		auto &plugin                 = suite.back().plugins[0];
+		plugin["type"]               = "mujoco_ros_laser/LaserPlugin";
+		auto &sensor                 = plugin["sensors"][0];
+		sensor["site_attached"]      = "laser_site";
+		sensor["frame_id"]           = "scan";
+		sensor["update_rate"]        = 100.;
+		sensor["min_range"]          = 0.1;
+		sensor["max_range"]          = 30.;
+		sensor["range_resolution"]   = 0.01;
+		sensor["angular_resolution"] = 0.02;
+		sensor["min_angle"]          = -1.57;
+		sensor["max_angle"]          = 1.57;
+	} else {
+		ROS_WARN("mujoco_ros_laser not found, skipping the laser benchmark");
+	}
+
+	if (!ros::package::getPath("mujoco_ros_control").empty()) {
+		// The plugin waits for its robot description, bench.launch sets the same one
+		if (!ros::param::has("bench_robot_description")) {
+			std::ifstream urdf(ros::package::getPath("mujoco_ros") + "/assets/bench_pendulum.urdf");
+			std::stringstream content;
+			content << urdf.rdbuf();
+			ros::param::set("bench_robot_description", content.str());
+		}
+		suite.emplace_back(makeConfig("ros_control", test_dir + "pendulum_world.xml", 20000));
+		auto &plugin                  = suite.back().plugins[0];
+		plugin["type"]                = "mujoco_ros_control/MujocoRosControlPlugin";
+		auto &hardware                = plugin["hardware"];
+		hardware["type"]              = "mujoco_ros_control/DefaultRobotHWSim";
+		hardware["control_period"]    = 0.001;
+		hardware["robot_description"] = "bench_robot_description";
+	} else {
+		ROS_WARN("mujoco_ros_control not found, skipping the ros_control benchmark");
+	}
+
+	suite.emplace_back(makeConfig("cameras", "generated", 1000));
+	suite.back().bodies       = 100;
+	suite.back().cameras      = 2;
+	suite.back().warmup_steps = 100;
+	return suite;
+}
+
+std::vector<BenchConfig> parseSuite(XmlRpc::XmlRpcValue &rpc)
+{
+	std::vector<BenchConfig> suite;
+	if (rpc.getType() != XmlRpc::XmlRpcValue::TypeArray) {
+		ROS_ERROR("Benchmark configurations should be a list");
+		return suite;
+	}
+	const auto get_int = [](XmlRpc::XmlRpcValue &entry, const char *key, int &value) {
+		if (entry.hasMember(key) && entry[key].getType() == XmlRpc::XmlRpcValue::TypeInt) {
+			value = static_cast<int>(entry[key]);
+		}
+	};
+	for (int i = 0; i < rpc.size(); ++i) {
+		auto &entry = rpc[i];
+		if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct || !entry.hasMember("model")) {
+			ROS_ERROR_STREAM("Benchmark configuration " << i << " has no model, skipping");
+			continue;
+		}
+		BenchConfig config;
+		config.model = static_cast<std::string>(entry["model"]);
+		config.name  = entry.hasMember("name") ? static_cast<std::string>(entry["name"]) : config.model;
+		get_int(entry, "bodies", config.bodies);
+		get_int(entry, "cameras", config.cameras);
+		get_int(entry, "steps", config.steps);
+		get_int(entry, "warmup_steps", config.warmup_steps);
+		if (entry.hasMember("plugins")) {
+			config.plugins = entry["plugins"];
+		}
+		suite.emplace_back(config);
+	}
+	return suite;
+}
+
+void writeJson(const std::string &path, const std::vector<BenchResult> &results)
+{
+	std::ofstream out(path, std::ios::trunc);
+	out << "{\n  \"mujoco_version\": \"" << mj_versionString() << "\",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto &r = results[i];
+		out << "    {\"name\": \"" << r.name << "\", \"valid\": " << (r.valid ? "true" : "false")
+		    << ", \"steps\": " << r.steps << ", \"wall_time\": " << r.wall_time << ", \"steps_per_s\": " << r.steps_per_s
+		    << ", \"rtf\": " << r.rtf << ", \"p50\": " << r.p50 << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+		    << ", \"max\": " << r.max << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	ros::init(argc, argv, "mujoco_ros_bench");
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+	ros::NodeHandle nh("~");
+
+	std::vector<BenchConfig> suite;
+	XmlRpc::XmlRpcValue suite_rpc;
+	if (nh.getParam("configurations", suite_rpc)) {
+		suite = parseSuite(suite_rpc);
+	} else {
+		ROS_INFO("No benchmark configurations provided, running the default suite");
+		suite = defaultSuite();
+	}
+
+	nh.setParam("unpause", false);
+	std::vector<BenchResult> results;
+	for (const auto &config : suite) {
+		ROS_INFO_STREAM("Running benchmark '" << config.name << "' (" << config.steps << " steps)");
+		results.emplace_back(runBenchmark(nh, config));
+	}
+
+	std::printf("\n%-24s %12s %10s %10s %10s %10s %10s\n", "benchmark", "steps/s", "RTF", "p50 [us]", "p90 [us]",
+	            "p99 [us]", "max [us]");
+	for (const auto &r : results) {
+		if (!r.valid) {
+			std::printf("%-24s %12s\n", r.name.c_str(), "failed");
+			continue;
+		}
+		std::printf("%-24s %12.0f %10.2f %10.1f %10.1f %10.1f %10.1f\n", r.name.c_str(), r.steps_per_s, r.rtf,
+		            r.p50 * 1e6, r.p90 * 1e6, r.p99 * 1e6, r.max * 1e6);
+	}
+
+	std::string output;
+	if (nh.getParam("output", output) && !output.empty()) {
+		writeJson(output, results);
+		ROS_INFO_STREAM("Wrote results to " << output);
+	}
+
+	spinner.stop();
+	ros::shutdown();
+	const bool all_valid = std::all_of(results.begin(), results.end(), [](const BenchResult &r) { return r.valid; });
+	return all_valid ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+// Measures the round trip of the shared memory transport in lockstep mode: time from sending an action until the
+// observation of the resulting step arrives. Requires a simulation running with shm/lockstep enabled.
+
+#include <mujoco_ros/latency_histogram.h>
+#include <mujoco_ros/shm_transport.h>
+
+#include <ros/ros.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock   = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+bool attach(mujoco_ros::shm::Client &client, const std::string &name, double timeout)
+{
+	const auto start = Clock::now();
+	std::string error;
+	while (!client.attach(name, error)) {
+		if (!ros::ok() || Seconds(Clock::now() - start).count() > timeout) {
+			ROS_ERROR_STREAM("Could not attach to shared memory segment: " << error);
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	ros::init(argc, argv, "mujoco_ros_shm_latency");
+	ros::NodeHandle nh("~");
+
+	std::string name;
+	int iterations;
+	int warmup;
+	double attach_timeout;
+	nh.param<std::string>("name", name, "mujoco_ros");
+	nh.param<int>("iterations", iterations, 10000);
+	nh.param<int>("warmup", warmup, 1000);
+	nh.param<double>("attach_timeout", attach_timeout, 10.0);
+
+	mujoco_ros::shm::Client client;
+	if (!attach(client, name, attach_timeout)) {
+		return 1;
+	}
+	if (!client.isLockstep()) {
+		ROS_ERROR("The simulation does not run in lockstep mode (shm/lockstep), round trips cannot be matched");
+		return 1;
+	}
+	ROS_INFO_STREAM("Attached to " << name << " (nq " << client.nq() << ", nv " << client.nv() << ", nu "
+	                               << client.nu() << ", nsensordata " << client.nsensordata() << ")");
+
+	// Discard the initial observation
+	mujoco_ros::shm::Observation obs;
+	client.waitForObservation(Seconds(1.0));
+	client.readObservation(obs, true);
+
+	std::vector<double> ctrl(client.nu(), 0.0);
+	mujoco_ros::LatencyHistogram latencies;
+	int timeouts     = 0;
+	const auto start = Clock::now();
+	for (int i = 0; i < warmup + iterations && ros::ok() && !client.isClosed(); ++i) {
+		if (i == warmup) {
+			latencies.reset();
+		}
+		const auto sent = Clock::now();
+		if (!client.sendAction(ctrl.data())) {
+			ROS_ERROR("Action ring is full, is the simulation paused?");
+			return 1;
+		}
+		if (!client.waitForObservation(Seconds(1.0)) || !client.readObservation(obs)) {
+			++timeouts;
+			continue;
+		}
+		latencies.record(Seconds(Clock::now() - sent).count());
+	}
+	const double elapsed = Seconds(Clock::now() - start).count();
+
+	std::printf("\n%12s %12s %10s %10s %10s %10s %10s\n", "round trips", "steps/s", "p50 [us]", "p90 [us]", "p99 [us]",
+	            "p99.9 [us]", "max [us]");
+	std::printf("%12lu %12.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n", static_cast<unsigned long>(latencies.count()),
+	            (warmup + iterations) / elapsed, latencies.percentile(0.5) * 1e6, latencies.percentile(0.9) * 1e6,
+	            latencies.percentile(0.99) * 1e6, latencies.percentile(0.999) * 1e6, latencies.max() * 1e6);
+	if (timeouts > 0) {
+		ROS_WARN_STREAM(timeouts << " observations did not arrive within 1 s");
+	}
+	return 0;
+}
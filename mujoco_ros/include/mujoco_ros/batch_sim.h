@@ -0,0 +1,149 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mujoco_ros {
+
+/**
+ * @brief A batch of identical environments sharing one compiled mjModel, for vectorized stepping.
+ *
+ * Holds one mjData per environment, all created from the same model and reset to the same initial state. Actions and
+ * observations of all environments are kept in contiguous row-major buffers (one row per environment), so they can be
+ * exchanged without per-environment copies. Environments are stepped in parallel on a MuJoCo threadpool, one task per
+ * environment.
+ *
+ * Plugins only act on the main mjData of the simulation, not on the environments of the batch. Changes of the model,
+ * e.g. by domain randomization, affect all environments.
+ */
+class BatchSim
+{
+public:
+	BatchSim() = default;
+	~BatchSim();
+
+	BatchSim(const BatchSim &)            = delete;
+	BatchSim &operator=(const BatchSim &) = delete;
+
+	/**
+	 * @brief Set the number of environments created on the next init. 0 disables the batch.
+	 */
+	void configure(int num_envs);
+
+	bool isEnabled() const { return num_envs_ > 0; }
+
+	/**
+	 * @brief Create the environments for a newly loaded model and reset them to the state of \c reference.
+	 * Frees the environments of the previous model.
+	 */
+	void init(const mjModel *m, const mjData *reference);
+
+	/**
+	 * @brief Free all environments, e.g. before the model they were created from is freed.
+	 */
+	void clear();
+
+	std::size_t size() const { return data_.size(); }
+	std::size_t actionSize() const { return model_ != nullptr ? static_cast<std::size_t>(model_->nu) : 0; }
+	std::size_t observationSize() const;
+
+	/**
+	 * @brief Reset environments to the initial state and update their observations.
+	 *
+	 * @param[in] ids environments to reset, all if empty.
+	 * @param[in] pool threadpool to reset on, or nullptr to run on the calling thread.
+	 * @return false if an id is out of range, nothing is reset in that case.
+	 */
+	bool reset(const std::vector<uint32_t> &ids, mjThreadPool *pool);
+
+	/**
+	 * @brief Apply actions, step all environments and update their observations.
+	 *
+	 * @param[in] actions size() x actionSize() controls, row-major. Empty to keep the current controls.
+	 * @param[in] num_steps steps per environment.
+	 * @param[in] pool threadpool to step on, or nullptr to run on the calling thread.
+	 * @param[out] status_message reason if the actions are rejected.
+	 * @return false if the actions have the wrong size or contain non-finite values.
+	 */
+	bool step(const std::vector<double> &actions, int num_steps, mjThreadPool *pool, std::string &status_message);
+
+	// size() x observationSize() observations, row-major: [qpos, qvel, sensordata] per environment
+	const std::vector<mjtNum> &observations() const { return observations_; }
+	// simulation time per environment
+	const std::vector<mjtNum> &times() const { return times_; }
+	const std::vector<mjData *> &data() const { return data_; }
+
+private:
+	struct Task
+	{
+		mjTask task;
+		BatchSim *batch;
+		std::size_t index;
+	};
+
+	static void *resetTask(void *args);
+	static void *stepTask(void *args);
+
+	/**
+	 * @brief Run func for the given environments, in parallel if a threadpool is given.
+	 */
+	void runTasks(const std::vector<std::size_t> &indices, void *(*func)(void *), mjThreadPool *pool);
+
+	void resetEnv(std::size_t i);
+	void stepEnv(std::size_t i);
+	void observe(std::size_t i);
+
+	static constexpr unsigned int kStateSig = mjSTATE_INTEGRATION;
+
+	int num_envs_          = 0;
+	int num_steps_         = 1;
+	const mjModel *model_  = nullptr;
+	std::vector<mjData *> data_;
+	std::vector<mjtNum> initial_state_;
+	std::vector<mjtNum> actions_;
+	std::vector<mjtNum> observations_;
+	std::vector<mjtNum> times_;
+	std::vector<Task> tasks_;
+};
+
+} // namespace mujoco_ros
@@ -0,0 +1,138 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <cstdint>
+#include <string>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Ring of simulation state checkpoints stored in a memory-mapped file.
+ *
+ * The file starts with a header identifying the format version, the number of slots and the layout of the stored
+ * state, followed by a fixed number of slots. Each slot holds a sequence number, the simulation time, a checksum and
+ * a state blob as returned by mj_getState. A slot is only marked valid by updating its sequence number after the
+ * state has been written, so a crash during a write leaves the previous checkpoints intact.
+ */
+class CheckpointFile
+{
+public:
+	static constexpr uint32_t kVersion = 1;
+
+	CheckpointFile() = default;
+	~CheckpointFile();
+
+	CheckpointFile(const CheckpointFile &)            = delete;
+	CheckpointFile &operator=(const CheckpointFile &) = delete;
+
+	/**
+	 * @brief Open (or create) a checkpoint file.
+	 * Existing checkpoints are kept if the file was created with the same layout. Files that are empty or not a
+	 * checkpoint file are (re)initialized, checkpoint files with a different layout are left untouched and opening
+	 * fails.
+	 *
+	 * @param[in] path path to the checkpoint file.
+	 * @param[in] state_size number of mjtNum in each state blob.
+	 * @param[in] num_slots number of checkpoints kept in the ring.
+	 * @param[in] signature value identifying the model layout the states belong to.
+	 * @return true if the file could be opened and mapped.
+	 */
+	bool open(const std::string &path, uint64_t state_size, uint32_t num_slots, uint64_t signature);
+
+	void close();
+
+	bool isOpen() const { return mapping_ != nullptr; }
+
+	/**
+	 * @brief Get the state buffer of the slot that will be written next.
+	 * Write the state directly into this buffer (e.g. with mj_getState) and call commit afterwards.
+	 */
+	mjtNum *nextSlotData();
+
+	/**
+	 * @brief Marks the next slot as the most recent checkpoint and asynchronously flushes it to disk.
+	 *
+	 * @param[in] time simulation time of the state.
+	 */
+	void commit(mjtNum time);
+
+	/**
+	 * @brief Copy the most recent valid checkpoint into state.
+	 *
+	 * @param[out] state buffer of at least state_size mjtNum.
+	 * @param[out] time simulation time of the checkpoint.
+	 * @return true if a valid checkpoint was found.
+	 */
+	bool readLatest(mjtNum *state, mjtNum &time) const;
+
+	/**
+	 * @brief Compute a signature of the state layout and the content (as saved by mj_saveModel) of a model.
+	 * Checkpoints are only restored into models with the same signature.
+	 */
+	static uint64_t modelSignature(const mjModel *m, unsigned int state_sig);
+
+	/**
+	 * @brief Derive the path of the checkpoint file for a model signature from a base path by inserting the signature
+	 * in hex before the extension (e.g. `ckpt.bin` -> `ckpt.0123456789abcdef.bin`). This keeps the checkpoints of
+	 * different models in separate files.
+	 */
+	static std::string signaturePath(const std::string &path, uint64_t signature);
+
+private:
+	struct Header;
+	struct SlotHeader;
+
+	Header *header() const;
+	SlotHeader *slot(uint32_t index) const;
+	mjtNum *slotData(uint32_t index) const;
+
+	int fd_           = -1;
+	void *mapping_    = nullptr;
+	size_t file_size_ = 0;
+	size_t slot_size_ = 0;
+
+	uint64_t state_size_    = 0;
+	uint32_t num_slots_     = 0;
+	uint32_t next_slot_     = 0;
+	uint64_t next_sequence_ = 1;
+};
+
+} // namespace mujoco_ros
@@ -0,0 +1,147 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+#include <xmlrpcpp/XmlRpcValue.h>
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Samples model parameters in place on every reset.
+ *
+ * Configured with a list of randomizations, each targeting one model field (e.g. geom_friction, body_mass,
+ * opt_gravity) for a set of named elements. Values are sampled relative to the nominal values of the loaded model, so
+ * randomizations do not accumulate over episodes. Samples are clamped to the valid range of their field (e.g. masses
+ * stay positive, friction and damping non-negative). The sampled values of each episode are kept for inspection and can
+ * optionally be appended to a CSV log file.
+ */
+class DomainRandomizer
+{
+public:
+	struct Sample
+	{
+		std::string field;
+		std::string element;
+		int component;
+		mjtNum value;
+	};
+
+	/**
+	 * @brief Parse the randomization config.
+	 * Expects a struct with a `parameters` array and optional `seed` and `log_path` members. Invalid entries are
+	 * skipped with an error.
+	 *
+	 * @return true if at least one valid randomization was configured.
+	 */
+	bool init(XmlRpc::XmlRpcValue config);
+
+	/**
+	 * @brief Resolve element names and store nominal values of a newly loaded model.
+	 */
+	void load(mjModel *m);
+
+	/**
+	 * @brief Sample new values for all configured fields and write them into the model.
+	 *
+	 * @return true if a changed field requires recomputing model constants (mj_setConst).
+	 */
+	bool apply(mjModel *m);
+
+	bool isEnabled() const { return !randomizations_.empty(); }
+
+	void seed(uint64_t seed) { rng_.seed(seed); }
+
+	uint64_t episode() const { return episode_; }
+
+	// Values sampled in the last call to apply
+	const std::vector<Sample> &lastSamples() const { return samples_; }
+
+private:
+	enum class Distribution
+	{
+		UNIFORM,
+		LOGUNIFORM,
+		NORMAL
+	};
+
+	enum class Mode
+	{
+		ABSOLUTE,
+		SCALE,
+		OFFSET
+	};
+
+	struct Randomization
+	{
+		std::string field;
+		std::vector<std::string> names;
+		int component             = -1;
+		Distribution distribution = Distribution::UNIFORM;
+		Mode mode                 = Mode::ABSOLUTE;
+		double a                  = 0;
+		double b                  = 0;
+
+		// Resolved for the current model
+		std::vector<size_t> offsets;
+		std::vector<std::string> elements;
+		std::vector<int> components;
+		std::vector<mjtNum> nominal;
+	};
+
+	double sample(const Randomization &r);
+
+	std::vector<Randomization> randomizations_;
+	std::vector<Sample> samples_;
+	// Nominal inertia of bodies with randomized mass, scaled along with the mass
+	std::vector<mjtNum> nominal_inertia_;
+	std::vector<mjtNum> nominal_mass_;
+
+	std::mt19937_64 rng_;
+	uint64_t episode_ = 0;
+	std::string log_path_;
+	std::ofstream log_;
+};
+
+} // namespace mujoco_ros
@@ -0,0 +1,129 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco_ros/common_types.h>
+#include <mujoco_ros/mujoco_env.h>
+#include <mujoco_ros/thread_config.h>
+
+#include <ros/node_handle.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Runs several independent environments in one process, stepped by a shared pool of workers.
+ *
+ * Environment i reads its parameters from and advertises its interfaces in the private namespace `env_<i>`. Private
+ * parameters of the pool node are copied into every environment namespace unless the environment overrides them, so
+ * common settings only have to be given once. Only the first environment publishes /clock.
+ *
+ * Instead of a physics thread per environment, every iteration dispatches one physics tick per environment to the
+ * workers and sleeps until the earliest environment is due again. Event loops (loading, resets) still run per
+ * environment.
+ */
+class EnvPool
+{
+public:
+	/**
+	 * @param[in] num_envs number of environments to create.
+	 * @param[in] num_workers number of workers stepping the environments. With less than 2 workers the environments
+	 * are stepped on the calling thread of run().
+	 * @param[in] admin_hash hash to verify critical operations in evaluation mode, passed to every environment.
+	 */
+	EnvPool(int num_envs, int num_workers, const std::string &admin_hash = std::string());
+	~EnvPool();
+
+	EnvPool(const EnvPool &)            = delete;
+	EnvPool &operator=(const EnvPool &) = delete;
+
+	/**
+	 * @brief Queue loading the given model in all environments and start their event loops.
+	 *
+	 * @param[in] filename path to the model to load. If empty, the environments start without a model.
+	 */
+	void start(const std::string &filename);
+
+	/**
+	 * @brief Step all environments until every one of them is done or requestExit is called. Blocking.
+	 * Environments are cleaned up when the pool is destroyed.
+	 */
+	void run();
+
+	/**
+	 * @brief Ask run() and all environments to exit. Can be called from any thread.
+	 */
+	void requestExit();
+
+	std::size_t size() const { return envs_.size(); }
+	MujocoEnv *env(std::size_t i) { return envs_[i].get(); }
+
+private:
+	/**
+	 * @brief Copies the private parameters of the pool node into the namespace of an environment.
+	 */
+	void forwardParams(int index, const std::string &ns) const;
+
+	static void *tickTask(void *args);
+
+	struct Tick
+	{
+		mjTask task;
+		MujocoEnv *env;
+		int max_steps;
+		Clock::time_point due;
+	};
+
+	ros::NodeHandle nh_;
+	std::vector<std::unique_ptr<MujocoEnv>> envs_;
+	std::vector<Tick> ticks_;
+
+	ThreadConfig thread_config_;
+	mjThreadPool *workers_ = nullptr;
+	int num_workers_       = 0;
+	// Upper bound of steps per environment and tick, keeps unpaced environments from starving the others
+	int steps_per_tick_ = 10;
+
+	std::atomic_bool exit_request_ = { false };
+};
+
+} // namespace mujoco_ros
@@ -0,0 +1,147 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Log-linear latency histogram (HDR-style) with ~3% relative resolution between 1 ns and ~18 minutes.
+ * Recording is lock-free and meant for a single writer (e.g. the thread running a plugin callback), while
+ * percentiles can be read and the histogram reset concurrently from other threads.
+ */
+class LatencyHistogram
+{
+public:
+	// 2^kSubBucketBits sub-buckets per power of two, values above 2^kMaxBits ns are clamped
+	static constexpr int kSubBucketBits   = 5;
+	static constexpr int kMaxBits         = 40;
+	static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+	static constexpr std::size_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+	/**
+	 * @brief Record a single duration.
+	 * @param[in] seconds duration in seconds.
+	 */
+	void record(double seconds)
+	{
+		uint64_t ns = seconds > 0 ? static_cast<uint64_t>(seconds * 1e9) : 0;
+		ns          = std::min(ns, (uint64_t(1) << kMaxBits) - 1);
+		buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		if (ns > max_ns_.load(std::memory_order_relaxed)) {
+			max_ns_.store(ns, std::memory_order_relaxed);
+		}
+	}
+
+	void reset()
+	{
+		for (auto &bucket : buckets_) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		count_.store(0, std::memory_order_relaxed);
+		max_ns_.store(0, std::memory_order_relaxed);
+	}
+
+	uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Largest recorded duration in seconds.
+	 */
+	double max() const { return static_cast<double>(max_ns_.load(std::memory_order_relaxed)) * 1e-9; }
+
+	/**
+	 * @brief Upper bound of the bucket containing the given quantile, in seconds.
+	 * @param[in] quantile in range [0, 1], e.g. 0.99 for the 99th percentile.
+	 * @return the duration or 0 if nothing has been recorded.
+	 */
+	double percentile(double quantile) const
+	{
+		// sum the buckets instead of using count_, which may be ahead of the buckets during concurrent recording
+		uint64_t total = 0;
+		for (const auto &bucket : buckets_) {
+			total += bucket.load(std::memory_order_relaxed);
+		}
+		if (total == 0) {
+			return 0.0;
+		}
+
+		const auto target =
+		    std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * total)));
+		uint64_t cumulative = 0;
+		for (std::size_t i = 0; i < kBuckets; ++i) {
+			cumulative += buckets_[i].load(std::memory_order_relaxed);
+			if (cumulative >= target) {
+				return static_cast<double>(std::min(bucketUpperBound(i), max_ns_.load(std::memory_order_relaxed))) * 1e-9;
+			}
+		}
+		return max();
+	}
+
+	static std::size_t bucketIndex(uint64_t ns)
+	{
+		if (ns < 2 * kSubBuckets) {
+			return static_cast<std::size_t>(ns);
+		}
+		const int msb   = 63 - __builtin_clzll(ns);
+		const int shift = msb - kSubBucketBits;
+		return static_cast<std::size_t>((shift + 1) * kSubBuckets + ((ns >> shift) - kSubBuckets));
+	}
+
+	static uint64_t bucketUpperBound(std::size_t index)
+	{
+		if (index < 2 * kSubBuckets) {
+			return index;
+		}
+		const int shift    = static_cast<int>(index / kSubBuckets) - 1;
+		const uint64_t sub = index % kSubBuckets + kSubBuckets;
+		return ((sub + 1) << shift) - 1;
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, kBuckets> buckets_ = {};
+	std::atomic<uint64_t> count_                        = { 0 };
+	std::atomic<uint64_t> max_ns_                       = { 0 };
+};
+
+} // namespace mujoco_ros
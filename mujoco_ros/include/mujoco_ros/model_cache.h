@@ -0,0 +1,110 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <utility>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Cache of compiled models keyed by the content of the MJCF source and its dependencies.
+ *
+ * Compiled models are kept in memory (least recently used entries are evicted) and, if a directory is configured,
+ * stored as .mjb files so that later processes can skip compilation as well. The key covers the MJCF text, all
+ * included files and all files referenced by `file*` attributes (meshes, textures, ...), as well as the MuJoCo version.
+ */
+class ModelCache
+{
+public:
+	ModelCache() = default;
+	~ModelCache();
+
+	ModelCache(const ModelCache &)            = delete;
+	ModelCache &operator=(const ModelCache &) = delete;
+
+	/**
+	 * @param[in] directory directory for .mjb files. Only the in-memory cache is used if empty.
+	 * @param[in] max_memory_entries number of models kept in memory.
+	 */
+	void configure(const std::string &directory, size_t max_memory_entries);
+
+	/**
+	 * @brief Compute the cache key of an MJCF file, including all files it depends on.
+	 */
+	static uint64_t keyForFile(const std::string &filename);
+
+	/**
+	 * @brief Compute the cache key of an MJCF string. Dependencies are not resolved for strings, strings for which
+	 * referencesFiles is true should not be cached.
+	 */
+	static uint64_t keyForString(const std::string &xml);
+
+	/**
+	 * @brief Whether an MJCF string references files (includes, meshes, textures, ...).
+	 */
+	static bool referencesFiles(const std::string &xml);
+
+	/**
+	 * @brief Look up a compiled model.
+	 * @return a new copy of the cached model owned by the caller, or nullptr on a cache miss.
+	 */
+	mjModel *get(uint64_t key);
+
+	/**
+	 * @brief Store a copy of a compiled model.
+	 */
+	void put(uint64_t key, const mjModel *m);
+
+	void clear();
+
+private:
+	std::string diskPath(uint64_t key) const;
+	void insertMemory(uint64_t key, mjModel *m);
+
+	std::string directory_;
+	size_t max_memory_entries_ = 2;
+	// Most recently used first
+	std::list<std::pair<uint64_t, mjModel *>> memory_;
+};
+
+} // namespace mujoco_ros
@@ -50,7 +50,9 @@
 
 #pragma once
 
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <ros/ros.h>
 
 #include <boost/thread.hpp>
@@ -58,6 +60,16 @@
 #include <mujoco_ros/common_types.h>
 #include <mujoco_ros/viewer.h>
 #include <mujoco_ros/plugin_utils.h>
+#include <mujoco_ros/batch_sim.h>
+#include <mujoco_ros/checkpoint.h>
+#include <mujoco_ros/domain_randomization.h>
+#include <mujoco_ros/model_cache.h>
+#include <mujoco_ros/name_id_cache.h>
+#include <mujoco_ros/realtime_pacer.h>
+#include <mujoco_ros/shm_transport.h>
+#include <mujoco_ros/step_profiler.h>
+#include <mujoco_ros/thread_config.h>
+#include <mujoco_ros/tracing.h>
 
 #include <mujoco_ros_msgs/StepAction.h>
 #include <mujoco_ros_msgs/StepGoal.h>
@@ -68,7 +80,12 @@
 #include <std_srvs/Empty.h>
 #include <mujoco_ros_msgs/SetBodyState.h>
 #include <mujoco_ros_msgs/GetBodyState.h>
+#include <mujoco_ros_msgs/SetBodyStates.h>
+#include <mujoco_ros_msgs/GetBodyStates.h>
 #include <mujoco_ros_msgs/SetGeomProperties.h>
+#include <mujoco_ros_msgs/SetGeomPropertiesArray.h>
+#include <mujoco_ros_msgs/SetEqualityConstraintsCompact.h>
+#include <mujoco_ros_msgs/GetEqualityConstraintIds.h>
 #include <mujoco_ros_msgs/GetGeomProperties.h>
 #include <mujoco_ros_msgs/EqualityConstraintParameters.h>
 #include <mujoco_ros_msgs/GetEqualityConstraintParameters.h>
@@ -80,6 +97,13 @@
 #include <mujoco_ros_msgs/SetFloat.h>
 #include <mujoco_ros_msgs/PluginStats.h>
 #include <mujoco_ros_msgs/GetPluginStats.h>
+#include <mujoco_ros_msgs/DumpTrace.h>
+#include <mujoco_ros_msgs/SaveState.h>
+#include <mujoco_ros_msgs/RestoreState.h>
+#include <mujoco_ros_msgs/BatchReset.h>
+#include <mujoco_ros_msgs/BatchStep.h>
+#include <mujoco_ros_msgs/BatchObserve.h>
+#include <mujoco_ros_msgs/BodyStates.h>
 
 #include <geometry_msgs/TransformStamped.h>
 #include <tf2_ros/static_transform_broadcaster.h>
@@ -136,8 +160,12 @@ public:
 	/**
 	 * @brief Construct a new Mujoco Env object.
 	 *
+	 * Multiple environments can coexist in one process as long as they use different namespaces.
+	 *
+	 * @param[in] admin_hash hash to verify critical operations in evaluation mode.
+	 * @param[in] ns namespace to read parameters from and to advertise topics and services in.
 	 */
-	MujocoEnv(const std::string &admin_hash = std::string());
+	MujocoEnv(const std::string &admin_hash = std::string(), const std::string &ns = "~");
 	~MujocoEnv();
 
 	MujocoEnv(const MujocoEnv &) = delete;
@@ -146,8 +174,9 @@ public:
 	static constexpr int kErrorLength       = 1024;
 	static constexpr int kMaxFilenameLength = 1000;
 
-	const double syncMisalign       = 0.1; // maximum mis-alignment before re-sync (simulation seconds)
-	const double simRefreshFraction = 0.7; // fraction of refresh available for simulation
+	const double syncMisalign       = 0.1;  // maximum mis-alignment before re-sync (simulation seconds)
+	const double simRefreshFraction = 0.7;  // fraction of refresh available for simulation
+	const double maxPacingWait      = 0.01; // longest wait for a paced step before handling requests (wall seconds)
 
 	/// Noise to apply to control signal
 	mjtNum *ctrlnoise_     = nullptr;
@@ -162,7 +191,16 @@ public:
 	void connectViewer(Viewer *viewer);
 	void disconnectViewer(Viewer *viewer);
 
-	char queued_filename_[kMaxFilenameLength];
+	/**
+	 * @brief Queue a model for loading and issue a load request.
+	 *
+	 * Safe to call from any thread. A request issued while another model is still compiling supersedes it.
+	 *
+	 * @param[in] model path to an xml or mjb file, or an xml string.
+	 * @param[in] request load request to issue (2 for external requests, 3 for viewer requests).
+	 * @return false if the model does not fit into kMaxFilenameLength, in which case no request is issued.
+	 */
+	bool queueModel(const std::string &model, int request = 2);
 
 	struct
 	{
@@ -172,13 +210,18 @@ public:
 		bool use_sim_time     = true;
 
 		// Sim speed
-		int real_time_index = 8;
+		int real_time_index = 8; // closest preset in percentRealTime, used by the viewer's speed controls
 		int busywait        = 0;
+		// Desired real-time factor, non-positive values run as fast as possible
+		std::atomic<float> rt_factor = { 1.5f };
 
 		// Mode
 		bool eval_mode = false;
 		char admin_hash[64];
 
+		// Restore a snapshot of the initial state on reset instead of re-reading the initial joint states
+		bool fast_reset = false;
+
 		// Atomics for multithread access
 		std::atomic_int run                 = { 0 };
 		std::atomic_int exit_request        = { 0 };
@@ -188,6 +231,8 @@ public:
 		//  0: no request
 		//  1: replace model_ with mnew and data_ with dnew
 		//  2: load mnew and dnew from file
+		//  3: load mnew and dnew from file (requested by viewer)
+		//  4: mnew and dnew are being compiled in the background
 		std::atomic_int load_request      = { 0 };
 		std::atomic_int reset_request     = { 0 };
 		std::atomic_int speed_changed     = { 0 };
@@ -195,6 +240,9 @@ public:
 
 		// Must be set to true before loading a new model from python
 		std::atomic_int is_python_request = { 0 };
+
+		// Resume from the last on-disk checkpoint on the next load
+		std::atomic_int checkpoint_resume_request = { 0 };
 	} settings_;
 
 	// General sim information for viewers to fetch
@@ -229,6 +277,28 @@ public:
 	void startPhysicsLoop();
 	void startEventLoop();
 
+	/**
+	 * @brief Runs a single iteration of the physics loop without waiting for its deadline.
+	 *
+	 * Allows stepping the environment from an external worker instead of the dedicated physics thread (see EnvPool).
+	 * Does nothing if the physics mutex is currently held by another thread.
+	 *
+	 * @param[in] max_steps maximum number of steps to run in this iteration, 0 for no limit.
+	 * @return the time at which the next iteration is due.
+	 */
+	Clock::time_point tickPhysics(int max_steps = 0);
+
+	/**
+	 * @brief Whether physics should not be stepped anymore (exit requested or step limit reached).
+	 */
+	bool isPhysicsDone() const;
+
+	/**
+	 * @brief Cleans up after the last physics iteration. Called by the physics thread when it exits, needs to be called
+	 * explicitly if the environment was stepped with tickPhysics.
+	 */
+	void finishPhysics();
+
 	/**
 	 * @brief Get information about the current simulation state.
 	 *
@@ -239,22 +309,52 @@ public:
 	 */
 	int getOperationalStatus();
 
+	// Range of real-time factors, matches the slowest and fastest preset of percentRealTime
+	static constexpr float kMinRealTimeFactor = 0.001f;
+	static constexpr float kMaxRealTimeFactor = 20.f;
+
 	static constexpr float percentRealTime[] = {
 		-1, // unbound
 		2000, 1000, 800, 600,  500,  400, 200,  150,  100, 80,  66,   50,  40,  33,   25,   20,  16,   13,   10, 8,
 		6.6f, 5.0f, 4,   3.3f, 2.5f, 2,   1.6f, 1.3f, 1,   .8f, .66f, .5f, .4f, .33f, .25f, .2f, .16f, .13f, .1f
 	};
 
-	static MujocoEnv *instance;
-	static void proxyControlCB(const mjModel * /*m*/, mjData * /*d*/)
+	/**
+	 * @brief Index of the preset in percentRealTime closest to the given real-time factor.
+	 *
+	 * @param[in] factor real-time factor. Non-positive values map to the unbound preset.
+	 */
+	static int closestRealTimeIndex(float factor);
+
+	/**
+	 * @brief Get the environment that owns the given mjData.
+	 *
+	 * Used to route the process-wide MuJoCo callbacks to the right environment. If \c d is not owned by any
+	 * environment (e.g. a copy made by a plugin) and only a single environment exists, that one is returned.
+	 *
+	 * @return the owning environment or nullptr if it cannot be determined.
+	 */
+	static MujocoEnv *lookup(const mjData *d);
+
+	/**
+	 * @brief Route the MuJoCo callbacks of an mjData created outside the environment (e.g. a copy stepped by a plugin)
+	 * to this environment. Required for such data once more than one environment exists in the process.
+	 */
+	void registerData(const mjData *d);
+	/**
+	 * @brief Undo registerData, has to be called before \c d is deleted.
+	 */
+	void unregisterData(const mjData *d);
+
+	static void proxyControlCB(const mjModel * /*m*/, mjData *d)
 	{
-		if (MujocoEnv::instance != nullptr)
-			MujocoEnv::instance->runControlCbs();
+		if (auto *env = MujocoEnv::lookup(d))
+			env->runControlCbs();
 	}
-	static void proxyPassiveCB(const mjModel * /*m*/, mjData * /*d*/)
+	static void proxyPassiveCB(const mjModel * /*m*/, mjData *d)
 	{
-		if (MujocoEnv::instance != nullptr)
-			MujocoEnv::instance->runPassiveCbs();
+		if (auto *env = MujocoEnv::lookup(d))
+			env->runPassiveCbs();
 	}
 
 	// Proxies to MuJoCo callbacks
@@ -268,10 +368,47 @@ public:
 	void runRenderCbs(mjvScene *scene);
 	bool step(int num_steps = 1, bool blocking = true);
 
+	/**
+	 * @brief Save the current simulation state (integration state including plugin state) into a named slot.
+	 * Existing slots are overwritten. All slots are cleared when a new model is loaded.
+	 *
+	 * @param [in] slot name of the slot.
+	 * @return true if the state was saved, false if no model is loaded.
+	 */
+	bool saveState(const std::string &slot);
+
+	/**
+	 * @brief Restore the simulation state from a named slot.
+	 *
+	 * @param [in] slot name of the slot.
+	 * @return true if the state was restored, false if the slot does not exist.
+	 */
+	bool restoreState(const std::string &slot);
+
 	void UpdateModelFlags(const mjOption *opt);
 
 protected:
 	std::vector<MujocoPlugin *> cb_ready_plugins_; // objects managed by plugins_
+
+	// Control callbacks dispatched to the threadpool and callbacks that have to run serially afterwards
+	struct ControlTask
+	{
+		mjTask task;
+		MujocoPlugin *plugin;
+		const mjModel *m;
+		mjData *d;
+	};
+	bool parallel_control_cbs_ = false;
+	// Load independent plugins concurrently, respecting their `depends_on` config
+	bool parallel_plugin_load_ = false;
+	std::vector<ControlTask> parallel_control_tasks_;
+	std::vector<MujocoPlugin *> serial_control_plugins_;
+
+	/**
+	 * @brief Decides which control callbacks can run concurrently based on the write sets declared by the plugins.
+	 */
+	void partitionControlCbs();
+	static void *runControlTask(void *args);
 	XmlRpc::XmlRpcValue rpc_plugin_config_;
 	std::vector<MujocoPluginPtr> plugins_;
 
@@ -279,14 +416,18 @@ protected:
 	// of steps (-1 means no limit).
 	int num_steps_until_exit_ = -1;
 
-	// VFS for loading models from strings
-	mjVFS vfs_;
-
-	// Currently loaded model
+	// Currently loaded model, only written while holding the physics mutex
 	char filename_[kMaxFilenameLength];
+	// Model queued for the next load, empty to reload the current one
+	char queued_filename_[kMaxFilenameLength];
+	std::mutex queue_mutex_;
 	// last error message
 	char load_error_[kErrorLength];
 
+	// Serializes registerCollisionFunction and registerStaticTransform, which plugins may call concurrently while being
+	// loaded in parallel
+	std::mutex plugin_registration_mutex_;
+
 	// Store default collision functions to restore on reload
 	std::vector<CollisionFunctionDefault> defaultCollisionFunctions;
 
@@ -312,6 +453,8 @@ protected:
 
 	void publishSimTime(mjtNum time);
 	ros::Publisher clock_pub_;
+	// Only one environment per process should publish /clock
+	bool publish_clock_ = true;
 	std::unique_ptr<ros::NodeHandle> nh_;
 
 	void runLastStageCbs();
@@ -330,15 +473,37 @@ protected:
 	bool resetCB(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
 	bool setBodyStateCB(mujoco_ros_msgs::SetBodyState::Request &req, mujoco_ros_msgs::SetBodyState::Response &resp);
 	bool getBodyStateCB(mujoco_ros_msgs::GetBodyState::Request &req, mujoco_ros_msgs::GetBodyState::Response &resp);
+	bool setBodyStatesCB(mujoco_ros_msgs::SetBodyStates::Request &req, mujoco_ros_msgs::SetBodyStates::Response &resp);
+	bool getBodyStatesCB(mujoco_ros_msgs::GetBodyStates::Request &req, mujoco_ros_msgs::GetBodyStates::Response &resp);
+
+	// Body state helpers shared by the single and batch services. The caller must hold physics_thread_mutex_.
+	int resolveBodyId(const std::string &name, std::string &status_message);
+	bool setBodyState(mujoco_ros_msgs::BodyState &state, bool set_pose, bool set_twist, bool set_mass, bool reset_qpos,
+	                  bool &mass_changed, std::string &status_message);
+	bool getBodyState(const std::string &name, mujoco_ros_msgs::BodyState &state, std::string &status_message);
+	// Recompute model constants (e.g. after mass changes) while keeping the current qpos
+	void recomputeConstants();
 	bool setGravityCB(mujoco_ros_msgs::SetGravity::Request &req, mujoco_ros_msgs::SetGravity::Response &resp);
 	bool getGravityCB(mujoco_ros_msgs::GetGravity::Request &req, mujoco_ros_msgs::GetGravity::Response &resp);
 	bool setGeomPropertiesCB(mujoco_ros_msgs::SetGeomProperties::Request &req,
 	                         mujoco_ros_msgs::SetGeomProperties::Response &resp);
 	bool getGeomPropertiesCB(mujoco_ros_msgs::GetGeomProperties::Request &req,
 	                         mujoco_ros_msgs::GetGeomProperties::Response &resp);
+	bool setGeomPropertiesArrayCB(mujoco_ros_msgs::SetGeomPropertiesArray::Request &req,
+	                              mujoco_ros_msgs::SetGeomPropertiesArray::Response &resp);
+	// Applies geom changes without recomputing constants or kinematics. Mass changes scale the body inertia along with
+	// the mass. The caller must hold physics_thread_mutex_, call recomputeConstants if mass_changed is set and
+	// mj_forward if changed is set.
+	bool setGeomProperties(const mujoco_ros_msgs::GeomProperties &properties, bool set_type, bool set_mass,
+	                       bool set_friction, bool set_size, bool &changed, bool &mass_changed,
+	                       std::string &status_message);
 	bool setEqualityConstraintParametersArrayCB(mujoco_ros_msgs::SetEqualityConstraintParameters::Request &req,
 	                                            mujoco_ros_msgs::SetEqualityConstraintParameters::Response &resp);
 	bool setEqualityConstraintParameters(const mujoco_ros_msgs::EqualityConstraintParameters &parameters);
+	bool setEqualityConstraintsCompactCB(mujoco_ros_msgs::SetEqualityConstraintsCompact::Request &req,
+	                                     mujoco_ros_msgs::SetEqualityConstraintsCompact::Response &resp);
+	bool getEqualityConstraintIdsCB(mujoco_ros_msgs::GetEqualityConstraintIds::Request &req,
+	                                mujoco_ros_msgs::GetEqualityConstraintIds::Response &resp);
 	bool getEqualityConstraintParametersArrayCB(mujoco_ros_msgs::GetEqualityConstraintParameters::Request &req,
 	                                            mujoco_ros_msgs::GetEqualityConstraintParameters::Response &resp);
 	bool getEqualityConstraintParameters(mujoco_ros_msgs::EqualityConstraintParameters &parameters);
@@ -348,12 +513,101 @@ protected:
 	bool setRTFactorCB(mujoco_ros_msgs::SetFloat::Request &req, mujoco_ros_msgs::SetFloat::Response &resp);
 	bool getPluginStatsCB(mujoco_ros_msgs::GetPluginStats::Request &req,
 	                      mujoco_ros_msgs::GetPluginStats::Response &resp);
+	bool saveStateCB(mujoco_ros_msgs::SaveState::Request &req, mujoco_ros_msgs::SaveState::Response &resp);
+	bool restoreStateCB(mujoco_ros_msgs::RestoreState::Request &req, mujoco_ros_msgs::RestoreState::Response &resp);
+	bool dumpTraceCB(mujoco_ros_msgs::DumpTrace::Request &req, mujoco_ros_msgs::DumpTrace::Response &resp);
+	bool batchResetCB(mujoco_ros_msgs::BatchReset::Request &req, mujoco_ros_msgs::BatchReset::Response &resp);
+	bool batchStepCB(mujoco_ros_msgs::BatchStep::Request &req, mujoco_ros_msgs::BatchStep::Response &resp);
+	bool batchObserveCB(mujoco_ros_msgs::BatchObserve::Request &req, mujoco_ros_msgs::BatchObserve::Response &resp);
 
 	// Action calls
 	void onStepGoal(const mujoco_ros_msgs::StepGoalConstPtr &goal);
 
 	void resetSim();
 
+	// State components restored by a fast reset
+	static constexpr unsigned int kResetStateSig = mjSTATE_INTEGRATION;
+	// Snapshot of the initial state (after applying initial joint states) of the current model
+	std::vector<mjtNum> initial_state_;
+
+	// States saved with saveState, valid for the current model only
+	std::unordered_map<std::string, std::vector<mjtNum>> state_slots_;
+
+	// Periodic on-disk checkpoints (disabled if no path is set)
+	CheckpointFile checkpoint_file_;
+	std::string checkpoint_path_;
+	double checkpoint_period_       = 1.0;
+	int checkpoint_count_           = 4;
+	bool checkpoint_resume_on_load_ = false;
+	mjtNum last_checkpoint_time_    = 0;
+
+	/**
+	 * @brief Opens the checkpoint file for the current model and restores the last checkpoint if requested.
+	 */
+	void openCheckpointFile();
+
+	/**
+	 * @brief Writes the current state into the next slot of the checkpoint file.
+	 */
+	void writeCheckpoint();
+
+	// Compiled models by content of their sources, skips recompilation on reload
+	ModelCache model_cache_;
+	bool model_cache_enabled_ = false;
+
+	// Name to id lookups of the current model used by services
+	NameIdCache name_id_cache_;
+
+	// Samples model parameters on every reset (disabled if not configured)
+	DomainRandomizer domain_randomizer_;
+
+	// Environments sharing the current model, stepped by the batch services (disabled if batch/size is 0)
+	BatchSim batch_;
+
+	/**
+	 * @brief Recreates the batch environments for the current model, starting from the initial state.
+	 */
+	void setupBatch();
+
+	/**
+	 * @brief Frees the batch environments, e.g. before the model they share is replaced.
+	 */
+	void releaseBatch();
+
+	// Exchange of actions and observations with local clients through shared memory (disabled if shm/name is empty)
+	shm::Server shm_server_;
+
+	// Streaming of body states (disabled if the rate is not positive)
+	ros::Publisher body_states_pub_;
+	double body_states_period_          = 0;
+	mjtNum last_body_states_time_       = 0;
+	std::vector<int> body_states_ids_;
+	mujoco_ros_msgs::BodyStates body_states_msg_;
+
+	/**
+	 * @brief Resolves the bodies to stream for the current model and preallocates the message.
+	 */
+	void setupBodyStatesPublisher();
+
+	// Default output file of the dump_trace service
+	std::string trace_path_;
+
+	// Headless profiling of the physics step (disabled if the rate is not positive)
+	StepProfiler step_profiler_;
+	ros::Publisher step_profile_pub_;
+	mujoco_ros_msgs::StepProfile step_profile_msg_;
+
+	// Real-time pacing of the physics loop
+	RealTimePacer pacer_;
+
+	// CPU affinity and scheduling of the simulation threads
+	ThreadConfig thread_config_;
+
+	/**
+	 * @brief Publishes the states of all configured bodies, if due. Uses the kinematics computed during the last step.
+	 */
+	void publishBodyStates();
+
 	/**
 	 * @brief Loads and sets the initial joint states from the parameter server.
 	 */
@@ -371,21 +625,36 @@ protected:
 
 	boost::thread physics_thread_handle_;
 	boost::thread event_thread_handle_;
+	boost::thread model_load_thread_handle_;
 
 	// Helper variables to get the state of threads
 	std::atomic_int is_physics_running_   = { 0 };
+	std::atomic_bool model_compiling_     = { false };
 	std::atomic_int is_event_running_     = { 0 };
 	std::atomic_int is_rendering_running_ = { 0 };
 
+	// sim time at the start of paused stepping, to detect resets
+	mjtNum paused_sync_sim_ = 0;
+	// start of waiting for the sim mutex, for profiling
+	Clock::time_point lock_wait_start_;
+
 	/**
 	 * @brief Runs physics steps.
 	 */
 	void physicsLoop();
 
+	/**
+	 * @brief Runs a single mj_step followed by all per-step work (clock, last stage callbacks, checkpoints and
+	 * offscreen rendering).
+	 */
+	void physicsStep();
+
 	/**
 	 * @brief physics step when sim is running.
+	 *
+	 * @param[in] max_steps maximum number of steps to run, 0 for no limit.
 	 */
-	void simUnpausedPhysics(mjtNum &syncSim, std::chrono::time_point<Clock> &syncCPU);
+	void simUnpausedPhysics(int max_steps = 0);
 
 	/**
 	 * @brief physics step when sim is paused.
@@ -411,17 +680,53 @@ protected:
 
 	void offscreenRenderLoop();
 
-	// Model loading
+	// Model loading. Only touched by the compile thread while load_request is 4, handed to the event loop with 1
 	mjModel *mnew = nullptr;
 	mjData *dnew  = nullptr;
+	struct
+	{
+		std::string filename;
+		char error[kErrorLength];
+		double seconds = 0;
+	} compiled_;
 
 	/**
-	 * @brief Load a queued model from either a path or XML-string.
+	 * @brief Takes the queued model, or the current one if none is queued, and clears the queue.
 	 */
-	bool initModelFromQueue();
+	std::string takeQueuedModel();
+
+	/**
+	 * @brief Compile a model from either a path or XML-string into mnew and dnew.
+	 * Only writes mnew, dnew and compiled_, so it can run without holding the physics mutex.
+	 */
+	bool initModelFromQueue(const std::string &model);
+
+	/**
+	 * @brief Compiles the given model without holding the physics mutex, so the current model keeps running.
+	 * Requests the swap to the new model (load_request 1) once done, unless a newer load request arrived meanwhile.
+	 * Runs on model_load_thread_handle_.
+	 */
+	void compileQueuedModel(const std::string &model);
+
+	/**
+	 * @brief Publishes the outcome of the background compilation (filename, errors, real-time settings).
+	 * Called by the event loop with the physics mutex held, before the swap.
+	 * @return true if a new model was compiled and can be swapped in.
+	 */
+	bool applyCompileResult();
+
+	/**
+	 * @brief Waits for a running background compilation and frees its result if it has not been swapped in.
+	 */
+	void joinModelLoadThread();
 
 	/**
 	 * @brief Replace the current model and data with new ones and complete the loading process.
+	 *
+	 * Called by the event loop with the physics mutex held, so stepping pauses for the whole call: the swap, env setup
+	 * and loading the plugins for the new model. Plugins cannot be loaded earlier, the plugins of the current model
+	 * keep running their callbacks until they are unloaded here and both register process-wide state (collision
+	 * functions, static transforms).
 	 */
 	void loadWithModelAndData();
 
@@ -0,0 +1,123 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <array>
+#include <string>
+#include <unordered_map>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Name to id lookup tables for selected object types of a model.
+ * Built once after loading a model to avoid linear mj_name2id searches in frequently called services.
+ */
+class NameIdCache
+{
+public:
+	void clear()
+	{
+		for (auto &map : maps_) {
+			map.clear();
+		}
+	}
+
+	/**
+	 * @brief Add all named objects of the given type in m to the cache.
+	 */
+	void add(const mjModel *m, mjtObj type)
+	{
+		if (index(type) >= maps_.size()) {
+			return;
+		}
+		auto &map     = maps_[index(type)];
+		const int num = count(m, type);
+		map.clear();
+		map.reserve(static_cast<size_t>(num));
+		for (int id = 0; id < num; ++id) {
+			const char *name = mj_id2name(m, type, id);
+			if (name != nullptr && name[0] != '\0') {
+				map.emplace(name, id);
+			}
+		}
+	}
+
+	/**
+	 * @brief Look up the id of a named object. Bodies can be queried as mjOBJ_BODY or mjOBJ_XBODY.
+	 * @return the object id or -1 if no object with that name was cached.
+	 */
+	int id(mjtObj type, const std::string &name) const
+	{
+		if (index(type) >= maps_.size()) {
+			return -1;
+		}
+		const auto &map = maps_[index(type)];
+		const auto it   = map.find(name);
+		return it == map.end() ? -1 : it->second;
+	}
+
+private:
+	static size_t index(mjtObj type) { return static_cast<size_t>(type == mjOBJ_XBODY ? mjOBJ_BODY : type); }
+
+	static int count(const mjModel *m, mjtObj type)
+	{
+		switch (type) {
+			case mjOBJ_BODY:
+			case mjOBJ_XBODY:
+				return m->nbody;
+			case mjOBJ_JOINT:
+				return m->njnt;
+			case mjOBJ_GEOM:
+				return m->ngeom;
+			case mjOBJ_TENDON:
+				return m->ntendon;
+			case mjOBJ_ACTUATOR:
+				return m->nu;
+			case mjOBJ_EQUALITY:
+				return m->neq;
+			default:
+				return 0;
+		}
+	}
+
+	std::array<std::unordered_map<std::string, int>, mjNOBJECT> maps_;
+};
+
+} // namespace mujoco_ros
@@ -37,6 +37,8 @@
 #pragma once
 #include <ros/ros.h>
 #include <mujoco_ros/common_types.h>
+#include <mujoco_ros/latency_histogram.h>
+#include <mujoco_ros/tracing.h>
 
 #include <pluginlib/class_loader.h>
 
@@ -54,10 +56,40 @@ public:
 		node_handle_     = ros::NodeHandle(nh_namespace);
 		env_ptr_         = env_ptr;
 		type_            = static_cast<std::string>(rosparam_config_["type"]);
+		name_            = type_;
+		if (rosparam_config_.hasMember("name") &&
+		    rosparam_config_["name"].getType() == XmlRpc::XmlRpcValue::TypeString) {
+			name_ = static_cast<std::string>(rosparam_config_["name"]);
+		}
+
+		trace_names_[kTraceLoad]      = tracing::intern(name_ + "/load");
+		trace_names_[kTraceReset]     = tracing::intern(name_ + "/reset");
+		trace_names_[kTraceControl]   = tracing::intern(name_ + "/control");
+		trace_names_[kTracePassive]   = tracing::intern(name_ + "/passive");
+		trace_names_[kTraceRender]    = tracing::intern(name_ + "/render");
+		trace_names_[kTraceLastStage] = tracing::intern(name_ + "/last_stage");
+
+		depends_on_.clear();
+		if (rosparam_config_.hasMember("depends_on")) {
+			XmlRpc::XmlRpcValue &deps = rosparam_config_["depends_on"];
+			if (deps.getType() == XmlRpc::XmlRpcValue::TypeString) {
+				depends_on_.emplace_back(static_cast<std::string>(deps));
+			} else if (deps.getType() == XmlRpc::XmlRpcValue::TypeArray) {
+				for (int i = 0; i < deps.size(); ++i) {
+					if (deps[i].getType() == XmlRpc::XmlRpcValue::TypeString) {
+						depends_on_.emplace_back(static_cast<std::string>(deps[i]));
+					}
+				}
+			}
+		}
 	};
 
 	// Plugin type as string
 	std::string type_;
+	// Name used to reference the plugin in `depends_on` of other plugins (defaults to the type)
+	std::string name_;
+	// Names of plugins that have to be loaded before this one
+	std::vector<std::string> depends_on_;
 	// load time
 	double load_time_ = -1.0;
 	// reset time
@@ -70,9 +102,15 @@ public:
 	double ema_steptime_render_ = 0.0;
 	// exponential moving average last stage step time in seconds
 	double ema_steptime_last_stage_ = 0.0;
+	// latency distributions of the callbacks, e.g. to find tail spikes hidden by the EMAs
+	LatencyHistogram latency_control_;
+	LatencyHistogram latency_passive_;
+	LatencyHistogram latency_render_;
+	LatencyHistogram latency_last_stage_;
 
 	/**
-	 * @brief Wrapper method that evaluates if loading the plugin is successful
+	 * @brief Wrapper method that evaluates if loading the plugin is successful. Exceptions thrown by load count as a
+	 * failed load.
 	 *
 	 * @param[in] m
 	 * @param[out] d
@@ -81,9 +119,20 @@ public:
 	 */
 	bool safe_load(const mjModel *m, mjData *d)
 	{
-		const auto start    = Clock::now();
-		loading_successful_ = load(m, d);
-		load_time_          = Seconds(Clock::now() - start).count();
+		MUJOCO_ROS_TRACE_SCOPE(trace_names_[kTraceLoad], "plugin");
+		const auto start = Clock::now();
+		try {
+			loading_successful_ = load(m, d);
+		} catch (const std::exception &e) {
+			ROS_ERROR_STREAM_NAMED("mujoco_ros_plugin", "Plugin of type '" << rosparam_config_["type"]
+			                                                               << "' threw while loading: " << e.what());
+			loading_successful_ = false;
+		} catch (...) {
+			ROS_ERROR_STREAM_NAMED("mujoco_ros_plugin",
+			                       "Plugin of type '" << rosparam_config_["type"] << "' threw while loading");
+			loading_successful_ = false;
+		}
+		load_time_ = Seconds(Clock::now() - start).count();
 		if (!loading_successful_)
 			ROS_WARN_STREAM_NAMED("mujoco_ros_plugin",
 			                      "Plugin of type '"
@@ -98,6 +147,7 @@ public:
 	void safe_reset()
 	{
 		if (loading_successful_) {
+			MUJOCO_ROS_TRACE_SCOPE(trace_names_[kTraceReset], "plugin");
 			const auto start = Clock::now();
 			reset();
 			reset_time_ = Seconds(Clock::now() - start).count();
@@ -112,6 +162,7 @@ public:
 	 */
 	void wrappedControlCallback(const mjModel *model, mjData *data)
 	{
+		MUJOCO_ROS_TRACE_SCOPE(trace_names_[kTraceControl], "plugin");
 		const auto start = Clock::now();
 		skip_ema_        = false;
 		controlCallback(model, data);
@@ -119,6 +170,7 @@ public:
 			return;
 		}
 		const auto elapsed_secs = Seconds(Clock::now() - start).count();
+		latency_control_.record(elapsed_secs);
 		// update ema with sensitivity for ~1000 steps
 		ema_steptime_control_ = 0.002 * elapsed_secs + 0.998 * ema_steptime_control_;
 	}
@@ -131,6 +183,7 @@ public:
 	 */
 	void wrappedPassiveCallback(const mjModel *model, mjData *data)
 	{
+		MUJOCO_ROS_TRACE_SCOPE(trace_names_[kTracePassive], "plugin");
 		const auto start = Clock::now();
 		skip_ema_        = false;
 		passiveCallback(model, data);
@@ -138,6 +191,7 @@ public:
 			return;
 		}
 		const auto elapsed_secs = Seconds(Clock::now() - start).count();
+		latency_passive_.record(elapsed_secs);
 		// update ema with sensitivity for ~1000 steps
 		ema_steptime_passive_ = 0.002 * elapsed_secs + 0.998 * ema_steptime_passive_;
 	}
@@ -151,6 +205,7 @@ public:
 	 */
 	void wrappedRenderCallback(const mjModel *model, mjData *data, mjvScene *scene)
 	{
+		MUJOCO_ROS_TRACE_SCOPE(trace_names_[kTraceRender], "plugin");
 		const auto start = Clock::now();
 		skip_ema_        = false;
 		renderCallback(model, data, scene);
@@ -158,6 +213,7 @@ public:
 			return;
 		}
 		const auto elapsed_secs = Seconds(Clock::now() - start).count();
+		latency_render_.record(elapsed_secs);
 		// update ema with sensitivity for ~1000 steps
 		ema_steptime_render_ = 0.002 * elapsed_secs + 0.998 * ema_steptime_render_;
 	}
@@ -170,6 +226,7 @@ public:
 	 */
 	void wrappedLastStageCallback(const mjModel *model, mjData *data)
 	{
+		MUJOCO_ROS_TRACE_SCOPE(trace_names_[kTraceLastStage], "plugin");
 		const auto start = Clock::now();
 		skip_ema_        = false;
 		lastStageCallback(model, data);
@@ -177,6 +234,7 @@ public:
 			return;
 		}
 		const auto elapsed_secs = Seconds(Clock::now() - start).count();
+		latency_last_stage_.record(elapsed_secs);
 		// update ema with sensitivity for ~1000 steps
 		ema_steptime_last_stage_ = 0.002 * elapsed_secs + 0.998 * ema_steptime_last_stage_;
 	}
@@ -232,6 +290,25 @@ public:
 	 */
 	virtual void onGeomChanged(const mjModel * /*model*/, mjData * /*data*/, const int /*geom_id*/){};
 
+	/**
+	 * @brief Override this function to declare which parts of \c mjData the control callback writes to.
+	 * If `parallel_control_cbs` is enabled, control callbacks of plugins with disjoint write sets are run concurrently on
+	 * the MuJoCo threadpool. The qpos addresses cover \c qpos, the dofs cover \c qvel and \c qfrc_applied of the
+	 * respective joints, actuators cover \c ctrl. A plugin declaring a write set must not write to any other part of
+	 * \c mjData or share state with other plugins in its control callback.
+	 *
+	 * @param[in] m pointer to const mjModel.
+	 * @param[out] qpos qpos addresses the control callback writes to.
+	 * @param[out] dofs dof ids the control callback writes to.
+	 * @param[out] actuators actuator ids the control callback writes to.
+	 * @return true if the write set is complete, false if the control callback must run serially (default).
+	 */
+	virtual bool getControlWriteSet(const mjModel * /*m*/, std::vector<int> & /*qpos*/, std::vector<int> & /*dofs*/,
+	                                std::vector<int> & /*actuators*/) const
+	{
+		return false;
+	};
+
 protected:
 	/**
 	 * @brief Called once the world is loaded.
@@ -251,6 +328,19 @@ protected:
 private:
 	bool loading_successful_ = false;
 
+	// interned event names for tracing
+	enum TraceEvent
+	{
+		kTraceLoad = 0,
+		kTraceReset,
+		kTraceControl,
+		kTracePassive,
+		kTraceRender,
+		kTraceLastStage,
+		kNumTraceEvents
+	};
+	std::array<const char *, kNumTraceEvents> trace_names_ = {};
+
 protected:
 	MujocoPlugin() = default;
 	XmlRpc::XmlRpcValue rosparam_config_;
@@ -293,6 +383,20 @@ void registerPlugins(const std::string &nh_namespace, const XmlRpc::XmlRpcValue
 bool registerPlugin(const std::string &nh_namespace, const XmlRpc::XmlRpcValue &config_rpc,
                     std::vector<MujocoPluginPtr> &plugins, MujocoEnv *env);
 
+/**
+ * @brief Resolves the `depends_on` config of each plugin to the plugins that have to finish loading before it may
+ * start. Unknown dependencies are ignored, plugins with cyclic dependencies wait for all other plugins and for each
+ * other, in their configured order.
+ *
+ * @param[in] plugins registered plugins.
+ * @return indices of the plugins each plugin has to wait for.
+ */
+std::vector<std::vector<std::size_t>> computeLoadDependencies(const std::vector<MujocoPluginPtr> &plugins);
+
+/**
+ * @brief Release the plugin loader. The loader is reference counted and only unloaded once every environment that
+ * called initPluginLoader has released it.
+ */
 void unloadPluginloader();
 void initPluginLoader();
 
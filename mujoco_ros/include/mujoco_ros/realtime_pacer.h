@@ -0,0 +1,153 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco_ros/common_types.h>
+#include <mujoco_ros/latency_histogram.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Paces the simulation against absolute wall-clock deadlines.
+ *
+ * The deadline of a step is derived from a single anchor (wall time and sim time at the last sync) and the real-time
+ * factor, so rounding errors of individual sleeps do not accumulate. Waiting is a hybrid of an absolute sleep
+ * (clock_nanosleep on Linux) until shortly before the deadline and a busy spin for the remainder, which keeps wake-up
+ * jitter in the microsecond range. The lateness of every paced step w.r.t. its deadline is recorded.
+ *
+ * All methods except the statistics getters are meant to be called from the physics thread.
+ */
+class RealTimePacer
+{
+public:
+	/**
+	 * @param[in] factor desired real-time factor. Non-positive values run the simulation as fast as possible.
+	 */
+	void setFactor(double factor) { factor_ = factor; }
+	double factor() const { return factor_; }
+	bool isBound() const { return factor_ > 0; }
+
+	/**
+	 * @param[in] seconds remaining wait time below which the pacer spins instead of sleeping.
+	 */
+	void setSpinThreshold(double seconds)
+	{
+		spin_threshold_ = std::chrono::duration_cast<Clock::duration>(Seconds(seconds));
+	}
+
+	/**
+	 * @brief Anchor the deadlines at the given wall and simulation time.
+	 */
+	void sync(Clock::time_point now, double sim_time);
+
+	/**
+	 * @brief Like sync, but counts as a re-sync because the simulation could not keep up.
+	 */
+	void resync(Clock::time_point now, double sim_time);
+
+	/**
+	 * @brief Forget the anchor, e.g. when the simulation is paused. The next step re-anchors.
+	 */
+	void invalidate();
+
+	bool isSynced() const { return synced_; }
+	double syncSim() const { return sync_sim_; }
+
+	/**
+	 * @brief Wall time at which the simulation should reach \c sim_time.
+	 */
+	Clock::time_point deadline(double sim_time) const
+	{
+		return sync_wall_ + std::chrono::duration_cast<Clock::duration>(Seconds((sim_time - sync_sim_) / factor_));
+	}
+
+	/**
+	 * @brief Wall time in seconds the simulation is behind its deadline (negative if ahead).
+	 */
+	double lag(Clock::time_point now, double sim_time) const { return Seconds(now - deadline(sim_time)).count(); }
+
+	/**
+	 * @brief Wall time per simulated time since the last sync, or \c fallback if no simulation time has passed.
+	 */
+	double measuredSlowdown(Clock::time_point now, double sim_time, double fallback) const;
+
+	/**
+	 * @brief Set the deadline for the next step to wait for. Only has an effect if pacing is bound.
+	 */
+	void setNextDeadline(double sim_time);
+	bool hasNextDeadline() const { return has_next_deadline_; }
+	Clock::time_point nextDeadline() const { return next_deadline_; }
+
+	/**
+	 * @brief Block until the next deadline, but at most \c max_wait.
+	 *
+	 * @param[in] max_wait upper bound of the wait, to stay responsive to pause, reset and exit requests.
+	 * @param[in] spin whether to spin for the whole wait instead of sleeping first.
+	 * @return true if the deadline was reached.
+	 */
+	bool waitForNextDeadline(Seconds max_wait, bool spin);
+
+	/**
+	 * @brief Record the lateness of a paced step.
+	 */
+	void recordLateness(double seconds) { jitter_.record(seconds); }
+
+	LatencyHistogram &jitter() { return jitter_; }
+	uint32_t resyncs() const { return resyncs_.load(); }
+
+	void resetStats();
+
+private:
+	double factor_                  = 1.0;
+	Clock::duration spin_threshold_ = std::chrono::microseconds(200);
+
+	bool synced_ = false;
+	Clock::time_point sync_wall_;
+	double sync_sim_ = 0;
+
+	bool has_next_deadline_ = false;
+	Clock::time_point next_deadline_;
+
+	LatencyHistogram jitter_;
+	std::atomic<uint32_t> resyncs_ = { 0 };
+};
+
+} // namespace mujoco_ros
@@ -0,0 +1,274 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mujoco_ros::shm {
+
+/**
+ * Shared-memory transport of actions and observations between the simulation and local clients.
+ *
+ * The simulation creates a POSIX shared memory segment (/dev/shm/<name>) with a versioned Header followed by two
+ * lock-free single-producer/single-consumer rings:
+ *  - observations, written by the simulation after every step: step count, time, qpos, qvel and sensordata.
+ *  - actions, written by the client: one ctrl vector per entry, applied before the next step.
+ *
+ * Ring positions are monotonically increasing counters, entries live at position % num_slots. Producers publish an
+ * entry by advancing the head (release), consumers free it by advancing the tail. In lockstep mode the simulation
+ * only steps once per received action, and both sides block on futexes in the header instead of polling.
+ *
+ * When streaming, a full observation ring does not hold back new states: the simulation discards the oldest entry by
+ * advancing the tail itself. Every observation slot is guarded by a sequence number, so a client reading a slot that
+ * is overwritten at the same time notices it and retries with the next one.
+ *
+ * The segment is recreated whenever a new model is loaded. The old segment is marked closed, so clients know they
+ * have to attach again to get the new dimensions.
+ */
+
+constexpr uint32_t kMagic   = 0x4d4a5253; // "MJRS"
+constexpr uint32_t kVersion = 2;
+
+using Seconds = std::chrono::duration<double>;
+
+struct alignas(64) Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t num_slots;
+	uint32_t nq;
+	uint32_t nv;
+	uint32_t nu;
+	uint32_t nsensordata;
+	uint32_t lockstep;
+	uint32_t reserved;
+	uint64_t obs_offset;
+	uint64_t obs_slot_size;
+	uint64_t action_offset;
+	uint64_t action_slot_size;
+	uint64_t total_size;
+
+	// Set when the segment is abandoned by the simulation (shutdown or model reload)
+	alignas(64) std::atomic<uint32_t> closed;
+
+	// Observation ring, produced by the simulation
+	alignas(64) std::atomic<uint64_t> obs_head;
+	std::atomic<uint32_t> obs_futex;   // incremented after every published observation
+	std::atomic<uint64_t> obs_dropped; // observations lost because the ring was full
+	// Advanced by the client, and by the simulation when it discards the oldest observation
+	alignas(64) std::atomic<uint64_t> obs_tail;
+
+	// Action ring, produced by the client
+	alignas(64) std::atomic<uint64_t> action_head;
+	std::atomic<uint32_t> action_futex; // incremented after every sent action
+	alignas(64) std::atomic<uint64_t> action_tail;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "Shared memory rings require lock-free atomics");
+
+// Followed by qpos (nq), qvel (nv) and sensordata (nsensordata)
+struct ObservationSlot
+{
+	// 2 * position + 1 while the slot is written, 2 * position + 2 once it is complete
+	std::atomic<uint64_t> seq;
+	uint64_t step;
+	double time;
+};
+
+// Followed by ctrl (nu)
+struct ActionSlot
+{
+	uint64_t seq;
+};
+
+struct Observation
+{
+	uint64_t step = 0;
+	double time   = 0;
+	std::vector<double> qpos;
+	std::vector<double> qvel;
+	std::vector<double> sensordata;
+};
+
+/**
+ * @brief Simulation side of the transport, owned by MujocoEnv.
+ *
+ * All methods are meant to be called while holding the physics mutex, except hasAction and waitForAction, which the
+ * physics thread uses to wait for actions without holding it. A segment replaced by open() or close() is only
+ * unmapped once no such call can still use it.
+ */
+class Server
+{
+public:
+	Server() = default;
+	~Server();
+
+	Server(const Server &)            = delete;
+	Server &operator=(const Server &) = delete;
+
+	/**
+	 * @param[in] name name of the shared memory segment, empty to disable the transport.
+	 * @param[in] num_slots capacity of each ring.
+	 * @param[in] lockstep whether the simulation should only step once per received action.
+	 */
+	void configure(const std::string &name, unsigned int num_slots, bool lockstep);
+
+	bool isEnabled() const { return !name_.empty(); }
+	bool isOpen() const { return header_.load(std::memory_order_acquire) != nullptr; }
+	bool isLockstep() const { return isOpen() && lockstep_; }
+	const std::string &name() const { return name_; }
+
+	/**
+	 * @brief (Re-)create the segment for the given model and publish the current state as first observation.
+	 * @return false if the segment could not be created, the reason is stored in \c error.
+	 */
+	bool open(const mjModel *m, const mjData *d, std::string &error);
+
+	/**
+	 * @brief Mark the segment closed for clients and remove it.
+	 */
+	void close();
+
+	bool hasAction() const;
+
+	/**
+	 * @brief Block until an action is available, but at most \c max_wait.
+	 * @return true if an action is available.
+	 */
+	bool waitForAction(Seconds max_wait) const;
+
+	/**
+	 * @brief Write a received action to \c d->ctrl. In lockstep mode one action is consumed, otherwise all pending
+	 * actions are consumed and the newest one is applied.
+	 * @return true if an action was applied.
+	 */
+	bool applyAction(mjData *d);
+
+	/**
+	 * @brief Publish the current state as observation and wake waiting clients. If the ring is full, the oldest
+	 * observation is discarded when streaming, while in lockstep the new one is dropped.
+	 */
+	void publish(const mjData *d);
+
+	uint64_t dropped() const;
+
+private:
+	std::string name_;
+	unsigned int num_slots_ = 8;
+	bool lockstep_          = false;
+
+	std::atomic<Header *> header_ = { nullptr };
+	std::size_t size_             = 0;
+	uint64_t num_published_       = 0;
+	// closed segments and their sizes, unmapped once no hasAction or waitForAction call is running
+	std::vector<std::pair<Header *, std::size_t>> retired_;
+	// number of running hasAction and waitForAction calls, which do not hold the physics mutex
+	mutable std::atomic<unsigned int> lockfree_users_ = { 0 };
+
+	void releaseRetired();
+};
+
+/**
+ * @brief Client side of the transport, e.g. for a learner running in another process.
+ */
+class Client
+{
+public:
+	Client() = default;
+	~Client();
+
+	Client(const Client &)            = delete;
+	Client &operator=(const Client &) = delete;
+
+	/**
+	 * @brief Map the segment with the given name. Fails if it does not exist or has an incompatible version.
+	 */
+	bool attach(const std::string &name, std::string &error);
+	void detach();
+
+	bool isAttached() const { return header_ != nullptr; }
+	/**
+	 * @brief Whether the simulation abandoned the segment. Attach again to continue with the new segment.
+	 */
+	bool isClosed() const;
+	bool isLockstep() const { return header_ != nullptr && header_->lockstep != 0; }
+
+	// Dimensions of the attached segment, 0 if not attached
+	uint32_t nq() const { return header_ != nullptr ? header_->nq : 0; }
+	uint32_t nv() const { return header_ != nullptr ? header_->nv : 0; }
+	uint32_t nu() const { return header_ != nullptr ? header_->nu : 0; }
+	uint32_t nsensordata() const { return header_ != nullptr ? header_->nsensordata : 0; }
+
+	/**
+	 * @brief Send a ctrl vector of nu() entries.
+	 * @return false if the action ring is full.
+	 */
+	bool sendAction(const double *ctrl);
+
+	bool hasObservation() const;
+
+	/**
+	 * @brief Block until an observation is available, but at most \c timeout.
+	 * @return true if an observation is available.
+	 */
+	bool waitForObservation(Seconds timeout) const;
+
+	/**
+	 * @brief Take the oldest pending observation, or the newest one (discarding older ones) if \c latest is set. When
+	 * streaming, the oldest pending observation may already be newer than the last one read if the ring overflowed.
+	 * @return false if no observation is pending.
+	 */
+	bool readObservation(Observation &obs, bool latest = false);
+
+private:
+	Header *header_    = nullptr;
+	std::size_t size_  = 0;
+	uint64_t num_sent_ = 0;
+};
+
+} // namespace mujoco_ros::shm
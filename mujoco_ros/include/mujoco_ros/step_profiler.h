@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+#include <mujoco_ros/common_types.h>
+
+#include <mujoco_ros_msgs/StepProfile.h>
+
+#include <array>
+
+namespace mujoco_ros {
+
+/**
+ * @brief Headless profiler of the physics step.
+ *
+ * Accumulates wall time spent in the phases of MujocoEnv::physicsStep, the mj_step sub-phases reported in
+ * mjData::timer and the time the physics thread waited for the physics mutex. Statistics are aggregated over a
+ * window of wall time and then handed out as a StepProfile message. All methods are meant to be called from the
+ * physics thread.
+ */
+class StepProfiler
+{
+public:
+	enum Phase
+	{
+		kStep = 0,
+		kMjStep,
+		kPosition,
+		kCollision,
+		kVelocity,
+		kActuation,
+		kConstraint,
+		kAdvance,
+		kPublishSimTime,
+		kLastStageCbs,
+		kCheckpoint,
+		kOffscreenWait,
+		kOffscreenUpdate,
+		kNumPhases
+	};
+
+	static const char *phaseName(Phase phase);
+
+	/**
+	 * @brief Enable the profiler.
+	 * Installs a timer callback for the MuJoCo built-in profiler if none is set yet.
+	 *
+	 * @param[in] period length of the aggregation window in seconds (wall time). Non-positive values disable profiling.
+	 */
+	void configure(double period);
+
+	bool isEnabled() const { return period_ > 0; }
+
+	/**
+	 * @brief Start profiling a step.
+	 * @return the current time, to be passed to lap. Default constructed if profiling is disabled.
+	 */
+	Clock::time_point beginStep(const mjData *d);
+
+	/**
+	 * @brief Add the time since \c since to a phase.
+	 * @return the current time, to be passed to the next lap.
+	 */
+	Clock::time_point lap(Phase phase, Clock::time_point since)
+	{
+		if (!isEnabled()) {
+			return since;
+		}
+		const auto now = Clock::now();
+		current_[phase] += Seconds(now - since).count();
+		return now;
+	}
+
+	/**
+	 * @brief Finish profiling a step. Adds the mj_step sub-phases measured by MuJoCo since beginStep.
+	 */
+	void endStep(const mjData *d);
+
+	void addLockWait(double seconds) { lock_wait_ += seconds; }
+
+	/**
+	 * @brief Check whether the aggregation window is over and there is data to report.
+	 */
+	bool windowElapsed() const;
+
+	/**
+	 * @brief Fill the message with the statistics of the current window and start a new one.
+	 */
+	void flush(mujoco_ros_msgs::StepProfile &msg);
+
+private:
+	double period_ = 0;
+
+	Clock::time_point window_start_;
+	Clock::time_point step_start_;
+	uint32_t steps_   = 0;
+	double lock_wait_ = 0;
+
+	// per phase time of the running step
+	std::array<double, kNumPhases> current_ = {};
+	std::array<double, kNumPhases> sum_     = {};
+	std::array<double, kNumPhases> max_     = {};
+
+	// mjData::timer durations at the start of the step
+	std::array<mjtNum, mjNTIMER> timer_start_ = {};
+};
+
+} // namespace mujoco_ros
@@ -0,0 +1,89 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco_ros/mujoco_env.h>
+
+#include <string>
+#include <vector>
+
+namespace mujoco_ros {
+
+/**
+ * @brief MujocoEnv that is stepped synchronously by the caller instead of the physics loop.
+ *
+ * Only the event loop is started, which handles loading. Steps run through the same code path as the physics loop
+ * (see physicsStep), but without pacing or handling pause, reset and load requests. Used by benchmarks and
+ * throughput tests.
+ */
+class SyncEnv : public MujocoEnv
+{
+public:
+	using MujocoEnv::MujocoEnv;
+	~SyncEnv();
+
+	/**
+	 * @brief Start the event loop and load a model.
+	 *
+	 * @param[in] model path to an xml or mjb file, or an xml string.
+	 * @param[in] timeout maximum time to wait for the model to be loaded in wall seconds.
+	 * @return true if the model has been loaded.
+	 */
+	bool load(const std::string &model, double timeout);
+
+	/**
+	 * @brief Run steps synchronously.
+	 *
+	 * @param[in] num_steps number of steps to run.
+	 * @param[out] latencies if not null, filled with the wall time of each step in seconds.
+	 * @return simulation time advanced.
+	 */
+	double step(int num_steps, std::vector<double> *latencies = nullptr);
+
+	std::vector<std::string> cameraNames() const;
+
+	const std::string &getNamespace() const { return nh_->getNamespace(); }
+
+	/**
+	 * @brief Stop the event loop and the offscreen render thread. Called on destruction if not called before.
+	 */
+	void shutdown();
+};
+
+} // namespace mujoco_ros
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <mujoco/mujoco.h>
+#include <ros/node_handle.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace mujoco_ros {
+
+/**
+ * @brief CPU affinity, real-time priority and memory locking of the simulation threads.
+ *
+ * Configured per thread class from the parameter server:
+ *
+ *   threads:
+ *     lock_memory: true        # mlockall(MCL_CURRENT | MCL_FUTURE)
+ *     physics:    { cpus: [2], priority: 80 }
+ *     event:      { cpus: [3] }
+ *     render:     { cpus: [3], priority: 10 }
+ *     threadpool: { cpus: [4, 5, 6, 7], priority: 70 }
+ *
+ * `cpus` restricts the threads of a class to the given cores (a single integer is accepted as well), `priority`
+ * switches them to SCHED_FIFO with the given priority. Unconfigured classes keep the inherited affinity and the
+ * default scheduling policy. Real-time priorities and memory locking usually require CAP_SYS_NICE/CAP_IPC_LOCK or
+ * matching rtprio/memlock limits; failures are reported but not fatal.
+ */
+class ThreadConfig
+{
+public:
+	enum ThreadClass
+	{
+		kPhysics = 0,
+		kEvent,
+		kRender,
+		kThreadPool,
+		kNumThreadClasses
+	};
+
+	static const char *className(ThreadClass cls);
+
+	struct Settings
+	{
+		// cores to run on, empty to inherit the process affinity
+		std::vector<int> cpus;
+		// SCHED_FIFO priority, 0 keeps the default policy
+		int priority = 0;
+	};
+
+	/**
+	 * @brief Read and validate the configuration. Invalid entries are dropped with a warning.
+	 *
+	 * @param[in] nh node handle to read the `threads` namespace from.
+	 * @return false if any entry was invalid.
+	 */
+	bool load(const ros::NodeHandle &nh);
+
+	const Settings &settings(ThreadClass cls) const { return settings_[cls]; }
+	bool isConfigured(ThreadClass cls) const { return !settings_[cls].cpus.empty() || settings_[cls].priority > 0; }
+
+	/**
+	 * @brief Apply the settings of a thread class to the calling thread and log the outcome.
+	 * @return false if a setting could not be applied.
+	 */
+	bool applyToCurrentThread(ThreadClass cls) const;
+
+	/**
+	 * @brief Apply the threadpool settings to every worker of a MuJoCo threadpool.
+	 *
+	 * MuJoCo does not expose its workers, so one task per worker is enqueued that applies the settings and then waits
+	 * until all tasks have started, which guarantees that every worker runs exactly one of them.
+	 *
+	 * @param[in] pool threadpool to configure.
+	 * @param[in] num_workers number of workers of the threadpool.
+	 * @return false if a setting could not be applied to all workers.
+	 */
+	bool applyToThreadPool(mjThreadPool *pool, int num_workers) const;
+
+	/**
+	 * @brief Lock all current and future pages of the process into memory, if configured.
+	 * @return false if locking was requested but failed.
+	 */
+	bool applyMemoryLock() const;
+
+	/**
+	 * @brief Human readable summary of the configuration.
+	 */
+	std::string describe() const;
+
+private:
+	std::array<Settings, kNumThreadClasses> settings_;
+	bool lock_memory_ = false;
+};
+
+} // namespace mujoco_ros
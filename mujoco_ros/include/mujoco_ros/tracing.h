@@ -0,0 +1,140 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace mujoco_ros::tracing {
+
+/**
+ * Lightweight timeline tracing of the simulation threads.
+ *
+ * Each thread records completed scopes (name, category, start and end time) into its own ring buffer, which keeps the
+ * most recent events once full. The buffers can be written to a Chrome trace JSON file at any time, which can be
+ * opened in chrome://tracing or https://ui.perfetto.dev. When tracing is disabled, a scope costs a single relaxed
+ * atomic load.
+ */
+
+namespace detail {
+extern std::atomic_bool enabled;
+} // namespace detail
+
+inline bool isEnabled()
+{
+	return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Enable or disable recording. Already recorded events are kept.
+ * @param[in] events_per_thread size of the ring buffer of each thread. Applies to buffers created afterwards.
+ */
+void configure(bool enabled, std::size_t events_per_thread = 65536);
+
+/**
+ * @brief Name the calling thread in the trace.
+ */
+void setThreadName(const std::string &name);
+
+/**
+ * @brief Get a pointer to a copy of the string that stays valid for the lifetime of the process.
+ * Event names are stored as pointers, dynamic names (e.g. plugin names) have to be interned first.
+ */
+const char *intern(const std::string &str);
+
+/**
+ * @brief Current time in nanoseconds on the trace clock.
+ */
+int64_t now();
+
+/**
+ * @brief Record a completed event on the calling thread.
+ * @param[in] name event name, must outlive the trace (string literal or interned).
+ * @param[in] category event category, must outlive the trace.
+ */
+void record(const char *name, const char *category, int64_t start_ns, int64_t end_ns);
+
+/**
+ * @brief Write all recorded events as Chrome trace JSON.
+ * Buffers of threads that have exited are released afterwards, so their events are only written once.
+ *
+ * @param[in] path output file.
+ * @param[in] clear if true, the buffers are emptied after writing.
+ * @param[out] num_events number of events written.
+ * @param[out] error description in case of failure.
+ * @return true if the file was written.
+ */
+bool writeChromeTrace(const std::string &path, bool clear, std::size_t &num_events, std::string &error);
+
+/**
+ * @brief Records the lifetime of the object as an event, if tracing is enabled at construction.
+ */
+class Scope
+{
+public:
+	Scope(const char *name, const char *category)
+	    : name_(name), category_(category), start_(isEnabled() ? now() : -1)
+	{
+	}
+
+	~Scope()
+	{
+		if (start_ >= 0) {
+			record(name_, category_, start_, now());
+		}
+	}
+
+	Scope(const Scope &)            = delete;
+	Scope &operator=(const Scope &) = delete;
+
+private:
+	const char *name_;
+	const char *category_;
+	int64_t start_;
+};
+
+} // namespace mujoco_ros::tracing
+
+#define MUJOCO_ROS_TRACE_CONCAT_INNER(a, b) a##b
+#define MUJOCO_ROS_TRACE_CONCAT(a, b) MUJOCO_ROS_TRACE_CONCAT_INNER(a, b)
+/**
+ * @brief Trace the enclosing scope. \c name and \c category must outlive the trace.
+ */
+#define MUJOCO_ROS_TRACE_SCOPE(name, category) \
+	::mujoco_ros::tracing::Scope MUJOCO_ROS_TRACE_CONCAT(mujoco_ros_trace_scope_, __LINE__)(name, category)
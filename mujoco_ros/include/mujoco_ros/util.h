@@ -34,6 +34,8 @@
 
 /* Authors: David P. Leins */
 
+#pragma once
+
 #include <mujoco_ros/common_types.h>
 #include <mujoco/mujoco.h>
 
@@ -56,4 +58,118 @@ static inline int jointName2id(mjModel *m, const std::string &joint_name,
 	return result;
 }
 
+/**
+ * @brief Recomputes rbound and the local AABB of a primitive geom from its current type and size.
+ * @return false if the geom is not a primitive (plane, mesh, hfield, sdf), in which case nothing is changed.
+ */
+static inline bool updateGeomBounds(mjModel *m, int geom_id)
+{
+	const mjtNum *size = m->geom_size + 3 * geom_id;
+	mjtNum *aabb       = m->geom_aabb + 6 * geom_id;
+	mjtNum half[3];
+
+	switch (m->geom_type[geom_id]) {
+		case mjGEOM_SPHERE:
+			m->geom_rbound[geom_id] = size[0];
+			mju_fill(half, size[0], 3);
+			break;
+		case mjGEOM_CAPSULE:
+			m->geom_rbound[geom_id] = size[0] + size[1];
+			half[0]                 = size[0];
+			half[1]                 = size[0];
+			half[2]                 = size[0] + size[1];
+			break;
+		case mjGEOM_CYLINDER:
+			m->geom_rbound[geom_id] = mju_sqrt(size[0] * size[0] + size[1] * size[1]);
+			half[0]                 = size[0];
+			half[1]                 = size[0];
+			half[2]                 = size[1];
+			break;
+		case mjGEOM_ELLIPSOID:
+			m->geom_rbound[geom_id] = mju_max(size[0], mju_max(size[1], size[2]));
+			mju_copy3(half, size);
+			break;
+		case mjGEOM_BOX:
+			m->geom_rbound[geom_id] = mju_norm3(size);
+			mju_copy3(half, size);
+			break;
+		default:
+			return false;
+	}
+
+	mju_zero3(aabb);
+	mju_copy3(aabb + 3, half);
+	return true;
+}
+
+/**
+ * @brief Whether the size of a geom is valid for its type, i.e. all size components used by the type are positive.
+ * Unused components are 0 in compiled models, hence changing the type without setting a matching size can yield
+ * degenerate geoms.
+ */
+static inline bool geomSizeValid(int type, const mjtNum size[3])
+{
+	switch (type) {
+		case mjGEOM_SPHERE:
+			return size[0] > 0;
+		case mjGEOM_CAPSULE:
+		case mjGEOM_CYLINDER:
+			return size[0] > 0 && size[1] > 0;
+		case mjGEOM_ELLIPSOID:
+		case mjGEOM_BOX:
+			return size[0] > 0 && size[1] > 0 && size[2] > 0;
+		default:
+			return true;
+	}
+}
+
+/**
+ * @brief Refits a node of a body's BVH and its descendants to their children. Leaves are left unchanged.
+ * @return pointer to the AABB (center, half-size) of the node.
+ */
+static inline const mjtNum *refitBVHNode(mjModel *m, int adr, int node)
+{
+	mjtNum *aabb     = m->bvh_aabb + 6 * (adr + node);
+	const int *child = m->bvh_child + 2 * (adr + node);
+	if (child[0] < 0 && child[1] < 0) {
+		return aabb;
+	}
+	if (child[0] < 0 || child[1] < 0) {
+		mju_copy(aabb, refitBVHNode(m, adr, child[0] < 0 ? child[1] : child[0]), 6);
+		return aabb;
+	}
+
+	const mjtNum *a = refitBVHNode(m, adr, child[0]);
+	const mjtNum *b = refitBVHNode(m, adr, child[1]);
+	for (int k = 0; k < 3; ++k) {
+		const mjtNum lo = mju_min(a[k] - a[k + 3], b[k] - b[k + 3]);
+		const mjtNum hi = mju_max(a[k] + a[k + 3], b[k] + b[k + 3]);
+		aabb[k]         = 0.5 * (lo + hi);
+		aabb[k + 3]     = 0.5 * (hi - lo);
+	}
+	return aabb;
+}
+
+/**
+ * @brief Grows the leaf of a geom in its body's BVH to the geom's bounding sphere and refits all inner nodes from the
+ * root. The leaf center is the geom center for primitives, so the update does not depend on the frame of the BVH.
+ */
+static inline void updateBodyBVH(mjModel *m, int geom_id)
+{
+	const int body_id = m->geom_bodyid[geom_id];
+	const int adr     = m->body_bvhadr[body_id];
+	const int num     = m->body_bvhnum[body_id];
+	if (adr < 0 || num <= 0) {
+		return;
+	}
+
+	for (int i = 0; i < num; ++i) {
+		if (m->bvh_nodeid[adr + i] == geom_id) {
+			mju_fill(m->bvh_aabb + 6 * (adr + i) + 3, m->geom_rbound[geom_id], 3);
+		}
+	}
+	// The first node of a body is its root
+	refitBVHNode(m, adr, 0);
+}
+
 } // namespace mujoco_ros::util
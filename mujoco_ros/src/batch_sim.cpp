@@ -0,0 +1,221 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/batch_sim.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mujoco_ros {
+
+BatchSim::~BatchSim()
+{
+	clear();
+}
+
+void BatchSim::configure(int num_envs)
+{
+	num_envs_ = std::max(num_envs, 0);
+}
+
+void BatchSim::init(const mjModel *m, const mjData *reference)
+{
+	clear();
+	if (!isEnabled() || m == nullptr) {
+		return;
+	}
+	model_ = m;
+
+	initial_state_.resize(static_cast<std::size_t>(mj_stateSize(m, kStateSig)));
+	mj_getState(m, reference, initial_state_.data(), kStateSig);
+
+	data_.reserve(static_cast<std::size_t>(num_envs_));
+	tasks_.resize(static_cast<std::size_t>(num_envs_));
+	for (int i = 0; i < num_envs_; ++i) {
+		data_.push_back(mj_makeData(m));
+		tasks_[static_cast<std::size_t>(i)].batch = this;
+		tasks_[static_cast<std::size_t>(i)].index = static_cast<std::size_t>(i);
+	}
+	actions_.assign(size() * actionSize(), 0);
+	observations_.assign(size() * observationSize(), 0);
+	times_.assign(size(), 0);
+
+	reset({}, nullptr);
+}
+
+void BatchSim::clear()
+{
+	for (auto *d : data_) {
+		mj_deleteData(d);
+	}
+	data_.clear();
+	tasks_.clear();
+	initial_state_.clear();
+	actions_.clear();
+	observations_.clear();
+	times_.clear();
+	model_ = nullptr;
+}
+
+std::size_t BatchSim::observationSize() const
+{
+	if (model_ == nullptr) {
+		return 0;
+	}
+	return static_cast<std::size_t>(model_->nq + model_->nv + model_->nsensordata);
+}
+
+bool BatchSim::reset(const std::vector<uint32_t> &ids, mjThreadPool *pool)
+{
+	std::vector<std::size_t> indices;
+	if (ids.empty()) {
+		indices.resize(size());
+		for (std::size_t i = 0; i < size(); ++i) {
+			indices[i] = i;
+		}
+	} else {
+		for (const auto id : ids) {
+			if (id >= size()) {
+				return false;
+			}
+			indices.push_back(id);
+		}
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+	}
+	runTasks(indices, resetTask, pool);
+	return true;
+}
+
+bool BatchSim::step(const std::vector<double> &actions, int num_steps, mjThreadPool *pool,
+                    std::string &status_message)
+{
+	if (!actions.empty()) {
+		if (actions.size() != actions_.size()) {
+			status_message = "Expected " + std::to_string(actions_.size()) + " actions (" + std::to_string(size()) +
+			                 " envs x " + std::to_string(actionSize()) + " actuators), got " +
+			                 std::to_string(actions.size());
+			return false;
+		}
+		if (!std::all_of(actions.begin(), actions.end(), [](double a) { return std::isfinite(a); })) {
+			status_message = "Actions contain non-finite values";
+			return false;
+		}
+		std::copy(actions.begin(), actions.end(), actions_.begin());
+	}
+	num_steps_ = std::max(num_steps, 1);
+
+	std::vector<std::size_t> indices(size());
+	for (std::size_t i = 0; i < size(); ++i) {
+		indices[i] = i;
+	}
+	runTasks(indices, stepTask, pool);
+	return true;
+}
+
+void *BatchSim::resetTask(void *args)
+{
+	auto *task = static_cast<Task *>(args);
+	task->batch->resetEnv(task->index);
+	return nullptr;
+}
+
+void *BatchSim::stepTask(void *args)
+{
+	auto *task = static_cast<Task *>(args);
+	task->batch->stepEnv(task->index);
+	return nullptr;
+}
+
+void BatchSim::runTasks(const std::vector<std::size_t> &indices, void *(*func)(void *), mjThreadPool *pool)
+{
+	if (indices.empty()) {
+		return;
+	}
+	if (pool == nullptr) {
+		for (const auto i : indices) {
+			func(&tasks_[i]);
+		}
+		return;
+	}
+
+	// Dispatch all but the last environment to the threadpool and run the last one on the calling thread
+	for (std::size_t k = 0; k + 1 < indices.size(); ++k) {
+		auto &task = tasks_[indices[k]];
+		mju_defaultTask(&task.task);
+		task.task.func = func;
+		task.task.args = &task;
+		mju_threadPoolEnqueue(pool, &task.task);
+	}
+	func(&tasks_[indices.back()]);
+	for (std::size_t k = 0; k + 1 < indices.size(); ++k) {
+		mju_taskJoin(&tasks_[indices[k]].task);
+	}
+}
+
+void BatchSim::resetEnv(std::size_t i)
+{
+	mjData *d = data_[i];
+	mj_resetData(model_, d);
+	mj_setState(model_, d, initial_state_.data(), kStateSig);
+	mj_forward(model_, d);
+	// Start from the controls of the initial state
+	std::copy_n(d->ctrl, actionSize(), actions_.begin() + static_cast<std::ptrdiff_t>(i * actionSize()));
+	observe(i);
+}
+
+void BatchSim::stepEnv(std::size_t i)
+{
+	mjData *d = data_[i];
+	std::copy_n(actions_.begin() + static_cast<std::ptrdiff_t>(i * actionSize()), actionSize(), d->ctrl);
+	for (int step = 0; step < num_steps_; ++step) {
+		mj_step(model_, d);
+	}
+	observe(i);
+}
+
+void BatchSim::observe(std::size_t i)
+{
+	const mjData *d = data_[i];
+	auto row        = observations_.begin() + static_cast<std::ptrdiff_t>(i * observationSize());
+	row             = std::copy_n(d->qpos, model_->nq, row);
+	row             = std::copy_n(d->qvel, model_->nv, row);
+	std::copy_n(d->sensordata, model_->nsensordata, row);
+	times_[i] = d->time;
+}
+
+} // namespace mujoco_ros
@@ -42,9 +42,40 @@
 
 #include <mujoco_ros/util.h>
 
+#include <algorithm>
+
 namespace mujoco_ros {
 namespace mju = ::mujoco::sample_util;
 
+namespace {
+
+void fillLatencyStats(LatencyHistogram &hist, mujoco_ros_msgs::CallbackLatencyStats &msg, bool reset)
+{
+	msg.count = hist.count();
+	msg.p50   = hist.percentile(0.5);
+	msg.p90   = hist.percentile(0.9);
+	msg.p99   = hist.percentile(0.99);
+	msg.p999  = hist.percentile(0.999);
+	msg.max   = hist.max();
+	if (reset) {
+		hist.reset();
+	}
+}
+
+void fillBatchObservation(const BatchSim &batch, const mjModel *m, mujoco_ros_msgs::BatchObservation &msg)
+{
+	msg.num_envs = static_cast<decltype(msg.num_envs)>(batch.size());
+	if (m != nullptr && batch.size() > 0) {
+		msg.nq          = static_cast<decltype(msg.nq)>(m->nq);
+		msg.nv          = static_cast<decltype(msg.nv)>(m->nv);
+		msg.nsensordata = static_cast<decltype(msg.nsensordata)>(m->nsensordata);
+	}
+	msg.time.assign(batch.times().begin(), batch.times().end());
+	msg.data.assign(batch.observations().begin(), batch.observations().end());
+}
+
+} // namespace
+
 bool MujocoEnv::verifyAdminHash(const std::string &hash)
 {
 	if (settings_.eval_mode) {
@@ -65,14 +96,22 @@ void MujocoEnv::setupServices()
 	service_servers_.emplace_back(nh_->advertiseService("reset", &MujocoEnv::resetCB, this));
 	service_servers_.emplace_back(nh_->advertiseService("set_body_state", &MujocoEnv::setBodyStateCB, this));
 	service_servers_.emplace_back(nh_->advertiseService("get_body_state", &MujocoEnv::getBodyStateCB, this));
+	service_servers_.emplace_back(nh_->advertiseService("set_body_states", &MujocoEnv::setBodyStatesCB, this));
+	service_servers_.emplace_back(nh_->advertiseService("get_body_states", &MujocoEnv::getBodyStatesCB, this));
 	service_servers_.emplace_back(nh_->advertiseService("set_geom_properties", &MujocoEnv::setGeomPropertiesCB, this));
 	service_servers_.emplace_back(nh_->advertiseService("get_geom_properties", &MujocoEnv::getGeomPropertiesCB, this));
+	service_servers_.emplace_back(
+	    nh_->advertiseService("set_geom_properties_array", &MujocoEnv::setGeomPropertiesArrayCB, this));
 
 	service_servers_.emplace_back(
 	    nh_->advertiseService("set_eq_constraint_parameters", &MujocoEnv::setEqualityConstraintParametersArrayCB, this));
 
 	service_servers_.emplace_back(
 	    nh_->advertiseService("get_eq_constraint_parameters", &MujocoEnv::getEqualityConstraintParametersArrayCB, this));
+	service_servers_.emplace_back(
+	    nh_->advertiseService("set_eq_constraints_compact", &MujocoEnv::setEqualityConstraintsCompactCB, this));
+	service_servers_.emplace_back(
+	    nh_->advertiseService("get_eq_constraint_ids", &MujocoEnv::getEqualityConstraintIdsCB, this));
 
 	service_servers_.emplace_back(nh_->advertiseService<std_srvs::Empty::Request, std_srvs::Empty::Response>(
 	    "load_initial_joint_states", [&](auto /*&req*/, auto /*&res*/) {
@@ -86,6 +125,14 @@ void MujocoEnv::setupServices()
 	service_servers_.emplace_back(nh_->advertiseService("get_plugin_stats", &MujocoEnv::getPluginStatsCB, this));
 	service_servers_.emplace_back(nh_->advertiseService("set_gravity", &MujocoEnv::setGravityCB, this));
 	service_servers_.emplace_back(nh_->advertiseService("get_gravity", &MujocoEnv::getGravityCB, this));
+	service_servers_.emplace_back(nh_->advertiseService("save_state", &MujocoEnv::saveStateCB, this));
+	service_servers_.emplace_back(nh_->advertiseService("restore_state", &MujocoEnv::restoreStateCB, this));
+	service_servers_.emplace_back(nh_->advertiseService("dump_trace", &MujocoEnv::dumpTraceCB, this));
+	if (batch_.isEnabled()) {
+		service_servers_.emplace_back(nh_->advertiseService("batch/reset", &MujocoEnv::batchResetCB, this));
+		service_servers_.emplace_back(nh_->advertiseService("batch/step", &MujocoEnv::batchStepCB, this));
+		service_servers_.emplace_back(nh_->advertiseService("batch/observe", &MujocoEnv::batchObserveCB, this));
+	}
 
 	action_step_ = std::make_unique<actionlib::SimpleActionServer<mujoco_ros_msgs::StepAction>>(
 	    *nh_, "step", boost::bind(&MujocoEnv::onStepGoal, this, boost::placeholders::_1), false);
@@ -129,9 +176,36 @@ void MujocoEnv::onStepGoal(const mujoco_ros_msgs::StepGoalConstPtr &goal)
 	action_step_->setSucceeded(result);
 }
 
+void *MujocoEnv::runControlTask(void *args)
+{
+	auto *task = static_cast<ControlTask *>(args);
+	task->plugin->wrappedControlCallback(task->m, task->d);
+	return nullptr;
+}
+
 void MujocoEnv::runControlCbs()
 {
-	for (const auto &plugin : this->cb_ready_plugins_) {
+	const size_t num_tasks = parallel_control_tasks_.size();
+	if (num_tasks > 0) {
+		// Dispatch all but the last task to the threadpool and run the last one on the calling thread
+		for (size_t i = 0; i < num_tasks; ++i) {
+			auto &task = parallel_control_tasks_[i];
+			task.m     = this->model_.get();
+			task.d     = this->data_.get();
+			if (i + 1 < num_tasks) {
+				mju_defaultTask(&task.task);
+				task.task.func = runControlTask;
+				task.task.args = &task;
+				mju_threadPoolEnqueue(threadpool_, &task.task);
+			}
+		}
+		runControlTask(&parallel_control_tasks_.back());
+		for (size_t i = 0; i + 1 < num_tasks; ++i) {
+			mju_taskJoin(&parallel_control_tasks_[i].task);
+		}
+	}
+
+	for (const auto &plugin : this->serial_control_plugins_) {
 		plugin->wrappedControlCallback(this->model_.get(), this->data_.get());
 	}
 }
@@ -155,6 +229,7 @@ void MujocoEnv::runLastStageCbs()
 	for (const auto &plugin : this->cb_ready_plugins_) {
 		plugin->wrappedLastStageCallback(this->model_.get(), this->data_.get());
 	}
+	publishBodyStates();
 }
 
 bool MujocoEnv::setPauseCB(mujoco_ros_msgs::SetPause::Request &req, mujoco_ros_msgs::SetPause::Response &res)
@@ -177,19 +252,16 @@ bool MujocoEnv::shutdownCB(std_srvs::Empty::Request & /*req*/, std_srvs::Empty::
 
 bool MujocoEnv::reloadCB(mujoco_ros_msgs::Reload::Request &req, mujoco_ros_msgs::Reload::Response &res)
 {
+	MUJOCO_ROS_TRACE_SCOPE("reload", "service");
 	ROS_DEBUG("Requested reload via ROS service");
 
-	if (req.model.size() > kMaxFilenameLength) {
-		ROS_ERROR_STREAM("Model string too long. Max length: "
-		                 << kMaxFilenameLength << " (got " << req.model.size()
-		                 << "); Consider compiling with a larger value for kMaxFilenameLength");
+	settings_.checkpoint_resume_request.store(req.resume_from_checkpoint ? 1 : 0);
+	if (!queueModel(req.model)) {
+		settings_.checkpoint_resume_request.store(0);
 		res.success        = false;
-		res.status_message = "Model string too long (max: " + std::to_string(kMaxFilenameLength) + ")";
+		res.status_message = "Model string too long (max: " + std::to_string(kMaxFilenameLength - 1) + ")";
 		return true;
 	}
-	mju::strcpy_arr(queued_filename_, req.model.c_str());
-
-	settings_.load_request.store(2);
 
 	while (getOperationalStatus() > 0) {
 		std::this_thread::sleep_for(std::chrono::milliseconds(5));
@@ -203,63 +275,176 @@ bool MujocoEnv::reloadCB(mujoco_ros_msgs::Reload::Request &req, mujoco_ros_msgs:
 
 bool MujocoEnv::resetCB(std_srvs::Empty::Request & /*req*/, std_srvs::Empty::Response & /*res*/)
 {
+	MUJOCO_ROS_TRACE_SCOPE("reset", "service");
 	ROS_DEBUG("Reset requested");
 	settings_.reset_request.store(1);
 	return true;
 }
 
-bool MujocoEnv::setBodyStateCB(mujoco_ros_msgs::SetBodyState::Request &req,
-                               mujoco_ros_msgs::SetBodyState::Response &resp)
+bool MujocoEnv::saveStateCB(mujoco_ros_msgs::SaveState::Request &req, mujoco_ros_msgs::SaveState::Response &resp)
 {
+	MUJOCO_ROS_TRACE_SCOPE("save_state", "service");
 	if (!verifyAdminHash(req.admin_hash)) {
-		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to set body state!");
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to save state!");
+		resp.success        = false;
+		resp.status_message = static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to save state!");
+		return true;
+	}
+
+	resp.success = saveState(req.slot);
+	if (!resp.success) {
+		resp.status_message = static_cast<decltype(resp.status_message)>("No model loaded, cannot save state!");
+	}
+	return true;
+}
+
+bool MujocoEnv::dumpTraceCB(mujoco_ros_msgs::DumpTrace::Request &req, mujoco_ros_msgs::DumpTrace::Response &resp)
+{
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to dump trace!");
+		resp.success        = false;
+		resp.status_message = static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to dump trace!");
+		return true;
+	}
+
+	if (!tracing::isEnabled()) {
+		ROS_WARN_NAMED("mujoco", "Tracing is disabled (tracing/enabled), the trace will be empty");
+	}
+
+	resp.path = req.path.empty() ? trace_path_ : req.path;
+	std::size_t num_events;
+	std::string error;
+	resp.success    = tracing::writeChromeTrace(resp.path, req.clear, num_events, error);
+	resp.num_events = static_cast<decltype(resp.num_events)>(num_events);
+	if (!resp.success) {
+		ROS_ERROR_STREAM_NAMED("mujoco", "Failed to dump trace: " << error);
+		resp.status_message = static_cast<decltype(resp.status_message)>(error);
+	} else {
+		ROS_INFO_STREAM_NAMED("mujoco", "Wrote " << num_events << " trace events to " << resp.path);
+	}
+	return true;
+}
+
+bool MujocoEnv::restoreStateCB(mujoco_ros_msgs::RestoreState::Request &req,
+                               mujoco_ros_msgs::RestoreState::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("restore_state", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to restore state!");
 		resp.success = false;
 		resp.status_message =
-		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set body state!");
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to restore state!");
 		return true;
 	}
 
-	std::string full_error_msg("");
-	resp.success = true;
+	resp.success = restoreState(req.slot);
+	if (!resp.success) {
+		resp.status_message = "No saved state in slot '" + req.slot + "'";
+		ROS_WARN_STREAM_NAMED("mujoco", resp.status_message);
+	}
+	return true;
+}
 
-	if (req.state.name.empty()) {
-		std::string error_msg("Body name is empty, cannot set body state!");
-		ROS_WARN_STREAM(error_msg);
-		resp.status_message = error_msg;
+bool MujocoEnv::batchResetCB(mujoco_ros_msgs::BatchReset::Request &req, mujoco_ros_msgs::BatchReset::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("batch_reset", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to reset batch!");
+		resp.success        = false;
+		resp.status_message = static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to reset batch!");
+		return true;
+	}
+
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	if (batch_.size() == 0) {
 		resp.success        = false;
+		resp.status_message = static_cast<decltype(resp.status_message)>("No model loaded, batch is empty!");
 		return true;
 	}
 
-	int body_id = mj_name2id(model_.get(), mjOBJ_BODY, req.state.name.c_str());
+	resp.success = batch_.reset(req.env_ids, threadpool_);
+	if (!resp.success) {
+		resp.status_message = "Environment id out of range, batch has " + std::to_string(batch_.size()) + " environments";
+		ROS_WARN_STREAM_NAMED("mujoco", resp.status_message);
+	}
+	fillBatchObservation(batch_, model_.get(), resp.observation);
+	return true;
+}
+
+bool MujocoEnv::batchStepCB(mujoco_ros_msgs::BatchStep::Request &req, mujoco_ros_msgs::BatchStep::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("batch_step", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to step batch!");
+		resp.success        = false;
+		resp.status_message = static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to step batch!");
+		return true;
+	}
+
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	if (batch_.size() == 0) {
+		resp.success        = false;
+		resp.status_message = static_cast<decltype(resp.status_message)>("No model loaded, batch is empty!");
+		return true;
+	}
+
+	std::string status_message;
+	resp.success = batch_.step(req.actions, static_cast<int>(std::max(req.num_steps, 1u)), threadpool_, status_message);
+	if (!resp.success) {
+		resp.status_message = static_cast<decltype(resp.status_message)>(status_message);
+		ROS_WARN_STREAM_NAMED("mujoco", "Rejected batch step: " << status_message);
+	}
+	fillBatchObservation(batch_, model_.get(), resp.observation);
+	return true;
+}
+
+bool MujocoEnv::batchObserveCB(mujoco_ros_msgs::BatchObserve::Request & /*req*/,
+                               mujoco_ros_msgs::BatchObserve::Response &resp)
+{
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	fillBatchObservation(batch_, model_.get(), resp.observation);
+	return true;
+}
+
+int MujocoEnv::resolveBodyId(const std::string &name, std::string &status_message)
+{
+	if (name.empty()) {
+		status_message = "Body name is empty!";
+		ROS_WARN_STREAM(status_message);
+		return -1;
+	}
+
+	int body_id = name_id_cache_.id(mjOBJ_BODY, name);
 	if (body_id == -1) {
-		ROS_WARN_STREAM("Could not find model (mujoco body) with name " << req.state.name << ". Trying to find geom...");
-		int geom_id = mj_name2id(model_.get(), mjOBJ_GEOM, req.state.name.c_str());
+		ROS_WARN_STREAM("Could not find model (mujoco body) with name " << name << ". Trying to find geom...");
+		int geom_id = name_id_cache_.id(mjOBJ_GEOM, name);
 		if (geom_id == -1) {
-			std::string error_msg("Could not find model (not body nor geom) with name " + req.state.name);
-			ROS_WARN_STREAM(error_msg);
-			resp.status_message = error_msg;
-			resp.success        = false;
-			return true;
+			status_message = "Could not find model (not body nor geom) with name " + name;
+			ROS_WARN_STREAM(status_message);
+			return -1;
 		}
 		body_id = model_->geom_bodyid[geom_id];
 		ROS_WARN_STREAM("found body named '" << mj_id2name(model_.get(), mjOBJ_BODY, body_id) << "' as parent of geom '"
-		                                     << req.state.name << "'");
+		                                     << name << "'");
 	}
+	return body_id;
+}
 
-	if (req.set_mass) {
-		std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
-		ROS_DEBUG_STREAM("\tReplacing mass '" << model_->body_mass[body_id] << "' with new mass '" << req.state.mass
-		                                      << "'");
-		model_->body_mass[body_id] = req.state.mass;
+bool MujocoEnv::setBodyState(mujoco_ros_msgs::BodyState &state, bool set_pose, bool set_twist, bool set_mass,
+                             bool reset_qpos, bool &mass_changed, std::string &status_message)
+{
+	std::string full_error_msg("");
+	bool success = true;
+
+	int body_id = resolveBodyId(state.name, status_message);
+	if (body_id == -1) {
+		return false;
+	}
 
-		std::lock_guard<std::mutex> lk_render(offscreen_.render_mutex); // Prevent rendering the reset to q0
-		mjtNum *qpos_tmp = mj_stackAllocNum(data_.get(), model_->nq);
-		mju_copy(qpos_tmp, data_->qpos, model_->nq);
-		ROS_DEBUG("Copied current qpos state");
-		mj_setConst(model_.get(), data_.get());
-		ROS_DEBUG("Reset constants because of mass change");
-		mju_copy(data_->qpos, qpos_tmp, model_->nq);
-		ROS_DEBUG("Copied qpos state back to data");
+	if (set_mass) {
+		ROS_DEBUG_STREAM("\tReplacing mass '" << model_->body_mass[body_id] << "' with new mass '" << state.mass << "'");
+		model_->body_mass[body_id] = state.mass;
+		mass_changed               = true;
 	}
 
 	int jnt_adr     = model_->body_jntadr[body_id];
@@ -269,47 +454,42 @@ bool MujocoEnv::setBodyStateCB(mujoco_ros_msgs::SetBodyState::Request &req,
 	int jnt_dofadr  = model_->jnt_dofadr[jnt_adr];
 
 	geometry_msgs::PoseStamped target_pose;
-	geometry_msgs::Twist target_twist;
 
-	if (req.set_pose || req.set_twist || req.reset_qpos) {
+	if (set_pose || set_twist || reset_qpos) {
 		if (jnt_adr == -1) { // Check if body has joints
 			std::string error_msg("Body has no joints, cannot move body!");
 			ROS_WARN_STREAM(error_msg);
 			full_error_msg += error_msg + '\n';
-			resp.success = false;
+			success = false;
 		} else if (jnt_type != mjJNT_FREE) { // Only freejoints can be moved
-			std::string error_msg("Body " + req.state.name +
+			std::string error_msg("Body " + state.name +
 			                      " has no joint of type 'freetype'. This service call does not support any other types!");
 			ROS_WARN_STREAM(error_msg);
 			full_error_msg += error_msg + '\n';
-			resp.success = false;
+			success = false;
 		} else if (num_jnt > 1) {
-			std::string error_msg("Body " + req.state.name + " has more than one joint ('" +
+			std::string error_msg("Body " + state.name + " has more than one joint ('" +
 			                      std::to_string(model_->body_jntnum[body_id]) +
 			                      "'), pose/twist changes to bodies with more than one joint are not supported!");
 			ROS_WARN_STREAM(error_msg);
 			full_error_msg += error_msg + '\n';
-			resp.success = false;
+			success = false;
 		} else {
-			// Lock mutex to prevent updating the body while a step is performed
-			std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
-			geometry_msgs::PoseStamped init_pose = req.state.pose;
-
 			// Set freejoint position and quaternion
-			if (req.set_pose && !req.reset_qpos) {
+			if (set_pose && !reset_qpos) {
 				bool valid_pose = true;
-				if (!req.state.pose.header.frame_id.empty() && req.state.pose.header.frame_id != "world") {
+				if (!state.pose.header.frame_id.empty() && state.pose.header.frame_id != "world") {
 					try {
-						tf_bufferPtr_->transform<geometry_msgs::PoseStamped>(req.state.pose, target_pose, "world");
+						tf_bufferPtr_->transform<geometry_msgs::PoseStamped>(state.pose, target_pose, "world");
 					} catch (tf2::TransformException &ex) {
 						ROS_WARN_STREAM(ex.what());
 						full_error_msg +=
-						    "Could not transform frame '" + req.state.pose.header.frame_id + "' to frame world" + '\n';
-						resp.success = false;
-						valid_pose   = false;
+						    "Could not transform frame '" + state.pose.header.frame_id + "' to frame world" + '\n';
+						success    = false;
+						valid_pose = false;
 					}
 				} else {
-					target_pose = req.state.pose;
+					target_pose = state.pose;
 				}
 
 				if (valid_pose) {
@@ -332,87 +512,127 @@ bool MujocoEnv::setBodyStateCB(mujoco_ros_msgs::SetBodyState::Request &req,
 				}
 			}
 
-			if (req.reset_qpos && num_jnt > 0) {
+			if (reset_qpos && num_jnt > 0) {
 				int num_dofs = 7; // Is always 7 because the joint is restricted to one joint of type freejoint
-				ROS_WARN_COND(req.set_pose,
+				ROS_WARN_COND(set_pose,
 				              "set_pose and reset_qpos were both passed. reset_qpos will overwrite the custom pose!");
 				ROS_DEBUG("Resetting body qpos");
 				mju_copy(data_->qpos + model_->jnt_qposadr[jnt_adr], model_->qpos0 + model_->jnt_qposadr[jnt_adr],
 				         num_dofs);
-				if (!req.set_twist) {
+				if (!set_twist) {
 					// Reset twist if no desired twist is given (default twist is 0 0 0 0 0 0)
-					req.set_twist   = true;
-					req.state.twist = geometry_msgs::TwistStamped();
+					set_twist   = true;
+					state.twist = geometry_msgs::TwistStamped();
 				}
 			}
 			// Set freejoint twist
-			if (req.set_twist) {
+			if (set_twist) {
 				// Only pose can be transformed. Twist will be ignored!
-				if (!req.state.twist.header.frame_id.empty() && req.state.twist.header.frame_id != "world") {
+				if (!state.twist.header.frame_id.empty() && state.twist.header.frame_id != "world") {
 					std::string error_msg("Transforming twists from other frames is not supported! Not setting twist.");
 					ROS_WARN_STREAM(error_msg);
 					full_error_msg += error_msg + '\n';
-					resp.success = false;
+					success = false;
 				} else {
 					ROS_DEBUG_STREAM("Setting body twist to "
-					                 << req.state.twist.twist.linear.x << ", " << req.state.twist.twist.linear.y << ", "
-					                 << req.state.twist.twist.linear.z << ", " << req.state.twist.twist.angular.x << ", "
-					                 << req.state.twist.twist.angular.y << ", " << req.state.twist.twist.angular.z
+					                 << state.twist.twist.linear.x << ", " << state.twist.twist.linear.y << ", "
+					                 << state.twist.twist.linear.z << ", " << state.twist.twist.angular.x << ", "
+					                 << state.twist.twist.angular.y << ", " << state.twist.twist.angular.z
 					                 << " (xyz rpy)");
-					data_->qvel[jnt_dofadr]     = req.state.twist.twist.linear.x;
-					data_->qvel[jnt_dofadr + 1] = req.state.twist.twist.linear.y;
-					data_->qvel[jnt_dofadr + 2] = req.state.twist.twist.linear.z;
-					data_->qvel[jnt_dofadr + 3] = req.state.twist.twist.angular.x;
-					data_->qvel[jnt_dofadr + 4] = req.state.twist.twist.angular.y;
-					data_->qvel[jnt_dofadr + 5] = req.state.twist.twist.angular.z;
+					data_->qvel[jnt_dofadr]     = state.twist.twist.linear.x;
+					data_->qvel[jnt_dofadr + 1] = state.twist.twist.linear.y;
+					data_->qvel[jnt_dofadr + 2] = state.twist.twist.linear.z;
+					data_->qvel[jnt_dofadr + 3] = state.twist.twist.angular.x;
+					data_->qvel[jnt_dofadr + 4] = state.twist.twist.angular.y;
+					data_->qvel[jnt_dofadr + 5] = state.twist.twist.angular.z;
 				}
 			}
 		}
 	}
 
-	resp.status_message = full_error_msg;
-	return true;
+	status_message = full_error_msg;
+	return success;
 }
 
-bool MujocoEnv::getBodyStateCB(mujoco_ros_msgs::GetBodyState::Request &req,
-                               mujoco_ros_msgs::GetBodyState::Response &resp)
+void MujocoEnv::recomputeConstants()
 {
+	std::lock_guard<std::mutex> lk_render(offscreen_.render_mutex); // Prevent rendering the reset to q0
+	mjtNum *qpos_tmp = mj_stackAllocNum(data_.get(), model_->nq);
+	mju_copy(qpos_tmp, data_->qpos, model_->nq);
+	ROS_DEBUG("Copied current qpos state");
+	mj_setConst(model_.get(), data_.get());
+	ROS_DEBUG("Reset constants because of mass change");
+	mju_copy(data_->qpos, qpos_tmp, model_->nq);
+	ROS_DEBUG("Copied qpos state back to data");
+}
+
+bool MujocoEnv::setBodyStateCB(mujoco_ros_msgs::SetBodyState::Request &req,
+                               mujoco_ros_msgs::SetBodyState::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("set_body_state", "service");
 	if (!verifyAdminHash(req.admin_hash)) {
-		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to get body state!");
-		resp.status_message =
-		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to get body state!");
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to set body state!");
 		resp.success = false;
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set body state!");
 		return true;
 	}
 
-	if (req.name.empty()) {
-		std::string error_msg("Body name is empty, cannot get body state!");
-		ROS_WARN_STREAM(error_msg);
-		resp.status_message = error_msg;
-		resp.success        = false;
+	// Lock mutex to prevent updating the body while a step is performed
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	bool mass_changed = false;
+	resp.success      = setBodyState(req.state, req.set_pose, req.set_twist, req.set_mass, req.reset_qpos, mass_changed,
+	                                 resp.status_message);
+	if (mass_changed) {
+		recomputeConstants();
+	}
+	return true;
+}
+
+bool MujocoEnv::setBodyStatesCB(mujoco_ros_msgs::SetBodyStates::Request &req,
+                                mujoco_ros_msgs::SetBodyStates::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("set_body_states", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to set body states!");
+		resp.success = false;
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set body states!");
 		return true;
 	}
 
 	resp.success = true;
+	resp.entry_success.resize(req.states.size());
+	resp.entry_status.resize(req.states.size());
+
+	// Apply all updates within the same step
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	bool mass_changed = false;
+	for (size_t i = 0; i < req.states.size(); ++i) {
+		resp.entry_success[i] = setBodyState(req.states[i], req.set_pose, req.set_twist, req.set_mass, req.reset_qpos,
+		                                     mass_changed, resp.entry_status[i]);
+		resp.success          = resp.success && resp.entry_success[i];
+	}
+	if (mass_changed) {
+		recomputeConstants();
+	}
+	mj_forward(model_.get(), data_.get());
+
+	if (!resp.success) {
+		resp.status_message = "Failed to set some body states, see entry_status for details";
+	}
+	return true;
+}
 
-	int body_id = mj_name2id(model_.get(), mjOBJ_BODY, req.name.c_str());
+bool MujocoEnv::getBodyState(const std::string &name, mujoco_ros_msgs::BodyState &state, std::string &status_message)
+{
+	int body_id = resolveBodyId(name, status_message);
 	if (body_id == -1) {
-		ROS_WARN_STREAM("Could not find model (mujoco body) with name " << req.name << ". Trying to find geom...");
-		int geom_id = mj_name2id(model_.get(), mjOBJ_GEOM, req.name.c_str());
-		if (geom_id == -1) {
-			std::string error_msg("Could not find model (not body nor geom) with name " + req.name);
-			ROS_WARN_STREAM(error_msg);
-			resp.status_message = error_msg;
-			resp.success        = false;
-			return true;
-		}
-		body_id = model_->geom_bodyid[geom_id];
-		ROS_WARN_STREAM("found body named '" << mj_id2name(model_.get(), mjOBJ_BODY, body_id) << "' as parent of geom '"
-		                                     << req.name << "'");
+		return false;
 	}
 
-	resp.state.name = mj_id2name(model_.get(), mjOBJ_BODY, body_id);
-	resp.state.mass = static_cast<decltype(resp.state.mass)>(model_->body_mass[body_id]);
+	state.name = mj_id2name(model_.get(), mjOBJ_BODY, body_id);
+	state.mass = static_cast<decltype(state.mass)>(model_->body_mass[body_id]);
 
 	int jnt_adr     = model_->body_jntadr[body_id];
 	int jnt_type    = model_->jnt_type[jnt_adr];
@@ -420,56 +640,99 @@ bool MujocoEnv::getBodyStateCB(mujoco_ros_msgs::GetBodyState::Request &req,
 	int jnt_qposadr = model_->jnt_qposadr[jnt_adr];
 	int jnt_dofadr  = model_->jnt_dofadr[jnt_adr];
 
-	geometry_msgs::PoseStamped target_pose;
-	geometry_msgs::Twist target_twist;
+	if (jnt_adr == -1 || jnt_type != mjJNT_FREE || num_jnt > 1) {
+		state.pose.header             = std_msgs::Header();
+		state.pose.header.frame_id    = "world";
+		state.pose.pose.position.x    = data_->xpos[body_id * 3];
+		state.pose.pose.position.y    = data_->xpos[body_id * 3 + 1];
+		state.pose.pose.position.z    = data_->xpos[body_id * 3 + 2];
+		state.pose.pose.orientation.w = data_->xquat[body_id * 4];
+		state.pose.pose.orientation.x = data_->xquat[body_id * 4 + 1];
+		state.pose.pose.orientation.y = data_->xquat[body_id * 4 + 2];
+		state.pose.pose.orientation.z = data_->xquat[body_id * 4 + 3];
+
+		state.twist.header          = std_msgs::Header();
+		state.twist.header.frame_id = "world";
+		state.twist.twist.linear.x  = data_->cvel[body_id * 6];
+		state.twist.twist.linear.y  = data_->cvel[body_id * 6 + 1];
+		state.twist.twist.linear.z  = data_->cvel[body_id * 6 + 2];
+		state.twist.twist.angular.x = data_->cvel[body_id * 6 + 3];
+		state.twist.twist.angular.y = data_->cvel[body_id * 6 + 4];
+		state.twist.twist.angular.z = data_->cvel[body_id * 6 + 5];
+	} else {
+		state.pose.header             = std_msgs::Header();
+		state.pose.header.frame_id    = "world";
+		state.pose.pose.position.x    = data_->qpos[jnt_qposadr];
+		state.pose.pose.position.y    = data_->qpos[jnt_qposadr + 1];
+		state.pose.pose.position.z    = data_->qpos[jnt_qposadr + 2];
+		state.pose.pose.orientation.w = data_->qpos[jnt_qposadr + 3];
+		state.pose.pose.orientation.x = data_->qpos[jnt_qposadr + 4];
+		state.pose.pose.orientation.y = data_->qpos[jnt_qposadr + 5];
+		state.pose.pose.orientation.z = data_->qpos[jnt_qposadr + 6];
+
+		state.twist.header          = std_msgs::Header();
+		state.twist.header.frame_id = "world";
+		state.twist.twist.linear.x  = data_->qvel[jnt_dofadr];
+		state.twist.twist.linear.y  = data_->qvel[jnt_dofadr + 1];
+		state.twist.twist.linear.z  = data_->qvel[jnt_dofadr + 2];
+		state.twist.twist.angular.x = data_->qvel[jnt_dofadr + 3];
+		state.twist.twist.angular.y = data_->qvel[jnt_dofadr + 4];
+		state.twist.twist.angular.z = data_->qvel[jnt_dofadr + 5];
+	}
+	return true;
+}
+
+bool MujocoEnv::getBodyStateCB(mujoco_ros_msgs::GetBodyState::Request &req,
+                               mujoco_ros_msgs::GetBodyState::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("get_body_state", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to get body state!");
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to get body state!");
+		resp.success = false;
+		return true;
+	}
 
 	// Stop sim to get data out of the same point in time
 	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
-	if (jnt_adr == -1 || jnt_type != mjJNT_FREE || num_jnt > 1) {
-		resp.state.pose.header             = std_msgs::Header();
-		resp.state.pose.header.frame_id    = "world";
-		resp.state.pose.pose.position.x    = data_->xpos[body_id * 3];
-		resp.state.pose.pose.position.y    = data_->xpos[body_id * 3 + 1];
-		resp.state.pose.pose.position.z    = data_->xpos[body_id * 3 + 2];
-		resp.state.pose.pose.orientation.w = data_->xquat[body_id * 4];
-		resp.state.pose.pose.orientation.x = data_->xquat[body_id * 4 + 1];
-		resp.state.pose.pose.orientation.y = data_->xquat[body_id * 4 + 2];
-		resp.state.pose.pose.orientation.z = data_->xquat[body_id * 4 + 3];
-
-		resp.state.twist.header          = std_msgs::Header();
-		resp.state.twist.header.frame_id = "world";
-		resp.state.twist.twist.linear.x  = data_->cvel[body_id * 6];
-		resp.state.twist.twist.linear.y  = data_->cvel[body_id * 6 + 1];
-		resp.state.twist.twist.linear.z  = data_->cvel[body_id * 6 + 2];
-		resp.state.twist.twist.angular.x = data_->cvel[body_id * 6 + 3];
-		resp.state.twist.twist.angular.y = data_->cvel[body_id * 6 + 4];
-		resp.state.twist.twist.angular.z = data_->cvel[body_id * 6 + 5];
-	} else {
-		resp.state.pose.header             = std_msgs::Header();
-		resp.state.pose.header.frame_id    = "world";
-		resp.state.pose.pose.position.x    = data_->qpos[jnt_qposadr];
-		resp.state.pose.pose.position.y    = data_->qpos[jnt_qposadr + 1];
-		resp.state.pose.pose.position.z    = data_->qpos[jnt_qposadr + 2];
-		resp.state.pose.pose.orientation.w = data_->qpos[jnt_qposadr + 3];
-		resp.state.pose.pose.orientation.x = data_->qpos[jnt_qposadr + 4];
-		resp.state.pose.pose.orientation.y = data_->qpos[jnt_qposadr + 5];
-		resp.state.pose.pose.orientation.z = data_->qpos[jnt_qposadr + 6];
-
-		resp.state.twist.header          = std_msgs::Header();
-		resp.state.twist.header.frame_id = "world";
-		resp.state.twist.twist.linear.x  = data_->qvel[jnt_dofadr];
-		resp.state.twist.twist.linear.y  = data_->qvel[jnt_dofadr + 1];
-		resp.state.twist.twist.linear.z  = data_->qvel[jnt_dofadr + 2];
-		resp.state.twist.twist.angular.x = data_->qvel[jnt_dofadr + 3];
-		resp.state.twist.twist.angular.y = data_->qvel[jnt_dofadr + 4];
-		resp.state.twist.twist.angular.z = data_->qvel[jnt_dofadr + 5];
+	resp.success = getBodyState(req.name, resp.state, resp.status_message);
+	return true;
+}
+
+bool MujocoEnv::getBodyStatesCB(mujoco_ros_msgs::GetBodyStates::Request &req,
+                                mujoco_ros_msgs::GetBodyStates::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("get_body_states", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR_NAMED("mujoco", "Hash mismatch, no permission to get body states!");
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to get body states!");
+		resp.success = false;
+		return true;
+	}
+
+	resp.success = true;
+	resp.states.resize(req.names.size());
+	resp.entry_success.resize(req.names.size());
+	resp.entry_status.resize(req.names.size());
+
+	// Stop sim to get all states from the same point in time
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	for (size_t i = 0; i < req.names.size(); ++i) {
+		resp.entry_success[i] = getBodyState(req.names[i], resp.states[i], resp.entry_status[i]);
+		resp.success          = resp.success && resp.entry_success[i];
 	}
 
+	if (!resp.success) {
+		resp.status_message = "Failed to get some body states, see entry_status for details";
+	}
 	return true;
 }
 
 bool MujocoEnv::setGravityCB(mujoco_ros_msgs::SetGravity::Request &req, mujoco_ros_msgs::SetGravity::Response &resp)
 {
+	MUJOCO_ROS_TRACE_SCOPE("set_gravity", "service");
 	if (!verifyAdminHash(req.admin_hash)) {
 		ROS_ERROR("Hash mismatch, no permission to set gravity!");
 		resp.status_message = static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set gravity!");
@@ -488,6 +751,7 @@ bool MujocoEnv::setGravityCB(mujoco_ros_msgs::SetGravity::Request &req, mujoco_r
 
 bool MujocoEnv::getGravityCB(mujoco_ros_msgs::GetGravity::Request &req, mujoco_ros_msgs::GetGravity::Response &resp)
 {
+	MUJOCO_ROS_TRACE_SCOPE("get_gravity", "service");
 	if (!verifyAdminHash(req.admin_hash)) {
 		ROS_ERROR("Hash mismatch, no permission to get gravity!");
 		resp.status_message = static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to get gravity!");
@@ -504,99 +768,151 @@ bool MujocoEnv::getGravityCB(mujoco_ros_msgs::GetGravity::Request &req, mujoco_r
 	return true;
 }
 
-bool MujocoEnv::setGeomPropertiesCB(mujoco_ros_msgs::SetGeomProperties::Request &req,
-                                    mujoco_ros_msgs::SetGeomProperties::Response &resp)
+bool MujocoEnv::setGeomProperties(const mujoco_ros_msgs::GeomProperties &properties, bool set_type, bool set_mass,
+                                  bool set_friction, bool set_size, bool &changed, bool &mass_changed,
+                                  std::string &status_message)
 {
-	if (!verifyAdminHash(req.admin_hash)) {
-		ROS_ERROR("Hash mismatch, no permission to set geom properties!");
-		resp.status_message =
-		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set geom properties!");
-		resp.success = false;
-		return true;
-	}
-
-	if (req.properties.name.empty()) {
-		std::string error_msg("Geom name is empty, cannot set geom properties!");
-		ROS_WARN_STREAM(error_msg);
-		resp.status_message = error_msg;
-		resp.success        = false;
-		return true;
+	if (properties.name.empty()) {
+		status_message = "Geom name is empty, cannot set geom properties!";
+		ROS_WARN_STREAM(status_message);
+		return false;
 	}
 
-	int geom_id = mj_name2id(model_.get(), mjOBJ_GEOM, req.properties.name.c_str());
+	int geom_id = name_id_cache_.id(mjOBJ_GEOM, properties.name);
 	if (geom_id == -1) {
-		std::string error_msg("Could not find model (mujoco geom) with name " + req.properties.name);
-		ROS_WARN_STREAM(error_msg);
-		resp.status_message = error_msg;
-		resp.success        = false;
-		return true;
+		status_message = "Could not find model (mujoco geom) with name " + properties.name;
+		ROS_WARN_STREAM(status_message);
+		return false;
 	}
 
 	int body_id = model_->geom_bodyid[geom_id];
 
-	// Lock mutex to prevent updating the body while a step is performed
-	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
-
-	ROS_DEBUG_STREAM("Changing properties of geom '" << req.properties.name.c_str() << "' ...");
-	if (req.set_mass) {
+	ROS_DEBUG_STREAM("Changing properties of geom '" << properties.name.c_str() << "' ...");
+	if (set_mass) {
 		ROS_DEBUG_STREAM("\tReplacing mass '" << model_->body_mass[body_id] << "' with new mass '"
-		                                      << req.properties.body_mass << "'");
-		model_->body_mass[body_id] = req.properties.body_mass;
+		                                      << properties.body_mass << "'");
+		// Keep the mass distribution of the body by scaling its inertia along with the mass
+		if (model_->body_mass[body_id] > mjMINVAL) {
+			mju_scl3(model_->body_inertia + 3 * body_id, model_->body_inertia + 3 * body_id,
+			         properties.body_mass / model_->body_mass[body_id]);
+		}
+		model_->body_mass[body_id] = properties.body_mass;
+		changed                    = true;
+		mass_changed               = true;
 	}
-	if (req.set_friction) {
+	if (set_friction) {
 		ROS_DEBUG_STREAM("\tReplacing friction '"
 		                 << model_->geom_friction[geom_id * 3] << ", " << model_->geom_friction[geom_id * 3 + 1] << ", "
-		                 << model_->geom_friction[geom_id * 3 + 2] << "' with new mass '" << req.properties.friction_slide
-		                 << ", " << req.properties.friction_spin << ", " << req.properties.friction_roll << "'");
-		model_->geom_friction[geom_id * 3]     = req.properties.friction_slide;
-		model_->geom_friction[geom_id * 3 + 1] = req.properties.friction_spin;
-		model_->geom_friction[geom_id * 3 + 2] = req.properties.friction_roll;
-	}
-	if (req.set_type) {
-		ROS_DEBUG_STREAM("\tReplacing type '" << model_->geom_type[geom_id] << "' with new type '" << req.properties.type
-		                                      << "'");
-		model_->geom_type[geom_id] = req.properties.type.value;
+		                 << model_->geom_friction[geom_id * 3 + 2] << "' with new friction '" << properties.friction_slide
+		                 << ", " << properties.friction_spin << ", " << properties.friction_roll << "'");
+		model_->geom_friction[geom_id * 3]     = properties.friction_slide;
+		model_->geom_friction[geom_id * 3 + 1] = properties.friction_spin;
+		model_->geom_friction[geom_id * 3 + 2] = properties.friction_roll;
 	}
-
-	if (req.set_size) {
-		if (static_cast<mjtNum>(req.properties.size_0 * req.properties.size_1 * req.properties.size_2) >
-		    model_->geom_size[geom_id * 3] * model_->geom_size[geom_id * 3 + 1] * model_->geom_size[geom_id * 3 + 2]) {
-			ROS_WARN_STREAM("New geom size is bigger than the old size. AABBs are not recomputed, this might cause "
-			                "incorrect collisions!");
+	if (set_type) {
+		ROS_DEBUG_STREAM("\tReplacing type '" << model_->geom_type[geom_id] << "' with new type '" << properties.type
+		                                      << "'");
+		model_->geom_type[geom_id] = properties.type.value;
+		changed                    = true;
+		// The current size is kept and bounds are computed from it, unused components may be 0 for the new type
+		if (!set_size && !util::geomSizeValid(properties.type.value, model_->geom_size + 3 * geom_id)) {
+			ROS_WARN_STREAM("Size of geom '" << properties.name << "' is degenerate for type " << properties.type
+			                                 << ", set the size along with the type!");
 		}
+	}
 
+	if (set_size) {
 		ROS_DEBUG_STREAM("\tReplacing size '"
 		                 << model_->geom_size[geom_id * 3] << ", " << model_->geom_size[geom_id * 3 + 1] << ", "
-		                 << model_->geom_size[geom_id * 3 + 2] << "' with new size '" << req.properties.size_0 << ", "
-		                 << req.properties.size_1 << ", " << req.properties.size_2 << "'");
-		model_->geom_size[geom_id * 3]     = req.properties.size_0;
-		model_->geom_size[geom_id * 3 + 1] = req.properties.size_1;
-		model_->geom_size[geom_id * 3 + 2] = req.properties.size_2;
+		                 << model_->geom_size[geom_id * 3 + 2] << "' with new size '" << properties.size_0 << ", "
+		                 << properties.size_1 << ", " << properties.size_2 << "'");
+		model_->geom_size[geom_id * 3]     = properties.size_0;
+		model_->geom_size[geom_id * 3 + 1] = properties.size_1;
+		model_->geom_size[geom_id * 3 + 2] = properties.size_2;
+		changed                            = true;
+	}
 
-		mj_forward(model_.get(), data_.get());
+	if (set_type || set_size) {
+		if (util::updateGeomBounds(model_.get(), geom_id)) {
+			util::updateBodyBVH(model_.get(), geom_id);
+		} else {
+			ROS_WARN_STREAM("Geom '" << properties.name
+			                         << "' is not a primitive. AABBs are not recomputed, this might cause incorrect "
+			                            "collisions!");
+		}
 	}
 
-	if (req.set_type || req.set_mass) {
-		std::lock_guard<std::mutex> lk_render(offscreen_.render_mutex); // Prevent rendering the reset to q0
+	notifyGeomChanged(geom_id);
+	return true;
+}
 
-		mjtNum *qpos_tmp = mj_stackAllocNum(data_.get(), model_->nq);
-		mju_copy(qpos_tmp, data_->qpos, model_->nq);
-		ROS_DEBUG("Copied current qpos state");
-		mj_setConst(model_.get(), data_.get());
-		ROS_DEBUG("Reset constants");
-		mju_copy(data_->qpos, qpos_tmp, model_->nq);
-		ROS_DEBUG("Copied qpos state back to data");
+bool MujocoEnv::setGeomPropertiesCB(mujoco_ros_msgs::SetGeomProperties::Request &req,
+                                    mujoco_ros_msgs::SetGeomProperties::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("set_geom_properties", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR("Hash mismatch, no permission to set geom properties!");
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set geom properties!");
+		resp.success = false;
+		return true;
 	}
 
-	notifyGeomChanged(geom_id);
+	// Lock mutex to prevent updating the body while a step is performed
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	bool changed = false, mass_changed = false;
+	resp.success = setGeomProperties(req.properties, req.set_type, req.set_mass, req.set_friction, req.set_size,
+	                                 changed, mass_changed, resp.status_message);
+	if (mass_changed) {
+		recomputeConstants();
+	}
+	if (changed) {
+		mj_forward(model_.get(), data_.get());
+	}
+	return true;
+}
+
+bool MujocoEnv::setGeomPropertiesArrayCB(mujoco_ros_msgs::SetGeomPropertiesArray::Request &req,
+                                         mujoco_ros_msgs::SetGeomPropertiesArray::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("set_geom_properties_array", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR("Hash mismatch, no permission to set geom properties!");
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set geom properties!");
+		resp.success = false;
+		return true;
+	}
 
 	resp.success = true;
+	resp.entry_success.resize(req.properties.size());
+	resp.entry_status.resize(req.properties.size());
+
+	// Apply all changes within the same step, recompute constants and kinematics at most once
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	bool changed = false, mass_changed = false;
+	for (size_t i = 0; i < req.properties.size(); ++i) {
+		resp.entry_success[i] = setGeomProperties(req.properties[i], req.set_type, req.set_mass, req.set_friction,
+		                                          req.set_size, changed, mass_changed, resp.entry_status[i]);
+		resp.success          = resp.success && resp.entry_success[i];
+	}
+	if (mass_changed) {
+		recomputeConstants();
+	}
+	if (changed) {
+		mj_forward(model_.get(), data_.get());
+	}
+
+	if (!resp.success) {
+		resp.status_message = "Failed to set some geom properties, see entry_status for details";
+	}
 	return true;
 }
 
 bool MujocoEnv::getGeomPropertiesCB(mujoco_ros_msgs::GetGeomProperties::Request &req,
                                     mujoco_ros_msgs::GetGeomProperties::Response &resp)
 {
+	MUJOCO_ROS_TRACE_SCOPE("get_geom_properties", "service");
 	if (!verifyAdminHash(req.admin_hash)) {
 		ROS_ERROR("Hash mismatch, no permission to get geom properties!");
 		resp.status_message =
@@ -649,18 +965,18 @@ bool MujocoEnv::setEqualityConstraintParameters(const mujoco_ros_msgs::EqualityC
 {
 	// look up equality constraint by name
 	ROS_DEBUG_STREAM("Looking up eqc by name '" << parameters.name << "'");
-	int eq_id = mj_name2id(model_.get(), mjOBJ_EQUALITY, parameters.name.c_str());
+	int eq_id = name_id_cache_.id(mjOBJ_EQUALITY, parameters.name);
 	if (eq_id != -1) {
 		ROS_DEBUG_STREAM("Found eqc by name '" << parameters.name << "'");
 		int id1, id2;
 		switch (parameters.type.value) {
 			case mjEQ_TENDON:
-				id1 = mj_name2id(model_.get(), mjOBJ_TENDON, parameters.element1.c_str());
+				id1 = name_id_cache_.id(mjOBJ_TENDON, parameters.element1);
 				if (id1 != -1) {
 					model_->eq_obj1id[eq_id] = id1;
 				}
 				if (!parameters.element2.empty()) {
-					id2 = mj_name2id(model_.get(), mjOBJ_TENDON, parameters.element2.c_str());
+					id2 = name_id_cache_.id(mjOBJ_TENDON, parameters.element2);
 					if (id2 != -1) {
 						model_->eq_obj2id[eq_id] = id2;
 					}
@@ -672,12 +988,12 @@ bool MujocoEnv::setEqualityConstraintParameters(const mujoco_ros_msgs::EqualityC
 				model_->eq_data[eq_id * mjNEQDATA + 4] = parameters.polycoef[4];
 				break;
 			case mjEQ_WELD:
-				id1 = mj_name2id(model_.get(), mjOBJ_XBODY, parameters.element1.c_str());
+				id1 = name_id_cache_.id(mjOBJ_XBODY, parameters.element1);
 				if (id1 != -1) {
 					model_->eq_obj1id[eq_id] = id1;
 				}
 				if (!parameters.element2.empty()) {
-					id2 = mj_name2id(model_.get(), mjOBJ_XBODY, parameters.element2.c_str());
+					id2 = name_id_cache_.id(mjOBJ_XBODY, parameters.element2);
 					if (id2 != -1) {
 						model_->eq_obj2id[eq_id] = id2;
 					}
@@ -695,12 +1011,12 @@ bool MujocoEnv::setEqualityConstraintParameters(const mujoco_ros_msgs::EqualityC
 				model_->eq_data[eq_id * mjNEQDATA + 10] = parameters.torquescale;
 				break;
 			case mjEQ_JOINT:
-				id1 = mj_name2id(model_.get(), mjOBJ_JOINT, parameters.element1.c_str());
+				id1 = name_id_cache_.id(mjOBJ_JOINT, parameters.element1);
 				if (id1 != -1) {
 					model_->eq_obj1id[eq_id] = id1;
 				}
 				if (!parameters.element2.empty()) {
-					id2 = mj_name2id(model_.get(), mjOBJ_JOINT, parameters.element2.c_str());
+					id2 = name_id_cache_.id(mjOBJ_JOINT, parameters.element2);
 					if (id2 != -1) {
 						model_->eq_obj2id[eq_id] = id2;
 					}
@@ -712,12 +1028,12 @@ bool MujocoEnv::setEqualityConstraintParameters(const mujoco_ros_msgs::EqualityC
 				model_->eq_data[eq_id * mjNEQDATA + 4] = parameters.polycoef[4];
 				break;
 			case mjEQ_CONNECT:
-				id1 = mj_name2id(model_.get(), mjOBJ_XBODY, parameters.element1.c_str());
+				id1 = name_id_cache_.id(mjOBJ_XBODY, parameters.element1);
 				if (id1 != -1) {
 					model_->eq_obj1id[eq_id] = id1;
 				}
 				if (!parameters.element2.empty()) {
-					id2 = mj_name2id(model_.get(), mjOBJ_XBODY, parameters.element2.c_str());
+					id2 = name_id_cache_.id(mjOBJ_XBODY, parameters.element2);
 
 					if (id2 != -1) {
 						model_->eq_obj2id[eq_id] = id2;
@@ -747,6 +1063,7 @@ bool MujocoEnv::setEqualityConstraintParameters(const mujoco_ros_msgs::EqualityC
 bool MujocoEnv::setEqualityConstraintParametersArrayCB(mujoco_ros_msgs::SetEqualityConstraintParameters::Request &req,
                                                        mujoco_ros_msgs::SetEqualityConstraintParameters::Response &resp)
 {
+	MUJOCO_ROS_TRACE_SCOPE("set_eq_constraint_parameters", "service");
 	if (!verifyAdminHash(req.admin_hash)) {
 		ROS_ERROR("Hash mismatch, no permission to set equality constraints!");
 		resp.status_message =
@@ -758,10 +1075,17 @@ bool MujocoEnv::setEqualityConstraintParametersArrayCB(mujoco_ros_msgs::SetEqual
 
 	bool failed_any    = false;
 	bool succeeded_any = false;
-	for (const auto &parameters : req.parameters) {
-		bool success  = setEqualityConstraintParameters(parameters);
-		failed_any    = (failed_any || !success);
-		succeeded_any = (succeeded_any || success);
+	{
+		// Apply all constraints within the same step
+		std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+		for (const auto &parameters : req.parameters) {
+			bool success  = setEqualityConstraintParameters(parameters);
+			failed_any    = (failed_any || !success);
+			succeeded_any = (succeeded_any || success);
+		}
+		if (succeeded_any) {
+			mj_forward(model_.get(), data_.get());
+		}
 	}
 
 	if (succeeded_any && failed_any) {
@@ -775,11 +1099,88 @@ bool MujocoEnv::setEqualityConstraintParametersArrayCB(mujoco_ros_msgs::SetEqual
 	return true;
 }
 
+bool MujocoEnv::setEqualityConstraintsCompactCB(mujoco_ros_msgs::SetEqualityConstraintsCompact::Request &req,
+                                                 mujoco_ros_msgs::SetEqualityConstraintsCompact::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("set_eq_constraints_compact", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR("Hash mismatch, no permission to set equality constraints!");
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to set equality constraints!");
+		resp.success = false;
+		return true;
+	}
+
+	const size_t num = req.ids.size();
+	if ((!req.active.empty() && req.active.size() != num) || (!req.data.empty() && req.data.size() != num * mjNEQDATA)) {
+		resp.status_message = static_cast<decltype(resp.status_message)>(
+		    "active must be empty or have one entry per id, data must be empty or have mjNEQDATA entries per id");
+		ROS_WARN_STREAM(resp.status_message);
+		resp.success = false;
+		return true;
+	}
+
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	for (const int eq_id : req.ids) {
+		if (eq_id < 0 || eq_id >= model_->neq) {
+			resp.status_message = static_cast<decltype(resp.status_message)>("Equality constraint id " +
+			                                                                 std::to_string(eq_id) + " out of range");
+			ROS_WARN_STREAM(resp.status_message);
+			resp.success = false;
+			return true;
+		}
+	}
+
+	for (size_t i = 0; i < num; ++i) {
+		const int eq_id = req.ids[i];
+		if (!req.active.empty()) {
+			data_->eq_active[eq_id] = req.active[i];
+		}
+		if (!req.data.empty()) {
+			mju_copy(model_->eq_data + eq_id * mjNEQDATA, req.data.data() + i * mjNEQDATA, mjNEQDATA);
+		}
+	}
+	if (num > 0) {
+		mj_forward(model_.get(), data_.get());
+	}
+
+	resp.success = true;
+	return true;
+}
+
+bool MujocoEnv::getEqualityConstraintIdsCB(mujoco_ros_msgs::GetEqualityConstraintIds::Request &req,
+                                           mujoco_ros_msgs::GetEqualityConstraintIds::Response &resp)
+{
+	MUJOCO_ROS_TRACE_SCOPE("get_eq_constraint_ids", "service");
+	if (!verifyAdminHash(req.admin_hash)) {
+		ROS_ERROR("Hash mismatch, no permission to get equality constraints!");
+		resp.status_message =
+		    static_cast<decltype(resp.status_message)>("Hash mismatch, no permission to get equality constraints!");
+		resp.success = false;
+		return true;
+	}
+
+	std::lock_guard<std::recursive_mutex> lk_sim(physics_thread_mutex_);
+	resp.success = true;
+	resp.ids.resize(req.names.size());
+	for (size_t i = 0; i < req.names.size(); ++i) {
+		resp.ids[i] = name_id_cache_.id(mjOBJ_EQUALITY, req.names[i]);
+		if (resp.ids[i] == -1) {
+			ROS_WARN_STREAM("Could not find equality constraint named '" << req.names[i] << "'");
+			resp.success = false;
+		}
+	}
+	if (!resp.success) {
+		resp.status_message = static_cast<decltype(resp.status_message)>("Not all constraints could be found");
+	}
+	return true;
+}
+
 bool MujocoEnv::getEqualityConstraintParameters(mujoco_ros_msgs::EqualityConstraintParameters &parameters)
 {
 	ROS_DEBUG_STREAM("Looking up Eq Constraint '" << parameters.name << "'");
 	// look up equality constraint by name
-	int eq_id = mj_name2id(model_.get(), mjOBJ_EQUALITY, parameters.name.c_str());
+	int eq_id = name_id_cache_.id(mjOBJ_EQUALITY, parameters.name);
 	if (eq_id != -1) {
 		ROS_DEBUG("Found Eq Constraint");
 		parameters.type.value = model_->eq_type[eq_id];
@@ -848,6 +1249,7 @@ bool MujocoEnv::getEqualityConstraintParameters(mujoco_ros_msgs::EqualityConstra
 bool MujocoEnv::getEqualityConstraintParametersArrayCB(mujoco_ros_msgs::GetEqualityConstraintParameters::Request &req,
                                                        mujoco_ros_msgs::GetEqualityConstraintParameters::Response &resp)
 {
+	MUJOCO_ROS_TRACE_SCOPE("get_eq_constraint_parameters", "service");
 	if (!verifyAdminHash(req.admin_hash)) {
 		ROS_ERROR("Hash mismatch, no permission to get equality constraints!");
 		resp.status_message =
@@ -893,6 +1295,8 @@ bool MujocoEnv::getStateUintCB(mujoco_ros_msgs::GetStateUint::Request & /*req*/,
 		description = "Sim ready";
 	else if (status == 1)
 		description = "Loading in progress";
+	else if (status == 4)
+		description = "Compiling model";
 	else if (status >= 2)
 		description = "Loading issued";
 	resp.state.description = description;
@@ -912,29 +1316,12 @@ bool MujocoEnv::getSimInfoCB(mujoco_ros_msgs::GetSimInfo::Request & /*req*/,
 	resp.state.paused            = !settings_.run.load();
 	resp.state.pending_sim_steps = settings_.env_steps_request.load();
 	resp.state.rt_measured       = 1.f / sim_state_.measured_slowdown;
-	resp.state.rt_setting        = percentRealTime[settings_.real_time_index] / 100.f;
+	resp.state.rt_setting        = settings_.rt_factor.load();
+	resp.state.pacing_resyncs    = pacer_.resyncs();
+	fillLatencyStats(pacer_.jitter(), resp.state.pacing_jitter, false);
 	return true;
 }
 
-// Helper function to retrieve the real-time factor closest to the requested value
-// adapted from https://www.geeksforgeeks.org/find-closest-number-array/
-float findClosestRecursive(const float arr[], uint left, uint right, float target)
-{
-	if (left == right) {
-		return arr[left];
-	}
-
-	uint mid            = (left + right) / 2;
-	float left_closest  = findClosestRecursive(arr, left, mid, target);
-	float right_closest = findClosestRecursive(arr, mid + 1, right, target);
-
-	if (abs(left_closest - target) <= abs(right_closest - target)) {
-		return left_closest;
-	} else {
-		return right_closest;
-	}
-}
-
 bool MujocoEnv::setRTFactorCB(mujoco_ros_msgs::SetFloat::Request &req, mujoco_ros_msgs::SetFloat::Response &resp)
 {
 	if (!verifyAdminHash(req.admin_hash)) {
@@ -945,31 +1332,24 @@ bool MujocoEnv::setRTFactorCB(mujoco_ros_msgs::SetFloat::Request &req, mujoco_ro
 	resp.success = true;
 
 	if (req.value < 0) {
+		settings_.rt_factor       = -1.f;
 		settings_.real_time_index = 0;
 		settings_.speed_changed   = true;
-		resp.success              = true;
 		return true;
 	}
 
-	// find value closest to requested
-	size_t num_clicks = sizeof(percentRealTime) / sizeof(percentRealTime[0]);
-	float closest =
-	    findClosestRecursive(percentRealTime, 1, num_clicks - 1,
-	                         100.f * static_cast<float>(req.value)); // start at 1 to not go to unbound mode if the value
-	                                                                 // is too small (already handled above)
-
-	ROS_WARN_STREAM_COND(fabs(closest / 100.f - static_cast<float>(req.value)) > 0.001f,
-	                     "Requested factor '" << req.value
-	                                          << "' not available, setting to closest available: " << closest / 100.f);
+	const float factor = std::clamp(static_cast<float>(req.value), kMinRealTimeFactor, kMaxRealTimeFactor);
+	ROS_WARN_STREAM_COND(factor != static_cast<float>(req.value),
+	                     "Requested factor '" << req.value << "' out of range, clamping to " << factor);
 
-	// get index of closest value
-	auto it                   = std::find(std::next(std::begin(percentRealTime)), std::end(percentRealTime), closest);
-	settings_.real_time_index = std::distance(std::begin(percentRealTime), it);
+	settings_.rt_factor = factor;
+	// keep the viewer's speed controls at the closest preset
+	settings_.real_time_index = closestRealTimeIndex(factor);
 	settings_.speed_changed   = true;
 	return true;
 }
 
-bool MujocoEnv::getPluginStatsCB(mujoco_ros_msgs::GetPluginStats::Request & /*req*/,
+bool MujocoEnv::getPluginStatsCB(mujoco_ros_msgs::GetPluginStats::Request &req,
                                  mujoco_ros_msgs::GetPluginStats::Response &resp)
 {
 	// Lock mutex to get data within one step
@@ -983,6 +1363,10 @@ bool MujocoEnv::getPluginStatsCB(mujoco_ros_msgs::GetPluginStats::Request & /*re
 		stats.ema_steptime_passive    = plugin->ema_steptime_passive_;
 		stats.ema_steptime_render     = plugin->ema_steptime_render_;
 		stats.ema_steptime_last_stage = plugin->ema_steptime_last_stage_;
+		fillLatencyStats(plugin->latency_control_, stats.control_latency, req.reset);
+		fillLatencyStats(plugin->latency_passive_, stats.passive_latency, req.reset);
+		fillLatencyStats(plugin->latency_render_, stats.render_latency, req.reset);
+		fillLatencyStats(plugin->latency_last_stage_, stats.last_stage_latency, req.reset);
 		resp.stats.emplace_back(stats);
 	}
 	return true;
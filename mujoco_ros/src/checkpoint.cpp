@@ -0,0 +1,289 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/checkpoint.h>
+
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mujoco_ros {
+
+namespace {
+constexpr char kMagic[8]     = { 'M', 'J', 'R', 'O', 'S', 'C', 'K', 'P' };
+constexpr size_t kAlignment  = 64;
+constexpr uint64_t kFnvBasis = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+size_t alignUp(size_t size)
+{
+	return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = kFnvBasis)
+{
+	const auto *bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= kFnvPrime;
+	}
+	return hash;
+}
+} // namespace
+
+struct CheckpointFile::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t num_slots;
+	uint64_t state_size;
+	uint64_t signature;
+	uint64_t slot_size;
+};
+
+struct CheckpointFile::SlotHeader
+{
+	// 0 marks an empty or incomplete slot
+	uint64_t sequence;
+	mjtNum time;
+	uint64_t checksum;
+};
+
+static_assert(sizeof(mjtNum) == 8, "Checkpoint format assumes double precision mjtNum");
+
+CheckpointFile::~CheckpointFile()
+{
+	close();
+}
+
+bool CheckpointFile::open(const std::string &path, uint64_t state_size, uint32_t num_slots, uint64_t signature)
+{
+	close();
+
+	if (num_slots == 0 || state_size == 0) {
+		ROS_ERROR_NAMED("mujoco_checkpoint", "Checkpoint file needs at least one slot and a non-empty state");
+		return false;
+	}
+
+	fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd_ < 0) {
+		ROS_ERROR_STREAM_NAMED("mujoco_checkpoint",
+		                       "Could not open checkpoint file '" << path << "': " << std::strerror(errno));
+		return false;
+	}
+
+	state_size_ = state_size;
+	num_slots_  = num_slots;
+	slot_size_  = alignUp(sizeof(SlotHeader)) + alignUp(state_size * sizeof(mjtNum));
+	file_size_  = alignUp(sizeof(Header)) + num_slots * slot_size_;
+
+	// Keep existing checkpoints if the layout matches and never overwrite checkpoints with a different layout
+	bool reuse = false;
+	Header existing;
+	if (pread(fd_, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing)) &&
+	    std::memcmp(existing.magic, kMagic, sizeof(kMagic)) == 0) {
+		struct stat st;
+		reuse = fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) == file_size_ &&
+		        existing.version == kVersion && existing.num_slots == num_slots &&
+		        existing.state_size == state_size && existing.signature == signature &&
+		        existing.slot_size == slot_size_;
+		if (!reuse) {
+			ROS_WARN_STREAM_NAMED("mujoco_checkpoint", "Checkpoint file '"
+			                                               << path
+			                                               << "' holds checkpoints with a different layout (version, "
+			                                                  "model or number of slots). Remove it to reinitialize");
+			close();
+			return false;
+		}
+	}
+
+	if (!reuse) {
+		ROS_DEBUG_STREAM_NAMED("mujoco_checkpoint", "Initializing checkpoint file '" << path << "'");
+		if (ftruncate(fd_, 0) != 0 || ftruncate(fd_, static_cast<off_t>(file_size_)) != 0) {
+			ROS_ERROR_STREAM_NAMED("mujoco_checkpoint",
+			                       "Could not resize checkpoint file '" << path << "': " << std::strerror(errno));
+			close();
+			return false;
+		}
+	}
+
+	void *mapping = mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if (mapping == MAP_FAILED) {
+		ROS_ERROR_STREAM_NAMED("mujoco_checkpoint",
+		                       "Could not map checkpoint file '" << path << "': " << std::strerror(errno));
+		close();
+		return false;
+	}
+	mapping_ = mapping;
+
+	next_slot_     = 0;
+	next_sequence_ = 1;
+	if (reuse) {
+		uint64_t latest = 0;
+		for (uint32_t i = 0; i < num_slots_; ++i) {
+			if (slot(i)->sequence > latest) {
+				latest     = slot(i)->sequence;
+				next_slot_ = (i + 1) % num_slots_;
+			}
+		}
+		next_sequence_ = latest + 1;
+	} else {
+		Header *hdr = header();
+		std::memcpy(hdr->magic, kMagic, sizeof(kMagic));
+		hdr->version    = kVersion;
+		hdr->num_slots  = num_slots;
+		hdr->state_size = state_size;
+		hdr->signature  = signature;
+		hdr->slot_size  = slot_size_;
+		msync(mapping_, alignUp(sizeof(Header)), MS_SYNC);
+	}
+	return true;
+}
+
+void CheckpointFile::close()
+{
+	if (mapping_ != nullptr) {
+		msync(mapping_, file_size_, MS_SYNC);
+		munmap(mapping_, file_size_);
+		mapping_ = nullptr;
+	}
+	if (fd_ >= 0) {
+		::close(fd_);
+		fd_ = -1;
+	}
+}
+
+CheckpointFile::Header *CheckpointFile::header() const
+{
+	return static_cast<Header *>(mapping_);
+}
+
+CheckpointFile::SlotHeader *CheckpointFile::slot(uint32_t index) const
+{
+	return reinterpret_cast<SlotHeader *>(static_cast<char *>(mapping_) + alignUp(sizeof(Header)) +
+	                                      index * slot_size_);
+}
+
+mjtNum *CheckpointFile::slotData(uint32_t index) const
+{
+	return reinterpret_cast<mjtNum *>(reinterpret_cast<char *>(slot(index)) + alignUp(sizeof(SlotHeader)));
+}
+
+mjtNum *CheckpointFile::nextSlotData()
+{
+	// Invalidate the slot first, so a partially written state is never considered valid
+	__atomic_store_n(&slot(next_slot_)->sequence, 0, __ATOMIC_RELEASE);
+	return slotData(next_slot_);
+}
+
+void CheckpointFile::commit(mjtNum time)
+{
+	SlotHeader *s = slot(next_slot_);
+	s->time       = time;
+	s->checksum   = fnv1a(slotData(next_slot_), state_size_ * sizeof(mjtNum));
+	__atomic_store_n(&s->sequence, next_sequence_, __ATOMIC_RELEASE);
+
+	// msync needs a page aligned start address
+	static const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	const auto start            = reinterpret_cast<uintptr_t>(s) & ~(page_size - 1);
+	const auto end              = reinterpret_cast<uintptr_t>(s) + slot_size_;
+	msync(reinterpret_cast<void *>(start), end - start, MS_ASYNC);
+
+	next_slot_ = (next_slot_ + 1) % num_slots_;
+	++next_sequence_;
+}
+
+bool CheckpointFile::readLatest(mjtNum *state, mjtNum &time) const
+{
+	if (mapping_ == nullptr) {
+		return false;
+	}
+
+	int64_t latest_slot = -1;
+	uint64_t latest     = 0;
+	for (uint32_t i = 0; i < num_slots_; ++i) {
+		const SlotHeader *s = slot(i);
+		if (s->sequence > latest && s->checksum == fnv1a(slotData(i), state_size_ * sizeof(mjtNum))) {
+			latest      = s->sequence;
+			latest_slot = i;
+		}
+	}
+	if (latest_slot < 0) {
+		return false;
+	}
+
+	std::memcpy(state, slotData(static_cast<uint32_t>(latest_slot)), state_size_ * sizeof(mjtNum));
+	time = slot(static_cast<uint32_t>(latest_slot))->time;
+	return true;
+}
+
+uint64_t CheckpointFile::modelSignature(const mjModel *m, unsigned int state_sig)
+{
+	const int64_t layout[] = {
+		m->nq, m->nv, m->na, m->nu, m->nmocap, m->neq, m->nbody, m->nuserdata,
+		m->npluginstate, mj_stateSize(m, state_sig), state_sig,
+	};
+	// Models with the same layout must not resume each other's checkpoints, hence the model content is hashed as well
+	std::vector<char> buffer(static_cast<size_t>(std::max(0, mj_sizeModel(m))));
+	mj_saveModel(m, nullptr, buffer.data(), static_cast<int>(buffer.size()));
+	return fnv1a(buffer.data(), buffer.size(), fnv1a(layout, sizeof(layout)));
+}
+
+std::string CheckpointFile::signaturePath(const std::string &path, uint64_t signature)
+{
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016" PRIx64, signature);
+
+	const size_t name = path.find_last_of('/') == std::string::npos ? 0 : path.find_last_of('/') + 1;
+	const size_t ext  = path.find_last_of('.');
+	if (ext == std::string::npos || ext <= name) {
+		return path + "." + hex;
+	}
+	return path.substr(0, ext) + "." + hex + path.substr(ext);
+}
+
+} // namespace mujoco_ros
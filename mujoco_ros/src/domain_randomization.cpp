@@ -0,0 +1,358 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/domain_randomization.h>
+
+#include <ros/ros.h>
+
+#include <cmath>
+
+namespace mujoco_ros {
+
+namespace {
+
+enum class ElementType
+{
+	NONE, // global option, single element
+	OBJECT, // one entry per object of the given type
+	JOINT_DOFS // one entry per dof, addressed by joint name
+};
+
+struct FieldInfo
+{
+	const char *name;
+	ElementType type;
+	mjtObj obj;
+	int stride;
+	bool needs_const;
+	// sampled values are clamped to this lower bound, -mjMAXVAL for fields without a bound (e.g. signed gains)
+	mjtNum min;
+	mjtNum *(*data)(mjModel *);
+};
+
+// clang-format off
+const FieldInfo kFields[] = {
+	{ "geom_friction",     ElementType::OBJECT,     mjOBJ_GEOM,     3,         false, 0,         [](mjModel *m) { return m->geom_friction; } },
+	{ "geom_solref",       ElementType::OBJECT,     mjOBJ_GEOM,     mjNREF,    false, -mjMAXVAL, [](mjModel *m) { return m->geom_solref; } },
+	{ "body_mass",         ElementType::OBJECT,     mjOBJ_BODY,     1,         true,  mjMINVAL,  [](mjModel *m) { return m->body_mass; } },
+	{ "jnt_stiffness",     ElementType::OBJECT,     mjOBJ_JOINT,    1,         false, 0,         [](mjModel *m) { return m->jnt_stiffness; } },
+	{ "dof_damping",       ElementType::JOINT_DOFS, mjOBJ_JOINT,    1,         false, 0,         [](mjModel *m) { return m->dof_damping; } },
+	{ "dof_frictionloss",  ElementType::JOINT_DOFS, mjOBJ_JOINT,    1,         false, 0,         [](mjModel *m) { return m->dof_frictionloss; } },
+	{ "dof_armature",      ElementType::JOINT_DOFS, mjOBJ_JOINT,    1,         true,  0,         [](mjModel *m) { return m->dof_armature; } },
+	{ "actuator_gear",     ElementType::OBJECT,     mjOBJ_ACTUATOR, 6,         true,  -mjMAXVAL, [](mjModel *m) { return m->actuator_gear; } },
+	{ "actuator_gainprm",  ElementType::OBJECT,     mjOBJ_ACTUATOR, mjNGAIN,   false, -mjMAXVAL, [](mjModel *m) { return m->actuator_gainprm; } },
+	{ "actuator_biasprm",  ElementType::OBJECT,     mjOBJ_ACTUATOR, mjNBIAS,   false, -mjMAXVAL, [](mjModel *m) { return m->actuator_biasprm; } },
+	{ "eq_data",           ElementType::OBJECT,     mjOBJ_EQUALITY, mjNEQDATA, false, -mjMAXVAL, [](mjModel *m) { return m->eq_data; } },
+	{ "eq_solref",         ElementType::OBJECT,     mjOBJ_EQUALITY, mjNREF,    false, -mjMAXVAL, [](mjModel *m) { return m->eq_solref; } },
+	{ "opt_gravity",       ElementType::NONE,       mjOBJ_UNKNOWN,  3,         false, -mjMAXVAL, [](mjModel *m) { return m->opt.gravity; } },
+	{ "opt_wind",          ElementType::NONE,       mjOBJ_UNKNOWN,  3,         false, -mjMAXVAL, [](mjModel *m) { return m->opt.wind; } },
+	{ "opt_density",       ElementType::NONE,       mjOBJ_UNKNOWN,  1,         false, 0,         [](mjModel *m) { return &m->opt.density; } },
+	{ "opt_viscosity",     ElementType::NONE,       mjOBJ_UNKNOWN,  1,         false, 0,         [](mjModel *m) { return &m->opt.viscosity; } },
+};
+// clang-format on
+
+const FieldInfo *findField(const std::string &name)
+{
+	for (const auto &field : kFields) {
+		if (name == field.name) {
+			return &field;
+		}
+	}
+	return nullptr;
+}
+
+int numElements(const mjModel *m, mjtObj obj)
+{
+	switch (obj) {
+		case mjOBJ_GEOM:
+			return m->ngeom;
+		case mjOBJ_BODY:
+			return m->nbody;
+		case mjOBJ_JOINT:
+			return m->njnt;
+		case mjOBJ_ACTUATOR:
+			return m->nu;
+		case mjOBJ_EQUALITY:
+			return m->neq;
+		default:
+			return 1;
+	}
+}
+
+bool toDouble(XmlRpc::XmlRpcValue &value, double &out)
+{
+	if (value.getType() == XmlRpc::XmlRpcValue::TypeDouble) {
+		out = static_cast<double>(value);
+		return true;
+	}
+	if (value.getType() == XmlRpc::XmlRpcValue::TypeInt) {
+		out = static_cast<int>(value);
+		return true;
+	}
+	return false;
+}
+
+} // namespace
+
+bool DomainRandomizer::init(XmlRpc::XmlRpcValue config)
+{
+	randomizations_.clear();
+	if (config.getType() != XmlRpc::XmlRpcValue::TypeStruct || !config.hasMember("parameters") ||
+	    config["parameters"].getType() != XmlRpc::XmlRpcValue::TypeArray) {
+		ROS_ERROR_NAMED("mujoco", "domain_randomization should be a struct with a 'parameters' array!");
+		return false;
+	}
+
+	if (config.hasMember("seed") && config["seed"].getType() == XmlRpc::XmlRpcValue::TypeInt) {
+		seed(static_cast<uint64_t>(static_cast<int>(config["seed"])));
+	} else {
+		seed(std::random_device()());
+	}
+
+	if (config.hasMember("log_path") && config["log_path"].getType() == XmlRpc::XmlRpcValue::TypeString) {
+		log_path_ = static_cast<std::string>(config["log_path"]);
+		log_.open(log_path_, std::ios::out | std::ios::app);
+		if (!log_.is_open()) {
+			ROS_ERROR_STREAM_NAMED("mujoco", "Could not open domain randomization log '" << log_path_ << "'");
+		}
+	}
+
+	XmlRpc::XmlRpcValue &params = config["parameters"];
+	for (int i = 0; i < params.size(); ++i) {
+		XmlRpc::XmlRpcValue entry = params[i];
+		if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct || !entry.hasMember("field")) {
+			ROS_ERROR_STREAM_NAMED("mujoco", "Domain randomization entry " << i << " has no 'field' member, skipping");
+			continue;
+		}
+
+		Randomization r;
+		r.field                = static_cast<std::string>(entry["field"]);
+		const FieldInfo *field = findField(r.field);
+		if (field == nullptr) {
+			ROS_ERROR_STREAM_NAMED("mujoco", "Unsupported domain randomization field '" << r.field << "', skipping");
+			continue;
+		}
+
+		if (entry.hasMember("names")) {
+			if (entry["names"].getType() == XmlRpc::XmlRpcValue::TypeArray) {
+				for (int j = 0; j < entry["names"].size(); ++j) {
+					r.names.emplace_back(static_cast<std::string>(entry["names"][j]));
+				}
+			} else {
+				r.names.emplace_back(static_cast<std::string>(entry["names"]));
+			}
+		}
+
+		if (entry.hasMember("component")) {
+			r.component = static_cast<int>(entry["component"]);
+			if (r.component < -1 || r.component >= field->stride) {
+				ROS_ERROR_STREAM_NAMED("mujoco", "Component " << r.component << " out of range for field '" << r.field
+				                                              << "' (size " << field->stride << "), skipping");
+				continue;
+			}
+		}
+
+		const std::string distribution =
+		    entry.hasMember("distribution") ? static_cast<std::string>(entry["distribution"]) : "uniform";
+		const std::string mode = entry.hasMember("mode") ? static_cast<std::string>(entry["mode"]) : "absolute";
+		bool valid             = true;
+		if (distribution == "uniform" || distribution == "loguniform") {
+			r.distribution = distribution == "uniform" ? Distribution::UNIFORM : Distribution::LOGUNIFORM;
+			valid = entry.hasMember("low") && entry.hasMember("high") && toDouble(entry["low"], r.a) &&
+			        toDouble(entry["high"], r.b) && r.a <= r.b &&
+			        (r.distribution == Distribution::UNIFORM || r.a > 0);
+		} else if (distribution == "normal") {
+			r.distribution = Distribution::NORMAL;
+			valid          = entry.hasMember("mean") && entry.hasMember("std") && toDouble(entry["mean"], r.a) &&
+			        toDouble(entry["std"], r.b) && r.b >= 0;
+		} else {
+			valid = false;
+		}
+		if (!valid) {
+			ROS_ERROR_STREAM_NAMED("mujoco", "Invalid distribution parameters for domain randomization field '"
+			                                     << r.field << "' (expected uniform/loguniform with 0 < low <= high "
+			                                     << "or normal with mean and std >= 0), skipping");
+			continue;
+		}
+
+		if (mode == "absolute") {
+			r.mode = Mode::ABSOLUTE;
+		} else if (mode == "scale") {
+			r.mode = Mode::SCALE;
+		} else if (mode == "offset") {
+			r.mode = Mode::OFFSET;
+		} else {
+			ROS_ERROR_STREAM_NAMED("mujoco", "Unknown domain randomization mode '" << mode << "' for field '" << r.field
+			                                                                       << "', skipping");
+			continue;
+		}
+
+		randomizations_.emplace_back(std::move(r));
+	}
+
+	ROS_INFO_STREAM_COND_NAMED(isEnabled(), "mujoco",
+	                           "Domain randomization enabled for " << randomizations_.size() << " field(s)");
+	return isEnabled();
+}
+
+void DomainRandomizer::load(mjModel *m)
+{
+	bool uses_mass = false;
+
+	for (auto &r : randomizations_) {
+		const FieldInfo *field = findField(r.field);
+		r.offsets.clear();
+		r.elements.clear();
+		r.components.clear();
+		r.nominal.clear();
+		uses_mass = uses_mass || r.field == "body_mass";
+
+		std::vector<int> ids;
+		if (field->type == ElementType::NONE) {
+			ids.push_back(0);
+		} else if (r.names.empty()) {
+			for (int id = 0; id < numElements(m, field->obj); ++id) {
+				ids.push_back(id);
+			}
+		} else {
+			for (const auto &name : r.names) {
+				int id = mj_name2id(m, field->obj, name.c_str());
+				if (id == -1) {
+					ROS_WARN_STREAM_NAMED("mujoco", "Domain randomization: element '" << name << "' of field '" << r.field
+					                                                                  << "' not found in model, skipping");
+					continue;
+				}
+				ids.push_back(id);
+			}
+		}
+
+		const mjtNum *data = field->data(m);
+		for (const int id : ids) {
+			const char *name = field->type == ElementType::NONE ? "" : mj_id2name(m, field->obj, id);
+			std::string element(name ? name : std::to_string(id));
+
+			int first = id, count = 1;
+			if (field->type == ElementType::JOINT_DOFS) {
+				first = m->jnt_dofadr[id];
+				count = m->jnt_type[id] == mjJNT_FREE ? 6 : (m->jnt_type[id] == mjJNT_BALL ? 3 : 1);
+			}
+			for (int adr = first; adr < first + count; ++adr) {
+				for (int c = 0; c < field->stride; ++c) {
+					if (r.component != -1 && c != r.component) {
+						continue;
+					}
+					const size_t offset = static_cast<size_t>(adr) * static_cast<size_t>(field->stride) +
+					                      static_cast<size_t>(c);
+					r.offsets.push_back(offset);
+					r.elements.push_back(element);
+					r.components.push_back(field->type == ElementType::JOINT_DOFS ? adr - first : c);
+					r.nominal.push_back(data[offset]);
+				}
+			}
+		}
+		ROS_DEBUG_STREAM_NAMED("mujoco", "Domain randomization of '" << r.field << "' resolved to " << r.offsets.size()
+		                                                             << " value(s)");
+	}
+
+	nominal_mass_.clear();
+	nominal_inertia_.clear();
+	if (uses_mass) {
+		nominal_mass_.assign(m->body_mass, m->body_mass + m->nbody);
+		nominal_inertia_.assign(m->body_inertia, m->body_inertia + 3 * m->nbody);
+	}
+}
+
+double DomainRandomizer::sample(const Randomization &r)
+{
+	switch (r.distribution) {
+		case Distribution::UNIFORM:
+			return std::uniform_real_distribution<double>(r.a, r.b)(rng_);
+		case Distribution::LOGUNIFORM:
+			return std::exp(std::uniform_real_distribution<double>(std::log(r.a), std::log(r.b))(rng_));
+		case Distribution::NORMAL:
+			return std::normal_distribution<double>(r.a, r.b)(rng_);
+	}
+	return 0;
+}
+
+bool DomainRandomizer::apply(mjModel *m)
+{
+	samples_.clear();
+	bool needs_const = false;
+
+	for (const auto &r : randomizations_) {
+		const FieldInfo *field = findField(r.field);
+		mjtNum *data           = field->data(m);
+		for (size_t i = 0; i < r.offsets.size(); ++i) {
+			mjtNum value = sample(r);
+			if (r.mode == Mode::SCALE) {
+				value *= r.nominal[i];
+			} else if (r.mode == Mode::OFFSET) {
+				value += r.nominal[i];
+			}
+			if (value < field->min) {
+				ROS_DEBUG_STREAM_NAMED("mujoco", "Clamping sampled " << r.field << "[" << r.elements[i]
+				                                                     << "] = " << value << " to " << field->min);
+				value = field->min;
+			}
+			data[r.offsets[i]] = value;
+			samples_.push_back({ r.field, r.elements[i], r.components[i], value });
+
+			if (r.field == "body_mass" && nominal_mass_[r.offsets[i]] > mjMINVAL) {
+				// Keep the mass distribution of the body by scaling its inertia along with the mass
+				mju_scl3(m->body_inertia + 3 * r.offsets[i], nominal_inertia_.data() + 3 * r.offsets[i],
+				         value / nominal_mass_[r.offsets[i]]);
+			}
+		}
+		needs_const = needs_const || (field->needs_const && !r.offsets.empty());
+	}
+
+	++episode_;
+	for (const auto &s : samples_) {
+		ROS_DEBUG_STREAM_NAMED("mujoco", "Episode " << episode_ << ": " << s.field << "[" << s.element << "]["
+		                                            << s.component << "] = " << s.value);
+		if (log_.is_open()) {
+			log_ << episode_ << ',' << s.field << ',' << s.element << ',' << s.component << ',' << s.value << '\n';
+		}
+	}
+	if (log_.is_open()) {
+		log_.flush();
+	}
+	return needs_const;
+}
+
+} // namespace mujoco_ros
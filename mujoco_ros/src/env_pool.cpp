@@ -0,0 +1,205 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/env_pool.h>
+
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace mujoco_ros {
+
+namespace {
+// Parameters that configure the pool itself and are not forwarded to the environments
+bool isPoolParam(const std::string &key)
+{
+	return key == "num_envs" || key == "num_workers" || key == "steps_per_tick" || key == "modelfile" ||
+	       key == "shm" || key.rfind("env_", 0) == 0;
+}
+} // namespace
+
+EnvPool::EnvPool(int num_envs, int num_workers, const std::string &admin_hash /* = std::string()*/) : nh_("~")
+{
+	num_envs = std::max(num_envs, 1);
+	nh_.param<int>("steps_per_tick", steps_per_tick_, 10);
+	steps_per_tick_ = std::max(steps_per_tick_, 1);
+
+	thread_config_.load(nh_);
+
+	envs_.reserve(static_cast<std::size_t>(num_envs));
+	for (int i = 0; i < num_envs; ++i) {
+		const std::string ns = "env_" + std::to_string(i);
+		forwardParams(i, ns);
+		envs_.emplace_back(std::make_unique<MujocoEnv>(admin_hash, "~" + ns));
+	}
+
+	const int available_threads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+	num_workers_                = std::min(std::min(num_workers, num_envs), std::max(available_threads, 1));
+	if (num_workers_ > 1) {
+		workers_ = mju_threadPoolCreate(num_workers_);
+		thread_config_.applyToThreadPool(workers_, num_workers_);
+	}
+	ROS_INFO_STREAM("Created " << num_envs << " environments stepped by " << std::max(num_workers_, 1)
+	                           << " worker(s)");
+
+	ticks_.resize(envs_.size());
+	for (std::size_t i = 0; i < envs_.size(); ++i) {
+		ticks_[i].env       = envs_[i].get();
+		ticks_[i].max_steps = steps_per_tick_;
+	}
+}
+
+EnvPool::~EnvPool()
+{
+	requestExit();
+	for (auto &env : envs_) {
+		env->waitForEventsJoin();
+		env->finishPhysics();
+	}
+	// Environments are destroyed before the workers, none of them is ticked anymore at this point
+	envs_.clear();
+	if (workers_ != nullptr) {
+		mju_threadPoolDestroy(workers_);
+	}
+}
+
+void EnvPool::forwardParams(int index, const std::string &ns) const
+{
+	const std::string env_ns = nh_.getNamespace() + "/" + ns;
+
+	XmlRpc::XmlRpcValue params;
+	if (ros::param::get(nh_.getNamespace(), params) && params.getType() == XmlRpc::XmlRpcValue::TypeStruct) {
+		for (auto &param : params) {
+			if (!isPoolParam(param.first) && !ros::param::has(env_ns + "/" + param.first)) {
+				ros::param::set(env_ns + "/" + param.first, param.second);
+			}
+		}
+	}
+
+	// Each environment needs its own shared memory segment, opening the same name again would replace it
+	XmlRpc::XmlRpcValue shm;
+	if (!ros::param::has(env_ns + "/shm") && ros::param::get(nh_.getNamespace() + "/shm", shm) &&
+	    shm.getType() == XmlRpc::XmlRpcValue::TypeStruct) {
+		if (shm.hasMember("name") && shm["name"].getType() == XmlRpc::XmlRpcValue::TypeString &&
+		    !static_cast<std::string>(shm["name"]).empty()) {
+			shm["name"] = static_cast<std::string>(shm["name"]) + "_" + std::to_string(index);
+		}
+		ros::param::set(env_ns + "/shm", shm);
+	}
+
+	// Concurrent /clock publishers would make time jump back and forth
+	if (index > 0 && !ros::param::has(env_ns + "/publish_clock")) {
+		ros::param::set(env_ns + "/publish_clock", false);
+	}
+	// Environments are stepped in parallel by the pool, a threadpool per environment would oversubscribe the cores
+	int env_threads = 1;
+	if (ros::param::get(env_ns + "/num_mj_threads", env_threads) && env_threads > 1) {
+		ROS_WARN_STREAM_ONCE("Environments of a pool are single-threaded, ignoring num_mj_threads " << env_threads);
+	}
+	ros::param::set(env_ns + "/num_mj_threads", 1);
+}
+
+void EnvPool::start(const std::string &filename)
+{
+	for (auto &env : envs_) {
+		if (!filename.empty()) {
+			env->queueModel(filename);
+		}
+		env->startEventLoop();
+	}
+}
+
+void *EnvPool::tickTask(void *args)
+{
+	auto *tick = static_cast<Tick *>(args);
+	tick->due  = tick->env->tickPhysics(tick->max_steps);
+	return nullptr;
+}
+
+void EnvPool::run()
+{
+	ROS_DEBUG("Env pool started");
+	tracing::setThreadName("env_pool");
+	while (!exit_request_.load()) {
+		std::vector<Tick *> pending;
+		for (auto &tick : ticks_) {
+			if (!tick.env->isPhysicsDone()) {
+				pending.push_back(&tick);
+			}
+		}
+		if (pending.empty()) {
+			break;
+		}
+
+		if (workers_ != nullptr) {
+			// Dispatch all but the last tick to the workers and run the last one on the calling thread
+			for (std::size_t i = 0; i + 1 < pending.size(); ++i) {
+				mju_defaultTask(&pending[i]->task);
+				pending[i]->task.func = tickTask;
+				pending[i]->task.args = pending[i];
+				mju_threadPoolEnqueue(workers_, &pending[i]->task);
+			}
+			tickTask(pending.back());
+			for (std::size_t i = 0; i + 1 < pending.size(); ++i) {
+				mju_taskJoin(&pending[i]->task);
+			}
+		} else {
+			for (auto *tick : pending) {
+				tickTask(tick);
+			}
+		}
+
+		// Sleep until the earliest environment is due, but stay responsive to pause, reset and exit requests
+		auto due = Clock::now() + std::chrono::milliseconds(1);
+		for (const auto *tick : pending) {
+			due = std::min(due, tick->due);
+		}
+		std::this_thread::sleep_until(due);
+	}
+	ROS_DEBUG("Exiting env pool");
+}
+
+void EnvPool::requestExit()
+{
+	exit_request_.store(true);
+	for (auto &env : envs_) {
+		env->settings_.exit_request.store(1);
+	}
+}
+
+} // namespace mujoco_ros
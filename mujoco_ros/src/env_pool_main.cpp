@@ -0,0 +1,111 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <ros/ros.h>
+
+#include <mujoco_ros/env_pool.h>
+
+#include <boost/program_options.hpp>
+#include <csignal>
+
+namespace {
+
+std::unique_ptr<mujoco_ros::EnvPool> pool;
+
+void sigint_handler(int /*sig*/)
+{
+	std::printf("Registered C-c. Shutting down MuJoCo ROS environment pool ...\n");
+	pool->requestExit();
+}
+
+namespace po = boost::program_options;
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+	ros::init(argc, argv, "mujoco_env_pool");
+	ros::start();
+
+	ros::AsyncSpinner spinner(4);
+	spinner.start();
+
+	ros::NodeHandle nh = ros::NodeHandle("~");
+
+	std::string admin_hash("");
+
+	po::options_description options;
+	options.add_options() // clang-format off
+	  ("help,h", "Produce this help message")
+	  ("admin-hash", po::value<std::string>(&admin_hash),"Set the admin hash for eval mode.");
+	// clang-format on
+	po::variables_map vm;
+
+	try {
+		po::store(po::parse_command_line(argc, argv, options), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			std::cout << "command line options:\n" << options;
+			exit(0);
+		}
+	} catch (std::exception &e) {
+		ROS_ERROR("Error parsing command line: %s", e.what());
+		exit(-1);
+	}
+
+	int num_envs;
+	int num_workers;
+	std::string filename;
+	nh.param<int>("num_envs", num_envs, 2);
+	nh.param<int>("num_workers", num_workers, num_envs);
+	nh.getParam("modelfile", filename);
+	ROS_WARN_COND(filename.empty(), "No modelfile was provided, launching empty simulations!");
+
+	pool = std::make_unique<mujoco_ros::EnvPool>(num_envs, num_workers, admin_hash);
+	signal(SIGINT, sigint_handler);
+
+	pool->start(filename);
+	pool->run();
+	pool.reset();
+
+	ROS_INFO("MuJoCo ROS environment pool is terminating");
+
+	spinner.stop();
+	ros::shutdown();
+	exit(0);
+}
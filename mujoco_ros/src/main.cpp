@@ -147,8 +147,7 @@ int main(int argc, char **argv)
 
 	// const char *filename = nullptr;
 	if (!filename.empty()) {
-		mju::strcpy_arr(env->queued_filename_, filename.c_str());
-		env->settings_.load_request = 2;
+		env->queueModel(filename);
 	}
 
 	env->startPhysicsLoop();
@@ -0,0 +1,323 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/model_cache.h>
+
+#include <ros/ros.h>
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace mujoco_ros {
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr uint64_t kFnvBasis = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+uint64_t fnv1a(uint64_t hash, const char *data, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= kFnvPrime;
+	}
+	return hash;
+}
+
+uint64_t fnv1a(uint64_t hash, const std::string &str)
+{
+	// Include the length to separate consecutive strings
+	const uint64_t size = str.size();
+	hash                = fnv1a(hash, reinterpret_cast<const char *>(&size), sizeof(size));
+	return fnv1a(hash, str.data(), str.size());
+}
+
+bool readFile(const fs::path &path, std::string &content)
+{
+	std::ifstream file(path.string(), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::ostringstream ss;
+	ss << file.rdbuf();
+	content = ss.str();
+	return true;
+}
+
+// Values of all occurrences of an attribute
+std::vector<std::string> attributes(const std::string &xml, const char *name)
+{
+	const std::regex re(std::string("\\b") + name + "\\s*=\\s*[\"']([^\"']*)[\"']");
+	std::vector<std::string> values;
+	for (auto it = std::sregex_iterator(xml.begin(), xml.end(), re); it != std::sregex_iterator(); ++it) {
+		values.push_back((*it)[1].str());
+	}
+	return values;
+}
+
+// Matches `file` as well as the cube texture attributes `fileright`, `fileleft`, `fileup`, ...
+const std::regex &fileAttributeRegex()
+{
+	static const std::regex file_re("\\bfile\\w*\\s*=\\s*[\"']([^\"']*)[\"']");
+	return file_re;
+}
+
+// Directory a file attribute is resolved against, depends on the element as in the MJCF compiler
+enum class AssetDir
+{
+	kModel,
+	kMesh,
+	kTexture,
+};
+
+AssetDir assetDirOf(const std::string &element)
+{
+	if (element == "mesh" || element == "hfield" || element == "skin") {
+		return AssetDir::kMesh;
+	}
+	if (element == "texture") {
+		return AssetDir::kTexture;
+	}
+	return AssetDir::kModel;
+}
+
+// Adds the content of filename, its includes and all referenced asset files to hash
+uint64_t hashDependencies(uint64_t hash, const fs::path &filename, std::set<std::string> &visited)
+{
+	const fs::path model_dir = filename.parent_path();
+	std::vector<fs::path> xml_files = { filename };
+	// the last occurrence of a compiler attribute wins
+	std::string meshdir, texturedir, assetdir;
+	std::vector<std::pair<AssetDir, std::string>> assets;
+
+	// MJCF includes are resolved relative to the main model file
+	while (!xml_files.empty()) {
+		const fs::path path = xml_files.back();
+		xml_files.pop_back();
+		if (!visited.insert(path.string()).second) {
+			continue;
+		}
+
+		std::string xml;
+		if (!readFile(path, xml)) {
+			hash = fnv1a(hash, path.string());
+			continue;
+		}
+		hash = fnv1a(hash, xml);
+
+		const auto last_value = [&xml](const char *name, std::string &value) {
+			const auto values = attributes(xml, name);
+			if (!values.empty()) {
+				value = values.back();
+			}
+		};
+		last_value("meshdir", meshdir);
+		last_value("texturedir", texturedir);
+		last_value("assetdir", assetdir);
+
+		static const std::regex element_re("<\\s*(\\w+)([^>]*)>");
+		const std::regex &file_re = fileAttributeRegex();
+		for (auto it = std::sregex_iterator(xml.begin(), xml.end(), element_re); it != std::sregex_iterator(); ++it) {
+			const std::string element = (*it)[1].str();
+			const std::string attrs   = (*it)[2].str();
+			for (auto file = std::sregex_iterator(attrs.begin(), attrs.end(), file_re); file != std::sregex_iterator();
+			     ++file) {
+				if (element == "include") {
+					const fs::path include((*file)[1].str());
+					xml_files.push_back(include.is_absolute() ? include : model_dir / include);
+				} else {
+					assets.emplace_back(assetDirOf(element), (*file)[1].str());
+				}
+			}
+		}
+	}
+
+	// meshdir and texturedir take precedence over assetdir
+	const std::string &mesh_dir    = meshdir.empty() ? assetdir : meshdir;
+	const std::string &texture_dir = texturedir.empty() ? assetdir : texturedir;
+	for (const auto &[type, asset] : assets) {
+		fs::path candidate(asset);
+		if (!candidate.is_absolute()) {
+			const fs::path dir(type == AssetDir::kMesh ? mesh_dir : (type == AssetDir::kTexture ? texture_dir : ""));
+			candidate = dir.is_absolute() ? dir / candidate : model_dir / dir / candidate;
+		}
+
+		if (visited.count(candidate.string())) {
+			continue;
+		}
+		boost::system::error_code ec;
+		std::string content;
+		if (fs::is_regular_file(candidate, ec) && readFile(candidate, content)) {
+			visited.insert(candidate.string());
+			hash = fnv1a(hash, candidate.string());
+			hash = fnv1a(hash, content);
+		} else {
+			hash = fnv1a(hash, asset);
+		}
+	}
+	return hash;
+}
+
+uint64_t versionHash()
+{
+	return fnv1a(kFnvBasis, std::string(mj_versionString()));
+}
+} // namespace
+
+ModelCache::~ModelCache()
+{
+	clear();
+}
+
+void ModelCache::configure(const std::string &directory, size_t max_memory_entries)
+{
+	directory_          = directory;
+	max_memory_entries_ = max_memory_entries;
+	if (!directory_.empty()) {
+		boost::system::error_code ec;
+		fs::create_directories(directory_, ec);
+		if (ec) {
+			ROS_WARN_STREAM_NAMED("mujoco", "Could not create model cache directory '" << directory_
+			                                                                          << "': " << ec.message());
+			directory_.clear();
+		}
+	}
+}
+
+uint64_t ModelCache::keyForFile(const std::string &filename)
+{
+	std::set<std::string> visited;
+	return hashDependencies(versionHash(), fs::absolute(filename), visited);
+}
+
+uint64_t ModelCache::keyForString(const std::string &xml)
+{
+	return fnv1a(versionHash(), xml);
+}
+
+bool ModelCache::referencesFiles(const std::string &xml)
+{
+	return std::regex_search(xml, fileAttributeRegex());
+}
+
+std::string ModelCache::diskPath(uint64_t key) const
+{
+	std::ostringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << key << ".mjb";
+	return (fs::path(directory_) / ss.str()).string();
+}
+
+mjModel *ModelCache::get(uint64_t key)
+{
+	for (auto it = memory_.begin(); it != memory_.end(); ++it) {
+		if (it->first == key) {
+			memory_.splice(memory_.begin(), memory_, it);
+			ROS_DEBUG_NAMED("mujoco", "Model cache hit (memory)");
+			return mj_copyModel(nullptr, memory_.front().second);
+		}
+	}
+
+	if (directory_.empty()) {
+		return nullptr;
+	}
+	const std::string path = diskPath(key);
+	boost::system::error_code ec;
+	if (!fs::is_regular_file(path, ec)) {
+		return nullptr;
+	}
+	mjModel *m = mj_loadModel(path.c_str(), nullptr);
+	if (m == nullptr) {
+		ROS_WARN_STREAM_NAMED("mujoco", "Could not load cached model '" << path << "', recompiling");
+		return nullptr;
+	}
+	ROS_DEBUG_STREAM_NAMED("mujoco", "Model cache hit (" << path << ")");
+	if (max_memory_entries_ > 0) {
+		insertMemory(key, mj_copyModel(nullptr, m));
+	}
+	return m;
+}
+
+void ModelCache::put(uint64_t key, const mjModel *m)
+{
+	if (max_memory_entries_ > 0) {
+		insertMemory(key, mj_copyModel(nullptr, m));
+	}
+	if (!directory_.empty()) {
+		const std::string path = diskPath(key);
+		// Write to a temporary file first so concurrent readers never see a partial model
+		const std::string tmp_path = path + ".tmp";
+		mj_saveModel(m, tmp_path.c_str(), nullptr, 0);
+		boost::system::error_code ec;
+		fs::rename(tmp_path, path, ec);
+		if (ec) {
+			ROS_WARN_STREAM_NAMED("mujoco", "Could not store compiled model in cache: " << ec.message());
+			fs::remove(tmp_path, ec);
+		}
+	}
+}
+
+void ModelCache::insertMemory(uint64_t key, mjModel *m)
+{
+	for (auto it = memory_.begin(); it != memory_.end(); ++it) {
+		if (it->first == key) {
+			mj_deleteModel(it->second);
+			memory_.erase(it);
+			break;
+		}
+	}
+	memory_.emplace_front(key, m);
+	while (memory_.size() > max_memory_entries_) {
+		mj_deleteModel(memory_.back().second);
+		memory_.pop_back();
+	}
+}
+
+void ModelCache::clear()
+{
+	for (auto &entry : memory_) {
+		mj_deleteModel(entry.second);
+	}
+	memory_.clear();
+}
+
+} // namespace mujoco_ros
@@ -39,9 +39,15 @@
 #include <mujoco_ros/mujoco_env.h>
 
 #include <mujoco_ros/offscreen_camera.h>
+#include <mujoco_ros/util.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <shared_mutex>
 #include <stdexcept>
 #include <sstream>
+#include <unordered_map>
 
 namespace mujoco_ros {
 namespace mju = ::mujoco::sample_util;
@@ -61,11 +67,90 @@ int MaybeGlfwInit()
 	}();
 	return is_initialized;
 }
+
+// MuJoCo callbacks are process-wide, this registry routes them to the environment owning the stepped mjData
+struct EnvRegistry
+{
+	std::shared_mutex mutex;
+	std::vector<MujocoEnv *> envs;
+	std::unordered_map<const mjData *, MujocoEnv *> by_data;
+};
+
+bool hasSuffix(const std::string &str, const char *suffix)
+{
+	const std::size_t length = std::strlen(suffix);
+	return str.size() > length && str.compare(str.size() - length, length, suffix) == 0;
+}
+
+EnvRegistry &envRegistry()
+{
+	static EnvRegistry registry;
+	return registry;
+}
+
+void registerEnv(MujocoEnv *env)
+{
+	auto &registry = envRegistry();
+	std::unique_lock<std::shared_mutex> lock(registry.mutex);
+	registry.envs.push_back(env);
+}
+
+void unregisterEnv(MujocoEnv *env)
+{
+	auto &registry = envRegistry();
+	std::unique_lock<std::shared_mutex> lock(registry.mutex);
+	registry.envs.erase(std::remove(registry.envs.begin(), registry.envs.end(), env), registry.envs.end());
+	for (auto it = registry.by_data.begin(); it != registry.by_data.end();) {
+		if (it->second == env) {
+			it = registry.by_data.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void rebindEnvData(MujocoEnv *env, const mjData *old_data, const mjData *new_data)
+{
+	auto &registry = envRegistry();
+	std::unique_lock<std::shared_mutex> lock(registry.mutex);
+	if (old_data != nullptr) {
+		registry.by_data.erase(old_data);
+	}
+	if (new_data != nullptr) {
+		registry.by_data[new_data] = env;
+	}
+}
 } // namespace
 
-MujocoEnv *MujocoEnv::instance = nullptr;
+MujocoEnv *MujocoEnv::lookup(const mjData *d)
+{
+	auto &registry = envRegistry();
+	std::shared_lock<std::shared_mutex> lock(registry.mutex);
+	const auto it = registry.by_data.find(d);
+	if (it != registry.by_data.end()) {
+		return it->second;
+	}
+	// Data not owned by an environment, e.g. a copy stepped by a plugin. Only unambiguous with a single environment
+	if (registry.envs.size() == 1) {
+		return registry.envs.front();
+	}
+	ROS_WARN_ONCE_NAMED("mujoco", "Skipping callbacks for an mjData that is not owned by any environment, because "
+	                              "multiple environments exist. Plugins stepping their own mjData have to register "
+	                              "it with MujocoEnv::registerData.");
+	return nullptr;
+}
+
+void MujocoEnv::registerData(const mjData *d)
+{
+	rebindEnvData(this, nullptr, d);
+}
+
+void MujocoEnv::unregisterData(const mjData *d)
+{
+	rebindEnvData(this, d, nullptr);
+}
 
-MujocoEnv::MujocoEnv(const std::string &admin_hash /* = std::string()*/)
+MujocoEnv::MujocoEnv(const std::string &admin_hash /* = std::string()*/, const std::string &ns /* = "~"*/)
 {
 	if (!ros::param::get("/use_sim_time", settings_.use_sim_time)) {
 		ROS_FATAL_NAMED("mujoco", "/use_sim_time ROS param is unset. This node requires you to explicitly set it to true "
@@ -76,7 +161,7 @@ MujocoEnv::MujocoEnv(const std::string &admin_hash /* = std::string()*/)
 
 	ROS_DEBUG_COND(!settings_.use_sim_time, "use_sim_time is set to false. Not publishing sim time to /clock!");
 
-	nh_ = std::make_unique<ros::NodeHandle>("~");
+	nh_ = std::make_unique<ros::NodeHandle>(ns);
 	ROS_DEBUG_STREAM("New MujocoEnv created");
 
 	ROS_INFO("Using MuJoCo library version %s", mj_versionString());
@@ -120,7 +205,10 @@ MujocoEnv::MujocoEnv(const std::string &admin_hash /* = std::string()*/)
 		gui_adapter_ = new mujoco_ros::GlfwAdapter();
 	}
 
-	if (settings_.use_sim_time) {
+	nh_->param<bool>("publish_clock", publish_clock_, true);
+	ROS_DEBUG_COND(settings_.use_sim_time && !publish_clock_, "publish_clock is set to false. Not publishing sim time "
+	                                                          "of this environment to /clock!");
+	if (settings_.use_sim_time && publish_clock_) {
 		clock_pub_ = nh_->advertise<rosgraph_msgs::Clock>("/clock", 1);
 		publishSimTime(mjtNum(0));
 	}
@@ -133,12 +221,89 @@ MujocoEnv::MujocoEnv(const std::string &admin_hash /* = std::string()*/)
 	mjv_defaultScene(&scn_);
 	mjv_defaultPerturb(&pert_);
 
+	thread_config_.load(*nh_);
+	thread_config_.applyMemoryLock();
+
 	if (settings_.render_offscreen) {
 		MaybeGlfwInit();
 		ROS_DEBUG("Starting offscreen render thread");
 		offscreen_.render_thread_handle = boost::thread(&MujocoEnv::offscreenRenderLoop, this);
 	}
 
+	nh_->param<bool>("fast_reset", settings_.fast_reset, false);
+	ROS_INFO_COND(settings_.fast_reset, "Fast reset enabled, initial joint states are only read on model load");
+
+	nh_->param<std::string>("checkpoint/path", checkpoint_path_, "");
+	nh_->param<double>("checkpoint/period", checkpoint_period_, 1.0);
+	nh_->param<int>("checkpoint/count", checkpoint_count_, 4);
+	nh_->param<bool>("checkpoint/resume_on_load", checkpoint_resume_on_load_, false);
+	if (!checkpoint_path_.empty() && checkpoint_count_ < 1) {
+		ROS_WARN_STREAM("checkpoint/count must be at least 1 (got " << checkpoint_count_ << "). Using 1 instead");
+		checkpoint_count_ = 1;
+	}
+	ROS_INFO_STREAM_COND(!checkpoint_path_.empty(), "Writing checkpoints to '" << checkpoint_path_ << "' every "
+	                                                                            << checkpoint_period_
+	                                                                            << " seconds of simulation time");
+
+	nh_->param<bool>("model_cache/enabled", model_cache_enabled_, false);
+	if (model_cache_enabled_) {
+		std::string cache_path;
+		int cache_entries;
+		nh_->param<std::string>("model_cache/path", cache_path, "");
+		nh_->param<int>("model_cache/memory_entries", cache_entries, 2);
+		model_cache_.configure(cache_path, util::as_unsigned(std::max(cache_entries, 0)));
+		ROS_INFO_STREAM("Caching compiled models" << (cache_path.empty() ? "" : " in " + cache_path));
+	}
+
+	XmlRpc::XmlRpcValue randomization_config;
+	if (nh_->getParam("domain_randomization", randomization_config)) {
+		domain_randomizer_.init(randomization_config);
+	}
+
+	double body_states_rate;
+	nh_->param<double>("body_state_publisher/rate", body_states_rate, 0.0);
+	if (body_states_rate > 0) {
+		body_states_period_ = 1.0 / body_states_rate;
+		body_states_pub_    = nh_->advertise<mujoco_ros_msgs::BodyStates>("body_states", 1);
+		ROS_INFO_STREAM("Publishing body states with " << body_states_rate << " Hz (simulation time)");
+	}
+
+	bool tracing_enabled;
+	int trace_buffer_size;
+	nh_->param<bool>("tracing/enabled", tracing_enabled, false);
+	nh_->param<int>("tracing/buffer_size", trace_buffer_size, 65536);
+	nh_->param<std::string>("tracing/path", trace_path_, "/tmp/mujoco_ros_trace.json");
+	if (tracing_enabled) {
+		tracing::configure(true, util::as_unsigned(std::max(1, trace_buffer_size)));
+		ROS_INFO_STREAM("Tracing enabled with " << trace_buffer_size
+		                                        << " events per thread. Call dump_trace to write a Chrome trace");
+	}
+
+	double step_profile_rate;
+	nh_->param<double>("step_profiler/rate", step_profile_rate, 0.0);
+	if (step_profile_rate > 0) {
+		step_profiler_.configure(1.0 / step_profile_rate);
+		step_profile_pub_ = nh_->advertise<mujoco_ros_msgs::StepProfile>("step_profile", 1);
+		ROS_INFO_STREAM("Publishing step profiles with " << step_profile_rate << " Hz (wall time)");
+	}
+
+	double pacing_spin_threshold;
+	nh_->param<double>("pacing/spin_threshold", pacing_spin_threshold, 2e-4);
+	pacer_.setSpinThreshold(pacing_spin_threshold);
+
+	int batch_size;
+	nh_->param<int>("batch/size", batch_size, 0);
+	batch_.configure(batch_size);
+	ROS_INFO_STREAM_COND(batch_.isEnabled(), "Batch mode enabled with " << batch_size << " environments");
+
+	std::string shm_name;
+	int shm_slots;
+	bool shm_lockstep;
+	nh_->param<std::string>("shm/name", shm_name, "");
+	nh_->param<int>("shm/slots", shm_slots, 8);
+	nh_->param<bool>("shm/lockstep", shm_lockstep, false);
+	shm_server_.configure(shm_name, util::as_unsigned(std::max(shm_slots, 1)), shm_lockstep);
+
 	nh_->param<int>("num_steps", num_steps_until_exit_, -1);
 	ROS_INFO_STREAM_COND(num_steps_until_exit_ > 0, "Sim will terminate after " << num_steps_until_exit_ << " steps");
 
@@ -148,18 +313,24 @@ MujocoEnv::MujocoEnv(const std::string &admin_hash /* = std::string()*/)
 	num_threads           = std::min(num_threads, available_threads);
 	if (num_threads > 1) {
 		threadpool_ = mju_threadPoolCreate(num_threads);
+		thread_config_.applyToThreadPool(threadpool_, num_threads);
 		ROS_INFO_STREAM("Using MuJoCo threadpool size of " << num_threads << " (max available: " << available_threads
 		                                                   << ")");
 	} else {
 		ROS_INFO_STREAM("Running MuJoCo in single-threaded mode (" << available_threads << " threads available)");
 	}
 
-	// init VFS
-	mj_defaultVFS(&vfs_);
+	nh_->param<bool>("parallel_control_cbs", parallel_control_cbs_, false);
+	if (parallel_control_cbs_ && threadpool_ == nullptr) {
+		ROS_WARN("Parallel control callbacks require the MuJoCo threadpool (num_mj_threads > 1). Running control "
+		         "callbacks serially.");
+		parallel_control_cbs_ = false;
+	}
+	nh_->param<bool>("parallel_plugin_load", parallel_plugin_load_, false);
 
 	setupServices();
 
-	MujocoEnv::instance = this;
+	registerEnv(this);
 
 	mjcb_control = proxyControlCB;
 	mjcb_passive = proxyPassiveCB;
@@ -174,6 +345,7 @@ MujocoEnv::MujocoEnv(const std::string &admin_hash /* = std::string()*/)
 
 void MujocoEnv::registerCollisionFunction(int geom_type1, int geom_type2, mjfCollision collision_cb)
 {
+	std::lock_guard<std::mutex> lk(plugin_registration_mutex_);
 	if (custom_collisions_.find(std::pair(geom_type1, geom_type2)) != custom_collisions_.end() &&
 	    custom_collisions_.find(std::pair(geom_type2, geom_type2)) != custom_collisions_.end()) {
 		ROS_WARN_STREAM_NAMED("mujoco", "A user defined collision callback for collisions between geoms of type "
@@ -189,6 +361,7 @@ void MujocoEnv::registerCollisionFunction(int geom_type1, int geom_type2, mjfCol
 
 void MujocoEnv::registerStaticTransform(geometry_msgs::TransformStamped &transform)
 {
+	std::lock_guard<std::mutex> lk(plugin_registration_mutex_);
 	ROS_DEBUG_STREAM_NAMED("mujoco", "Registering static transform for frame " << transform.child_frame_id);
 	for (auto it = static_transforms_.begin(); it != static_transforms_.end();) {
 		if (it->child_frame_id == transform.child_frame_id) {
@@ -209,37 +382,52 @@ void MujocoEnv::registerStaticTransform(geometry_msgs::TransformStamped &transfo
 void MujocoEnv::eventLoop()
 {
 	ROS_DEBUG("Starting event loop");
+	tracing::setThreadName("event");
+	thread_config_.applyToCurrentThread(ThreadConfig::kEvent);
 	is_event_running_ = 1;
 	auto now          = Clock::now();
 	auto fps_cap      = Seconds(mujoco_ros::Viewer::render_ui_rate_upper_bound_); // Cap at 60 fps
-	while (ros::ok() && !settings_.exit_request.load() && (!settings_.headless)) {
+	// Keeps running in headless mode to handle load and reset requests
+	while (ros::ok() && !settings_.exit_request.load()) {
 		{
+			const int64_t lock_start = tracing::isEnabled() ? tracing::now() : -1;
 			std::unique_lock<std::recursive_mutex> lock(physics_thread_mutex_);
+			if (lock_start >= 0) {
+				tracing::record("event_mutex_wait", "lock", lock_start, tracing::now());
+			}
 			now = Clock::now();
 
 			if (settings_.load_request.load() == 1) {
 				ROS_DEBUG("Load request received");
-				loadWithModelAndData();
-				ROS_DEBUG("Done loading");
+				if (model_load_thread_handle_.joinable()) {
+					model_load_thread_handle_.join();
+				}
+				if (applyCompileResult()) {
+					// Stepping pauses until the new model and its plugins are loaded
+					loadWithModelAndData();
+					ROS_DEBUG("Done loading");
+				}
 
 				mnew = nullptr;
 				dnew = nullptr;
-				settings_.load_request.store(0);
+				// Keep requests that were queued during the swap
+				int expected = 1;
+				settings_.load_request.compare_exchange_strong(expected, 0);
 				sim_state_.load_count += 1;
-			} else if (settings_.load_request.load() >= 2) { // Loading mnew and dnew requested
-				ROS_DEBUG("Initializing queued model and data");
-				if (initModelFromQueue()) {
-					ROS_DEBUG("Init for load done. Requesting next load step");
-					settings_.load_request.store(1);
-				} else {
-					ROS_ERROR("Init for load failed. Aborting load request");
-					mj_deleteData(dnew);
-					mj_deleteModel(mnew);
-					mnew = nullptr;
-					dnew = nullptr;
-					settings_.load_request.store(0);
-					sim_state_.load_count += 1;
+			} else if ((settings_.load_request.load() == 2 || settings_.load_request.load() == 3) &&
+			           !model_compiling_.load()) { // Loading mnew and dnew requested
+				// Compile without holding the lock, the current model keeps running until the swap
+				ROS_DEBUG("Compiling queued model in the background");
+				if (model_load_thread_handle_.joinable()) {
+					model_load_thread_handle_.join();
 				}
+				// A finished compilation that was superseded before its swap
+				mj_deleteData(dnew);
+				mj_deleteModel(mnew);
+				mnew = nullptr;
+				dnew = nullptr;
+				model_compiling_.store(true);
+				model_load_thread_handle_ = boost::thread(&MujocoEnv::compileQueuedModel, this, takeQueuedModel());
 			}
 
 			if (settings_.reset_request.load()) {
@@ -249,6 +437,7 @@ void MujocoEnv::eventLoop()
 
 		std::this_thread::sleep_for(fps_cap - now.time_since_epoch());
 	}
+	joinModelLoadThread();
 	ROS_DEBUG("Closing all connected viewers");
 	for (const auto viewer : connected_viewers_) {
 		viewer->exit_request.store(1);
@@ -259,13 +448,26 @@ void MujocoEnv::eventLoop()
 
 void MujocoEnv::resetSim()
 {
-	ROS_DEBUG("Sleeping to ensure all (old) ROS messages are sent");
-	std::this_thread::sleep_for(std::chrono::milliseconds(100));
-	ROS_DEBUG("Resetting simulation environment");
+	MUJOCO_ROS_TRACE_SCOPE("reset", "event");
+	if (domain_randomizer_.isEnabled() && domain_randomizer_.apply(model_.get())) {
+		// The state is reset afterwards, so there is no need to preserve qpos
+		mj_setConst(this->model_.get(), this->data_.get());
+	}
 
-	mj_resetData(this->model_.get(), this->data_.get());
-	loadInitialJointStates();
+	if (settings_.fast_reset && !initial_state_.empty()) {
+		ROS_DEBUG("Restoring initial state snapshot");
+		mj_setState(this->model_.get(), this->data_.get(), initial_state_.data(), kResetStateSig);
+		mj_forward(this->model_.get(), this->data_.get());
+	} else {
+		ROS_DEBUG("Sleeping to ensure all (old) ROS messages are sent");
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		ROS_DEBUG("Resetting simulation environment");
+
+		mj_resetData(this->model_.get(), this->data_.get());
+		loadInitialJointStates();
+	}
 	publishSimTime(this->data_->time);
+	shm_server_.publish(this->data_.get());
 
 	for (auto &plugin : plugins_) {
 		plugin->safe_reset();
@@ -278,6 +480,149 @@ void MujocoEnv::resetSim()
 	settings_.reset_request.store(0);
 }
 
+bool MujocoEnv::saveState(const std::string &slot)
+{
+	std::lock_guard<std::recursive_mutex> lock(physics_thread_mutex_);
+	if (model_ == nullptr || data_ == nullptr) {
+		return false;
+	}
+
+	// Reuses the slot's memory when overwriting
+	auto &state = state_slots_[slot];
+	state.resize(util::as_unsigned(mj_stateSize(model_.get(), kResetStateSig)));
+	mj_getState(model_.get(), data_.get(), state.data(), kResetStateSig);
+	return true;
+}
+
+bool MujocoEnv::restoreState(const std::string &slot)
+{
+	std::lock_guard<std::recursive_mutex> lock(physics_thread_mutex_);
+	const auto it = state_slots_.find(slot);
+	if (it == state_slots_.end() || model_ == nullptr || data_ == nullptr) {
+		return false;
+	}
+
+	mj_setState(model_.get(), data_.get(), it->second.data(), kResetStateSig);
+	mj_forward(model_.get(), data_.get());
+	publishSimTime(data_->time);
+	return true;
+}
+
+void MujocoEnv::openCheckpointFile()
+{
+	const bool resume = checkpoint_resume_on_load_ || settings_.checkpoint_resume_request.exchange(0) != 0;
+	if (checkpoint_path_.empty()) {
+		ROS_WARN_COND(resume, "Resuming from a checkpoint was requested, but no checkpoint/path is configured");
+		return;
+	}
+
+	const uint64_t state_size = util::as_unsigned(mj_stateSize(model_.get(), kResetStateSig));
+	const uint64_t signature  = CheckpointFile::modelSignature(model_.get(), kResetStateSig);
+	if (!checkpoint_file_.open(CheckpointFile::signaturePath(checkpoint_path_, signature), state_size,
+	                           util::as_unsigned(checkpoint_count_), signature)) {
+		ROS_ERROR("Could not open checkpoint file, checkpointing is disabled for this model");
+		return;
+	}
+	last_checkpoint_time_ = data_->time;
+
+	if (resume) {
+		std::vector<mjtNum> state(state_size);
+		mjtNum time;
+		if (checkpoint_file_.readLatest(state.data(), time)) {
+			mj_setState(model_.get(), data_.get(), state.data(), kResetStateSig);
+			mj_forward(model_.get(), data_.get());
+			publishSimTime(data_->time);
+			last_checkpoint_time_ = time;
+			ROS_INFO_STREAM("Resumed from checkpoint at time " << time);
+		} else {
+			ROS_WARN("No valid checkpoint found for the current model. Starting from the initial state");
+		}
+	}
+}
+
+void MujocoEnv::setupBodyStatesPublisher()
+{
+	body_states_ids_.clear();
+	body_states_msg_.states.clear();
+	if (body_states_period_ <= 0) {
+		return;
+	}
+
+	std::vector<std::string> body_names;
+	if (nh_->getParam("body_state_publisher/bodies", body_names) && !body_names.empty()) {
+		for (const auto &name : body_names) {
+			int body_id = mj_name2id(model_.get(), mjOBJ_BODY, name.c_str());
+			if (body_id == -1) {
+				ROS_WARN_STREAM("Body '" << name << "' configured for the body state publisher does not exist, skipping");
+				continue;
+			}
+			body_states_ids_.push_back(body_id);
+		}
+	} else { // Default to all free bodies
+		for (int body_id = 1; body_id < model_->nbody; ++body_id) {
+			if (model_->body_jntnum[body_id] == 1 && model_->jnt_type[model_->body_jntadr[body_id]] == mjJNT_FREE) {
+				body_states_ids_.push_back(body_id);
+			}
+		}
+	}
+
+	body_states_msg_.states.resize(body_states_ids_.size());
+	for (size_t i = 0; i < body_states_ids_.size(); ++i) {
+		auto &state                = body_states_msg_.states[i];
+		const char *name           = mj_id2name(model_.get(), mjOBJ_BODY, body_states_ids_[i]);
+		state.name                 = name ? name : std::to_string(body_states_ids_[i]);
+		state.pose.header.frame_id = "world";
+		state.twist.header         = state.pose.header;
+	}
+	last_body_states_time_ = data_->time - body_states_period_;
+	ROS_DEBUG_STREAM("Streaming states of " << body_states_ids_.size() << " bodies");
+}
+
+void MujocoEnv::publishBodyStates()
+{
+	if (body_states_ids_.empty()) {
+		return;
+	}
+	if (data_->time < last_body_states_time_) { // time was reset
+		last_body_states_time_ = data_->time - body_states_period_;
+	}
+	if (data_->time - last_body_states_time_ < body_states_period_ || body_states_pub_.getNumSubscribers() == 0) {
+		return;
+	}
+	last_body_states_time_ = data_->time;
+
+	// Positions and velocities were computed by mj_step before integrating, i.e. they belong to the previous step
+	const ros::Time stamp(std::max<mjtNum>(0, data_->time - model_->opt.timestep));
+	body_states_msg_.header.stamp = stamp;
+	mjtNum vel[6];
+	for (size_t i = 0; i < body_states_ids_.size(); ++i) {
+		const int body_id = body_states_ids_[i];
+		auto &state       = body_states_msg_.states[i];
+
+		state.pose.header.stamp       = stamp;
+		state.pose.pose.position.x    = data_->xpos[3 * body_id];
+		state.pose.pose.position.y    = data_->xpos[3 * body_id + 1];
+		state.pose.pose.position.z    = data_->xpos[3 * body_id + 2];
+		state.pose.pose.orientation.w = data_->xquat[4 * body_id];
+		state.pose.pose.orientation.x = data_->xquat[4 * body_id + 1];
+		state.pose.pose.orientation.y = data_->xquat[4 * body_id + 2];
+		state.pose.pose.orientation.z = data_->xquat[4 * body_id + 3];
+
+		// Velocity of the body frame in world orientation, derived from cvel ([rot lin])
+		mj_objectVelocity(model_.get(), data_.get(), mjOBJ_XBODY, body_id, vel, 0);
+		state.twist.header.stamp    = stamp;
+		state.twist.twist.angular.x = vel[0];
+		state.twist.twist.angular.y = vel[1];
+		state.twist.twist.angular.z = vel[2];
+		state.twist.twist.linear.x  = vel[3];
+		state.twist.twist.linear.y  = vel[4];
+		state.twist.twist.linear.z  = vel[5];
+
+		state.mass = static_cast<decltype(state.mass)>(model_->body_mass[body_id]);
+	}
+	body_states_pub_.publish(body_states_msg_);
+}
+
 void MujocoEnv::loadInitialJointStates()
 {
 	ROS_DEBUG("Fetching and applying initial joint positions ...");
@@ -420,6 +765,31 @@ void MujocoEnv::completeEnvSetup()
 {
 	loadInitialJointStates();
 
+	initial_state_.resize(util::as_unsigned(mj_stateSize(model_.get(), kResetStateSig)));
+	mj_getState(model_.get(), data_.get(), initial_state_.data(), kResetStateSig);
+	setupBatch();
+
+	if (shm_server_.isEnabled()) {
+		std::string error;
+		if (shm_server_.open(model_.get(), data_.get(), error)) {
+			ROS_INFO_STREAM("Exchanging actions and observations through shared memory "
+			                << shm_server_.name() << (shm_server_.isLockstep() ? " in lockstep" : ""));
+		} else {
+			ROS_ERROR_STREAM("Could not set up shared memory transport: " << error);
+		}
+	}
+
+	openCheckpointFile();
+	setupBodyStatesPublisher();
+
+	name_id_cache_.clear();
+	for (const mjtObj type : { mjOBJ_BODY, mjOBJ_JOINT, mjOBJ_GEOM, mjOBJ_TENDON, mjOBJ_EQUALITY }) {
+		name_id_cache_.add(model_.get(), type);
+	}
+	if (domain_randomizer_.isEnabled()) {
+		domain_randomizer_.load(model_.get());
+	}
+
 	ROS_DEBUG("Resetting noise ...");
 	free(ctrlnoise_);
 	ctrlnoise_ = static_cast<mjtNum *>(mju_malloc(sizeof(mjtNum) * static_cast<size_t>(model_->nu)));
@@ -440,15 +810,138 @@ void MujocoEnv::loadPlugins()
 		plugin_utils::registerPlugins(nh_->getNamespace(), plugin_config, plugins_, this);
 	}
 
-	for (const auto &plugin : plugins_) {
-		if (plugin->safe_load(model_.get(), data_.get())) {
-			cb_ready_plugins_.emplace_back(plugin.get());
+	const auto start = Clock::now();
+	std::vector<char> loaded(plugins_.size(), 0);
+	if (parallel_plugin_load_) {
+		// Each plugin starts as soon as the plugins it depends on have finished loading
+		const auto deps = plugin_utils::computeLoadDependencies(plugins_);
+		std::mutex done_mutex;
+		std::condition_variable done_cv;
+		std::vector<char> done(plugins_.size(), 0);
+		std::vector<boost::thread> workers;
+		workers.reserve(plugins_.size());
+		for (std::size_t i = 0; i < plugins_.size(); ++i) {
+			workers.emplace_back([this, i, &deps, &done_mutex, &done_cv, &done, &loaded]() {
+				{
+					std::unique_lock<std::mutex> lk(done_mutex);
+					done_cv.wait(lk, [&]() {
+						return std::all_of(deps[i].begin(), deps[i].end(), [&](std::size_t j) { return done[j] != 0; });
+					});
+				}
+				loaded[i] = plugins_[i]->safe_load(model_.get(), data_.get());
+				{
+					std::lock_guard<std::mutex> lk(done_mutex);
+					done[i] = 1;
+				}
+				done_cv.notify_all();
+			});
+		}
+		for (auto &worker : workers) {
+			worker.join();
+		}
+	} else {
+		for (std::size_t i = 0; i < plugins_.size(); ++i) {
+			loaded[i] = plugins_[i]->safe_load(model_.get(), data_.get());
 		}
-		ROS_DEBUG_STREAM("Loading plugin " << plugin->type_ << " took " << plugin->load_time_ << " seconds");
 	}
+
+	// Keep the configured order for callbacks, regardless of the order plugins finished loading in
+	for (std::size_t i = 0; i < plugins_.size(); ++i) {
+		if (loaded[i]) {
+			cb_ready_plugins_.emplace_back(plugins_[i].get());
+		}
+		ROS_DEBUG_STREAM("Loading plugin " << plugins_[i]->type_ << " took " << plugins_[i]->load_time_ << " seconds");
+	}
+	ROS_DEBUG_STREAM("Loading all plugins took " << Seconds(Clock::now() - start).count() << " seconds");
+	partitionControlCbs();
 	ROS_DEBUG("Done loading MujocoRosPlugins");
 }
 
+void MujocoEnv::partitionControlCbs()
+{
+	parallel_control_tasks_.clear();
+	serial_control_plugins_.clear();
+
+	if (!parallel_control_cbs_) {
+		serial_control_plugins_ = cb_ready_plugins_;
+		return;
+	}
+
+	// Write sets of all plugins are collected first, so a plugin runs serially if it overlaps with any other plugin,
+	// regardless of the configured order
+	struct WriteSet
+	{
+		bool complete = false;
+		std::vector<int> qpos, dofs, actuators;
+	};
+	std::vector<WriteSet> write_sets(cb_ready_plugins_.size());
+	std::vector<int> qpos_writers(util::as_unsigned(model_->nq), 0);
+	std::vector<int> dof_writers(util::as_unsigned(model_->nv), 0);
+	std::vector<int> actuator_writers(util::as_unsigned(model_->nu), 0);
+
+	const auto valid = [](const std::vector<int> &writers, std::vector<int> &ids) {
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		return ids.empty() || (ids.front() >= 0 && ids.back() < static_cast<int>(writers.size()));
+	};
+	const auto count = [](std::vector<int> &writers, const std::vector<int> &ids) {
+		for (const int id : ids) {
+			writers[util::as_unsigned(id)]++;
+		}
+	};
+	const auto exclusive = [](const std::vector<int> &writers, const std::vector<int> &ids) {
+		return std::all_of(ids.begin(), ids.end(), [&](int id) { return writers[util::as_unsigned(id)] == 1; });
+	};
+
+	for (std::size_t i = 0; i < cb_ready_plugins_.size(); ++i) {
+		auto &set = write_sets[i];
+		if (!cb_ready_plugins_[i]->getControlWriteSet(model_.get(), set.qpos, set.dofs, set.actuators)) {
+			continue;
+		}
+		if (!valid(qpos_writers, set.qpos) || !valid(dof_writers, set.dofs) ||
+		    !valid(actuator_writers, set.actuators)) {
+			ROS_WARN_STREAM("Control write set of plugin " << cb_ready_plugins_[i]->type_
+			                                               << " is invalid. Its control callback will run serially.");
+			continue;
+		}
+		set.complete = true;
+		count(qpos_writers, set.qpos);
+		count(dof_writers, set.dofs);
+		count(actuator_writers, set.actuators);
+	}
+
+	for (std::size_t i = 0; i < cb_ready_plugins_.size(); ++i) {
+		auto *plugin    = cb_ready_plugins_[i];
+		const auto &set = write_sets[i];
+		if (!set.complete) {
+			serial_control_plugins_.emplace_back(plugin);
+			continue;
+		}
+		if (!exclusive(qpos_writers, set.qpos) || !exclusive(dof_writers, set.dofs) ||
+		    !exclusive(actuator_writers, set.actuators)) {
+			ROS_WARN_STREAM("Control write set of plugin " << plugin->type_
+			                                               << " overlaps with another plugin. Its control callback "
+			                                                  "will run serially.");
+			serial_control_plugins_.emplace_back(plugin);
+			continue;
+		}
+
+		ControlTask task;
+		task.plugin = plugin;
+		parallel_control_tasks_.emplace_back(task);
+	}
+
+	if (parallel_control_tasks_.size() < 2) {
+		// Nothing to gain from dispatching a single callback
+		parallel_control_tasks_.clear();
+		serial_control_plugins_ = cb_ready_plugins_;
+		return;
+	}
+
+	ROS_INFO_STREAM("Running " << parallel_control_tasks_.size() << " control callbacks in parallel, "
+	                           << serial_control_plugins_.size() << " serially");
+}
+
 void MujocoEnv::UpdateModelFlags(const mjOption *opt)
 {
 	std::unique_lock<std::recursive_mutex> lock(physics_thread_mutex_);
@@ -513,7 +1006,7 @@ void MujocoEnv::disconnectViewer(Viewer *viewer)
 
 void MujocoEnv::publishSimTime(mjtNum time)
 {
-	if (!settings_.use_sim_time) {
+	if (!settings_.use_sim_time || !publish_clock_) {
 		return;
 	}
 	// This is the fastes option for intra-node time updates
@@ -559,6 +1052,9 @@ int MujocoEnv::getOperationalStatus()
 
 void MujocoEnv::loadWithModelAndData()
 {
+	MUJOCO_ROS_TRACE_SCOPE("load_model", "event");
+	releaseBatch();
+	rebindEnvData(this, data_.get(), dnew);
 	model_.reset(mnew, mj_deleteModel);
 	data_.reset(dnew, mj_deleteData);
 
@@ -587,103 +1083,90 @@ void MujocoEnv::loadWithModelAndData()
 	sim_state_.model_valid = true;
 }
 
-bool MujocoEnv::initModelFromQueue()
+void MujocoEnv::setupBatch()
 {
-	// clear previous error message
-	load_error_[0] = '\0';
-
-	bool is_new = false;
-	if (queued_filename_[0]) {
-		is_new = mju::strcmp_arr(filename_, queued_filename_);
+	if (!batch_.isEnabled()) {
+		return;
 	}
-
-	if (!is_new) {
-		mju::strcpy_arr(queued_filename_, filename_);
+	batch_.init(model_.get(), data_.get());
+	// Batch environments do not run plugins, their callbacks must not be routed to the main data
+	for (const auto *d : batch_.data()) {
+		rebindEnvData(nullptr, nullptr, d);
 	}
+	ROS_DEBUG_STREAM("Created " << batch_.size() << " batch environments");
+}
 
-	bool is_mjb = false;
-	if (mju::strlen_arr(queued_filename_) > 4 &&
-	    !std::strncmp(queued_filename_ + mju::strlen_arr(queued_filename_) - 4, ".mjb",
-	                  mju::sizeof_arr(queued_filename_) - mju::strlen_arr(queued_filename_) + 4)) {
-		is_mjb = true;
+void MujocoEnv::releaseBatch()
+{
+	for (const auto *d : batch_.data()) {
+		rebindEnvData(nullptr, d, nullptr);
 	}
+	batch_.clear();
+}
 
-	bool is_file = false;
-	if (mju::strlen_arr(queued_filename_) > 4 &&
-	    !std::strncmp(queued_filename_ + mju::strlen_arr(queued_filename_) - 4, ".xml",
-	                  mju::sizeof_arr(queued_filename_) - mju::strlen_arr(queued_filename_) + 4)) {
-		is_file = true;
-	} else {
-		try {
-			is_file = boost::filesystem::is_regular_file(queued_filename_);
-		} catch (const boost::filesystem::filesystem_error &ex) {
-			ROS_DEBUG_STREAM("\tFilesystem error while checking for regular file: " << ex.what());
-		}
+bool MujocoEnv::queueModel(const std::string &model, int request /* = 2*/)
+{
+	if (model.size() >= static_cast<std::size_t>(kMaxFilenameLength)) {
+		ROS_ERROR_STREAM("Model string too long. Max length: "
+		                 << kMaxFilenameLength - 1 << " (got " << model.size()
+		                 << "); Consider compiling with a larger value for kMaxFilenameLength");
+		return false;
 	}
+	std::lock_guard<std::mutex> lock(queue_mutex_);
+	mju::strcpy_arr(queued_filename_, model.c_str());
+	settings_.load_request.store(request);
+	return true;
+}
 
-	if (is_file) {
-		ROS_DEBUG("\tModel is a regular file. Loading from filesystem");
-	} else if (queued_filename_[0] != '\0') { // new model string
-		ROS_DEBUG("\tModel is not a regular file. Loading from string");
-
-		ROS_WARN("Loading nested resources (textures, meshes, ...) from string is broken since 2.3.4. A fix is on the "
-		         "way (see https://github.com/deepmind/mujoco/discussions/957#discussion-5348269)");
+std::string MujocoEnv::takeQueuedModel()
+{
+	// Dispatching under the queue lock ensures a request queued concurrently is not overwritten by load_request 4
+	std::lock_guard<std::mutex> lock(queue_mutex_);
+	std::string model = queued_filename_[0] ? queued_filename_ : filename_;
+	queued_filename_[0] = '\0';
+	settings_.load_request.store(4);
+	return model;
+}
 
-		mj_addBufferVFS(&vfs_, "model_testing", queued_filename_, mju::strlen_arr(queued_filename_));
-		ROS_DEBUG("\tSaved string content to VFS");
+void MujocoEnv::compileQueuedModel(const std::string &model)
+{
+	tracing::setThreadName("model_compile");
+	{
+		MUJOCO_ROS_TRACE_SCOPE("compile_model", "event");
+		initModelFromQueue(model);
 	}
 
-	auto load_start = Clock::now();
-	if (is_mjb) {
-		ROS_DEBUG("\tLoading mjb file");
-		mnew = mj_loadModel(queued_filename_, nullptr);
-	} else {
-		if (is_file) {
-			ROS_DEBUG("\tLoading xml file");
-			mnew = mj_loadXML(queued_filename_, nullptr, load_error_, kErrorLength);
-		} else {
-			ROS_DEBUG("\tLoading virtual file from VFS");
-			mnew = mj_loadXML("model_testing", &vfs_, load_error_, kErrorLength);
-		}
+	// Success and failure are both reported to the event loop, which applies them under the physics mutex
+	int expected = 4;
+	if (settings_.load_request.compare_exchange_strong(expected, 1)) {
+		ROS_DEBUG("Init for load done. Requesting next load step");
+		model_compiling_.store(false);
+		return;
 	}
 
-	auto load_interval  = Clock::now() - load_start;
-	double load_seconds = Seconds(load_interval).count();
+	ROS_DEBUG("Compiled model was superseded by a newer load request. Discarding it");
+	mj_deleteData(dnew);
+	mj_deleteModel(mnew);
+	mnew = nullptr;
+	dnew = nullptr;
+	model_compiling_.store(false);
+}
+
+bool MujocoEnv::applyCompileResult()
+{
+	mju::strcpy_arr(load_error_, compiled_.error);
 
 	if (!mnew) {
 		for (const auto viewer : connected_viewers_) {
 			mju::strcpy_arr(viewer->load_error, load_error_);
 		}
-
 		ROS_ERROR_STREAM("Loading new model failed: " << load_error_);
 		ROS_DEBUG("\tRolling back old model");
-
-		if (!is_file) {
-			mj_deleteFileVFS(&vfs_, "model_testing");
-		}
-
-		// 'clear' new filename
-		queued_filename_[0] = '\0';
-
 		sim_state_.model_valid = false;
 		return false;
 	}
 
-	ROS_INFO_STREAM("Model loaded in " << load_seconds << " seconds");
-	ROS_DEBUG("Model compiled successfully");
-	dnew = mj_makeData(mnew);
-
-	if (!is_file) {
-		ROS_DEBUG("\tAdding new model permanently to VFS");
-		std::size_t length = mju::strlen_arr(queued_filename_);
-		mj_addBufferVFS(&vfs_, "model_string", queued_filename_, length);
-		mj_deleteFileVFS(&vfs_, "model_testing");
-	}
-
-	// 'clear' filename in queue
-	mju::strcpy_arr(filename_, queued_filename_);
-	queued_filename_[0] = '\0';
-	// delete allocated memory for VFS backup
+	mju::strcpy_arr(filename_, compiled_.filename.c_str());
 
 	// Compiler warning: print and pause
 	if (load_error_[0]) {
@@ -692,8 +1175,8 @@ bool MujocoEnv::initModelFromQueue()
 		if (!settings_.headless)
 			settings_.run = 0;
 	} else {
-		if (load_seconds > 0.25) {
-			mju::sprintf_arr(load_error_, "Model loaded in %.2g seconds", load_seconds);
+		if (compiled_.seconds > 0.25) {
+			mju::sprintf_arr(load_error_, "Model loaded in %.2g seconds", compiled_.seconds);
 		}
 	}
 
@@ -702,27 +1185,113 @@ bool MujocoEnv::initModelFromQueue()
 	}
 
 	// Update real-time settings
-	int num_clicks  = sizeof(percentRealTime) / sizeof(percentRealTime[0]);
-	float min_error = 1e6f;
 	float desired;
 	nh_->param<float>("realtime", desired, mnew->vis.global.realtime);
 
 	if (desired == -1.f) {
-		settings_.real_time_index = 0;
-	} else if (desired <= 0.f or desired > 1.f) {
-		ROS_WARN("Desired realtime should be in range (0, 1]. Falling back to default (1)");
-		settings_.real_time_index = 1;
+		settings_.rt_factor = -1.f;
+	} else if (desired <= 0.f) {
+		ROS_WARN("Desired realtime should be positive or -1 (unbound). Falling back to default (1)");
+		settings_.rt_factor = 1.f;
+	} else {
+		settings_.rt_factor = std::clamp(desired, kMinRealTimeFactor, kMaxRealTimeFactor);
+		ROS_WARN_STREAM_COND(settings_.rt_factor != desired, "Desired realtime " << desired << " out of range, clamping to "
+		                                                                          << settings_.rt_factor);
+	}
+	settings_.real_time_index = closestRealTimeIndex(settings_.rt_factor);
+
+	return true;
+}
+
+void MujocoEnv::joinModelLoadThread()
+{
+	if (model_load_thread_handle_.joinable()) {
+		model_load_thread_handle_.join();
+	}
+	if (settings_.load_request.load() == 1) {
+		mj_deleteData(dnew);
+		mj_deleteModel(mnew);
+		mnew = nullptr;
+		dnew = nullptr;
+		settings_.load_request.store(0);
+	}
+}
+
+bool MujocoEnv::initModelFromQueue(const std::string &model)
+{
+	// clear previous error message
+	compiled_.error[0] = '\0';
+	compiled_.filename = model;
+	compiled_.seconds  = 0;
+
+	const char *filename = model.c_str();
+	const bool is_mjb    = hasSuffix(model, ".mjb");
+
+	bool is_file = false;
+	if (hasSuffix(model, ".xml")) {
+		is_file = true;
+	} else {
+		try {
+			is_file = boost::filesystem::is_regular_file(filename);
+		} catch (const boost::filesystem::filesystem_error &ex) {
+			ROS_DEBUG_STREAM("\tFilesystem error while checking for regular file: " << ex.what());
+		}
+	}
+
+	// VFS for loading models from strings, local to this compilation
+	mjVFS vfs;
+	mj_defaultVFS(&vfs);
+	if (is_file) {
+		ROS_DEBUG("\tModel is a regular file. Loading from filesystem");
+	} else if (!model.empty()) { // new model string
+		ROS_DEBUG("\tModel is not a regular file. Loading from string");
+
+		ROS_WARN("Loading nested resources (textures, meshes, ...) from string is broken since 2.3.4. A fix is on the "
+		         "way (see https://github.com/deepmind/mujoco/discussions/957#discussion-5348269)");
+
+		mj_addBufferVFS(&vfs, "model_string", filename, model.size());
+		ROS_DEBUG("\tSaved string content to VFS");
+	}
+
+	auto load_start = Clock::now();
+	bool cache_hit  = false;
+	if (is_mjb) {
+		ROS_DEBUG("\tLoading mjb file");
+		mnew = mj_loadModel(filename, nullptr);
 	} else {
-		desired = mju_log(100 * desired);
-		for (int click = 0; click < num_clicks; click++) {
-			float error = mju_abs(mju_log(percentRealTime[click]) - desired);
-			if (error < min_error) {
-				min_error                 = error;
-				settings_.real_time_index = click;
+		uint64_t cache_key = 0;
+		// The key of a string does not cover the files it references
+		const bool cacheable = model_cache_enabled_ && (is_file || !ModelCache::referencesFiles(model));
+		if (cacheable) {
+			cache_key = is_file ? ModelCache::keyForFile(filename) : ModelCache::keyForString(filename);
+			mnew      = model_cache_.get(cache_key);
+			cache_hit = mnew != nullptr;
+		}
+
+		if (!cache_hit) {
+			if (is_file) {
+				ROS_DEBUG("\tLoading xml file");
+				mnew = mj_loadXML(filename, nullptr, compiled_.error, kErrorLength);
+			} else {
+				ROS_DEBUG("\tLoading virtual file from VFS");
+				mnew = mj_loadXML("model_string", &vfs, compiled_.error, kErrorLength);
+			}
+			if (mnew && cacheable) {
+				model_cache_.put(cache_key, mnew);
 			}
 		}
 	}
+	mj_deleteVFS(&vfs);
+
+	compiled_.seconds = Seconds(Clock::now() - load_start).count();
+
+	if (!mnew) {
+		return false;
+	}
 
+	ROS_INFO_STREAM("Model loaded in " << compiled_.seconds << " seconds" << (cache_hit ? " (from cache)" : ""));
+	ROS_DEBUG("Model compiled successfully");
+	dnew = mj_makeData(mnew);
 	return true;
 }
 
@@ -772,18 +1341,46 @@ void MujocoEnv::prepareReload()
 	offscreen_.rgb.reset();
 	offscreen_.depth.reset();
 	cb_ready_plugins_.clear();
+	parallel_control_tasks_.clear();
+	serial_control_plugins_.clear();
 	plugins_.clear();
 	offscreen_.cams.clear();
+	state_slots_.clear();
+}
+
+int MujocoEnv::closestRealTimeIndex(float factor)
+{
+	if (factor <= 0.f) {
+		return 0;
+	}
+	// compare on a log scale, like the viewer's speed controls
+	const int num_clicks = sizeof(percentRealTime) / sizeof(percentRealTime[0]);
+	const float desired  = mju_log(100 * factor);
+	float min_error      = 1e6f;
+	int index            = 1;
+	for (int click = 1; click < num_clicks; click++) {
+		const float error = mju_abs(mju_log(percentRealTime[click]) - desired);
+		if (error < min_error) {
+			min_error = error;
+			index     = click;
+		}
+	}
+	return index;
 }
 
 MujocoEnv::~MujocoEnv()
 {
 	ROS_DEBUG("Destructor called");
+	unregisterEnv(this);
+	joinModelLoadThread();
+	releaseBatch();
+	shm_server_.close();
 	connected_viewers_.clear();
 	free(this->ctrlnoise_);
 	this->cb_ready_plugins_.clear();
+	this->parallel_control_tasks_.clear();
+	this->serial_control_plugins_.clear();
 	this->plugins_.clear();
-	mj_deleteVFS(&vfs_);
 
 	if (threadpool_ != nullptr) {
 		mju_threadPoolDestroy(threadpool_);
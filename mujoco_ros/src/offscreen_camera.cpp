@@ -188,17 +188,23 @@ bool OffscreenCamera::renderAndPubIfNecessary(mujoco_ros::OffscreenRenderContext
 	offscreen->con.offHeight = height_;
 	mjrRect viewport         = mjr_maxViewport(&offscreen->con);
 
-	// Update from scn_state_
-	mjv_updateSceneFromState(&scn_state_, &vopt_, nullptr, &offscreen->cam, mjCAT_ALL, &offscreen->scn);
-	// Render to buffer
-	mjr_render(viewport, &offscreen->scn, &offscreen->con);
-	// read buffers
-	if (rgb && depth) {
-		mjr_readPixels(offscreen->rgb.get(), offscreen->depth.get(), viewport, &offscreen->con);
-	} else if (rgb) {
-		mjr_readPixels(offscreen->rgb.get(), nullptr, viewport, &offscreen->con);
-	} else if (depth) {
-		mjr_readPixels(nullptr, offscreen->depth.get(), viewport, &offscreen->con);
+	{
+		MUJOCO_ROS_TRACE_SCOPE("mjr_render", "render");
+		// Update from scn_state_
+		mjv_updateSceneFromState(&scn_state_, &vopt_, nullptr, &offscreen->cam, mjCAT_ALL, &offscreen->scn);
+		// Render to buffer
+		mjr_render(viewport, &offscreen->scn, &offscreen->con);
+	}
+	{
+		MUJOCO_ROS_TRACE_SCOPE("mjr_readPixels", "readback");
+		// read buffers
+		if (rgb && depth) {
+			mjr_readPixels(offscreen->rgb.get(), offscreen->depth.get(), viewport, &offscreen->con);
+		} else if (rgb) {
+			mjr_readPixels(offscreen->rgb.get(), nullptr, viewport, &offscreen->con);
+		} else if (depth) {
+			mjr_readPixels(nullptr, offscreen->depth.get(), viewport, &offscreen->con);
+		}
 	}
 	glfwSwapBuffers(offscreen->window.get());
 
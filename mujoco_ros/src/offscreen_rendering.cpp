@@ -145,6 +145,8 @@ void MujocoEnv::initializeRenderResources()
 void MujocoEnv::offscreenRenderLoop()
 {
 	is_rendering_running_ = 1;
+	tracing::setThreadName("offscreen_render");
+	thread_config_.applyToCurrentThread(ThreadConfig::kRender);
 	Glfw().glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_FALSE);
 	Glfw().glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 	offscreen_.window.reset(Glfw().glfwCreateWindow(800, 600, "Invisible window", nullptr, nullptr),
@@ -197,6 +199,7 @@ void MujocoEnv::offscreenRenderLoop()
 				settings_.visual_init_request = false;
 			}
 
+			MUJOCO_ROS_TRACE_SCOPE("render_pass", "render");
 			for (const auto &cam_ptr : offscreen_.cams) {
 				cam_ptr->renderAndPublish(&offscreen_);
 				// ROS_DEBUG_STREAM("Done rendering for t=" << cam_ptr->scn_state_.data.time);
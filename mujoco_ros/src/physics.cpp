@@ -46,42 +46,79 @@ namespace mju = ::mujoco::sample_util;
 void MujocoEnv::physicsLoop()
 {
 	ROS_DEBUG("Physics loop started");
+	tracing::setThreadName("physics");
+	thread_config_.applyToCurrentThread(ThreadConfig::kPhysics);
 	is_physics_running_ = 1;
-	// CPU-sim syncronization point
-	std::chrono::time_point<Clock> syncCPU;
-	mjtNum syncSim = 0;
 
 	// run until asked to exit
-	while (ros::ok() && !settings_.exit_request.load() && num_steps_until_exit_ != 0) {
-		// Sleep for 1 ms or yield, to let the main thread run
+	while (!isPhysicsDone()) {
+		// Wait for the deadline of the next paced step. Otherwise sleep for 1 ms or yield, to let the main thread run
 		// yield results in busy wait - which has better timing but kills battery life
-		if (settings_.run.load() && settings_.busywait) {
+		// In lockstep, wait for an action first. Once one is pending, it is stepped at the next paced deadline
+		const bool lockstep = shm_server_.isLockstep();
+		if (settings_.run.load() && lockstep && !shm_server_.hasAction()) {
+			shm_server_.waitForAction(Seconds(maxPacingWait));
+		} else if (settings_.run.load() && pacer_.hasNextDeadline()) {
+			pacer_.waitForNextDeadline(Seconds(maxPacingWait), settings_.busywait);
+		} else if (settings_.run.load() && (settings_.busywait || lockstep)) {
 			std::this_thread::yield();
 		} else {
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
-		// Run only if model is present
-		if (!model_)
-			continue;
-
-		// Try acquiring the sim mutex
-		if (!physics_thread_mutex_.try_lock()) {
-			// If mutex is locked, try again later
-			continue;
-		}
+		tickPhysics();
+	}
+	is_physics_running_ = 0;
+	finishPhysics();
+}
 
-		// if simulation is paused
-		if (!settings_.run.load()) {
-			simPausedPhysics(syncSim);
-		} else {
-			simUnpausedPhysics(syncSim, syncCPU);
+bool MujocoEnv::isPhysicsDone() const
+{
+	return !ros::ok() || settings_.exit_request.load() || num_steps_until_exit_ == 0;
+}
+
+Clock::time_point MujocoEnv::tickPhysics(int max_steps /* = 0*/)
+{
+	// Run only if model is present
+	if (!model_)
+		return Clock::now() + std::chrono::milliseconds(1);
+
+	// Try acquiring the sim mutex
+	if (!physics_thread_mutex_.try_lock()) {
+		// If mutex is locked, try again later
+		if (lock_wait_start_.time_since_epoch().count() == 0) {
+			lock_wait_start_ = Clock::now();
 		}
-		// unlock physics mutex
-		physics_thread_mutex_.unlock();
+		return Clock::now();
 	}
-	is_physics_running_ = 0;
+	if (lock_wait_start_.time_since_epoch().count() != 0) {
+		step_profiler_.addLockWait(Seconds(Clock::now() - lock_wait_start_).count());
+		if (tracing::isEnabled()) {
+			tracing::record(
+			    "physics_mutex_wait", "lock",
+			    std::chrono::duration_cast<std::chrono::nanoseconds>(lock_wait_start_.time_since_epoch()).count(),
+			    tracing::now());
+		}
+		lock_wait_start_ = {};
+	}
+
+	Clock::time_point next_tick;
+	// if simulation is paused
+	if (!settings_.run.load()) {
+		pacer_.invalidate();
+		simPausedPhysics(paused_sync_sim_);
+		next_tick = Clock::now() + std::chrono::milliseconds(1);
+	} else {
+		simUnpausedPhysics(max_steps);
+		next_tick = pacer_.hasNextDeadline() ? pacer_.nextDeadline() : Clock::now();
+	}
+	// unlock physics mutex
+	physics_thread_mutex_.unlock();
+	return next_tick;
+}
+
+void MujocoEnv::finishPhysics()
+{
 	ROS_INFO_COND(num_steps_until_exit_ == 0, "Reached requested number of steps. Exiting simulation");
-	// settings_.exit_request.store(1);
 	if (offscreen_.render_thread_handle.joinable()) {
 		offscreen_.request_pending.store(true);
 		offscreen_.cond_render_request.notify_one();
@@ -91,6 +128,77 @@ void MujocoEnv::physicsLoop()
 	ROS_DEBUG("Exiting physics loop");
 }
 
+void MujocoEnv::physicsStep()
+{
+	MUJOCO_ROS_TRACE_SCOPE("physics_step", "physics");
+	auto t = step_profiler_.beginStep(data_.get());
+	shm_server_.applyAction(data_.get());
+	{
+		MUJOCO_ROS_TRACE_SCOPE("mj_step", "physics");
+		mj_step(model_.get(), data_.get());
+	}
+	t = step_profiler_.lap(StepProfiler::kMjStep, t);
+	publishSimTime(data_->time);
+	shm_server_.publish(data_.get());
+	t = step_profiler_.lap(StepProfiler::kPublishSimTime, t);
+	runLastStageCbs();
+	t = step_profiler_.lap(StepProfiler::kLastStageCbs, t);
+
+	if (checkpoint_file_.isOpen()) {
+		if (data_->time < last_checkpoint_time_) { // time was reset
+			last_checkpoint_time_ = data_->time;
+		} else if (data_->time - last_checkpoint_time_ >= checkpoint_period_) {
+			writeCheckpoint();
+		}
+	}
+	t = step_profiler_.lap(StepProfiler::kCheckpoint, t);
+
+	if (settings_.render_offscreen) {
+		{
+			MUJOCO_ROS_TRACE_SCOPE("offscreen_wait", "lock");
+			// Wait until no render request is pending
+			while (offscreen_.request_pending.load()) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(3));
+			}
+		}
+		t = step_profiler_.lap(StepProfiler::kOffscreenWait, t);
+		MUJOCO_ROS_TRACE_SCOPE("offscreen_scene_update", "render");
+		std::unique_lock<std::mutex> lock(offscreen_.render_mutex);
+
+		for (const auto &cam_ptr : offscreen_.cams) {
+			if (cam_ptr->shouldRender(ros::Time(data_->time))) {
+				mjv_updateSceneState(model_.get(), data_.get(), &cam_ptr->vopt_, &cam_ptr->scn_state_);
+				runRenderCbs(&cam_ptr->scn_state_.scratch);
+				offscreen_.request_pending.store(true);
+			}
+		}
+		step_profiler_.lap(StepProfiler::kOffscreenUpdate, t);
+	}
+	offscreen_.cond_render_request.notify_one();
+
+	step_profiler_.endStep(data_.get());
+	if (step_profiler_.windowElapsed()) {
+		step_profiler_.flush(step_profile_msg_);
+		step_profile_msg_.header.stamp = ros::Time::now();
+		step_profile_pub_.publish(step_profile_msg_);
+	}
+}
+
+void MujocoEnv::writeCheckpoint()
+{
+	MUJOCO_ROS_TRACE_SCOPE("write_checkpoint", "physics");
+	const auto start = Clock::now();
+	mj_getState(model_.get(), data_.get(), checkpoint_file_.nextSlotData(), kResetStateSig);
+	checkpoint_file_.commit(data_->time);
+	last_checkpoint_time_ = data_->time;
+
+	// Checkpointing should not take longer than a physics step at 1 kHz
+	const double elapsed = Seconds(Clock::now() - start).count();
+	if (elapsed > 1e-3) {
+		ROS_WARN_STREAM_THROTTLE_NAMED(10, "mujoco", "Writing a checkpoint took " << elapsed * 1000 << " ms");
+	}
+}
+
 void MujocoEnv::simPausedPhysics(mjtNum &syncSim)
 {
 	if (settings_.env_steps_request.load() > 0) { // Action call or arrow keys used for stepping
@@ -101,25 +209,7 @@ void MujocoEnv::simPausedPhysics(mjtNum &syncSim)
 		       (connected_viewers_.empty() ||
 		        Clock::now() - startCPU < Seconds(mujoco_ros::Viewer::render_ui_rate_lower_bound_))) {
 			// Run single step
-			mj_step(model_.get(), data_.get());
-			publishSimTime(data_->time);
-			runLastStageCbs();
-			if (settings_.render_offscreen) {
-				// Wait until no render request is pending
-				while (offscreen_.request_pending.load()) {
-					std::this_thread::sleep_for(std::chrono::milliseconds(3));
-				}
-				std::unique_lock<std::mutex> lock(offscreen_.render_mutex);
-
-				for (const auto &cam_ptr : offscreen_.cams) {
-					if (cam_ptr->shouldRender(ros::Time(data_->time))) {
-						mjv_updateSceneState(model_.get(), data_.get(), &cam_ptr->vopt_, &cam_ptr->scn_state_);
-						runRenderCbs(&cam_ptr->scn_state_.scratch);
-						offscreen_.request_pending.store(true);
-					}
-				}
-			}
-			offscreen_.cond_render_request.notify_one();
+			physicsStep();
 
 			settings_.env_steps_request.fetch_sub(1); // Decrement requested steps counter
 			// Break if reset
@@ -134,110 +224,63 @@ void MujocoEnv::simPausedPhysics(mjtNum &syncSim)
 	}
 }
 
-void MujocoEnv::simUnpausedPhysics(mjtNum &syncSim, std::chrono::time_point<Clock> &syncCPU)
+void MujocoEnv::simUnpausedPhysics(int max_steps)
 {
 	// record CPU time at start of iteration
 	const auto startCPU = Clock::now();
 
-	// Elapsed CPU and simulation time since last sync
-	const auto elapsedCPU = startCPU - syncCPU;
-	double elapsedSim     = data_->time - syncSim;
-
-	// Requested slow-down factor
-	double slowdown = 100 / percentRealTime[settings_.real_time_index];
-
-	// Misalignment condition: distance from target sim time is bigger than syncsimalign
-	bool misaligned = std::abs(Seconds(elapsedCPU).count() / slowdown - elapsedSim) > syncMisalign;
-
-	// Out-of-sync (for any reason): reset sync times, step
-	if (elapsedSim < 0 || elapsedCPU.count() < 0 || syncCPU.time_since_epoch().count() == 0 || misaligned ||
-	    settings_.speed_changed) {
-		// re-sync
-		syncCPU                 = startCPU;
-		syncSim                 = data_->time;
+	// (Re-)anchor pacing after pausing, resets and speed changes
+	const double factor = settings_.rt_factor.load();
+	if (settings_.speed_changed || factor != pacer_.factor()) {
+		pacer_.setFactor(factor);
+		pacer_.resetStats();
+		pacer_.sync(startCPU, data_->time);
 		settings_.speed_changed = false;
+	} else if (!pacer_.isSynced() || data_->time < pacer_.syncSim()) {
+		pacer_.sync(startCPU, data_->time);
+	} else if (pacer_.isBound() && std::abs(pacer_.lag(startCPU, data_->time)) * factor > syncMisalign) {
+		// Too far off to catch up without a burst of steps (or the time jumped ahead)
+		pacer_.resync(startCPU, data_->time);
+	}
 
-		// run single step, let next iteration deal with timing
-		mj_step(model_.get(), data_.get());
-		publishSimTime(data_->time);
-		runLastStageCbs();
-		if (settings_.render_offscreen) {
-			// Wait until no render request is pending
-			while (offscreen_.request_pending.load()) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(3));
-			}
-			std::unique_lock<std::mutex> lock(offscreen_.render_mutex);
-
-			for (const auto &cam_ptr : offscreen_.cams) {
-				if (cam_ptr->shouldRender(ros::Time(data_->time))) {
-					mjv_updateSceneState(model_.get(), data_.get(), &cam_ptr->vopt_, &cam_ptr->scn_state_);
-					runRenderCbs(&cam_ptr->scn_state_.scratch);
-					offscreen_.request_pending.store(true);
-				}
+	const mjtNum prevSim = data_->time;
+	int steps            = 0;
+
+	// If real-time is bound, step until the simulation has caught up with its deadline, otherwise run as fast as
+	// possible
+	while ((Clock::now() - startCPU < Seconds(mujoco_ros::Viewer::render_ui_rate_lower_bound_) ||
+	        connected_viewers_.empty()) && // only break if rendering UI is actually necessary
+	       !settings_.exit_request.load() && num_steps_until_exit_ != 0 && (max_steps <= 0 || steps < max_steps)) {
+		// In lockstep every step waits for an action of the shared memory client
+		if (shm_server_.isLockstep() && !shm_server_.hasAction()) {
+			break;
+		}
+		if (pacer_.isBound()) {
+			const auto now      = Clock::now();
+			const auto deadline = pacer_.deadline(data_->time);
+			if (deadline > now) {
+				break;
 			}
+			pacer_.recordLateness(Seconds(now - deadline).count());
 		}
-		offscreen_.cond_render_request.notify_one();
+
+		// Call mj_step
+		physicsStep();
+		++steps;
 
 		if (num_steps_until_exit_ > 0) {
 			num_steps_until_exit_--;
 		}
-	}
-
-	// In-sync: step until ahead of CPU
-	else {
-		bool measured  = false;
-		mjtNum prevSim = data_->time;
-
-		// If real-time is bound, run until sim steps are in sync with CPU steps, otherwise run as fast as
-		// possible
-		while ((settings_.real_time_index == 0 || Seconds((data_->time - syncSim) * slowdown) < Clock::now() - syncCPU) &&
-		       (Clock::now() - startCPU < Seconds(mujoco_ros::Viewer::render_ui_rate_lower_bound_) ||
-		        connected_viewers_.empty()) && // only break if rendering UI is actually necessary
-		       !settings_.exit_request.load() &&
-		       num_steps_until_exit_ != 0) {
-			// measure slowdown before first step
-			if (!measured && elapsedSim) {
-				if (settings_.real_time_index != 0) {
-					sim_state_.measured_slowdown = std::chrono::duration<double>(elapsedCPU).count() / elapsedSim;
-					measured                     = true;
-				} else if (syncCPU.time_since_epoch().count() % 3 == 0) { // measure slowdown every 3rd step for
-					                                                       // an updated estimate
-					sim_state_.measured_slowdown = std::chrono::duration<double>(Clock::now() - syncCPU).count() /
-					                               Seconds(data_->time - syncSim).count();
-				}
-			}
 
-			// Call mj_step
-			mj_step(model_.get(), data_.get());
-			publishSimTime(data_->time);
-			runLastStageCbs();
-			if (settings_.render_offscreen) {
-				// Wait until no render request is pending
-				while (offscreen_.request_pending.load()) {
-					std::this_thread::sleep_for(std::chrono::milliseconds(5));
-				}
-				std::unique_lock<std::mutex> lock(offscreen_.render_mutex);
-
-				for (const auto &cam_ptr : offscreen_.cams) {
-					if (cam_ptr->shouldRender(ros::Time(data_->time))) {
-						mjv_updateSceneState(model_.get(), data_.get(), &cam_ptr->vopt_, &cam_ptr->scn_state_);
-						runRenderCbs(&cam_ptr->scn_state_.scratch);
-						offscreen_.request_pending.store(true);
-					}
-				}
-			}
-			offscreen_.cond_render_request.notify_one();
-
-			if (num_steps_until_exit_ > 0) {
-				num_steps_until_exit_--;
-			}
-
-			// Break if reset
-			if (data_->time < prevSim) {
-				break;
-			}
+		// Break if reset
+		if (data_->time < prevSim) {
+			break;
 		}
 	}
+
+	sim_state_.measured_slowdown = static_cast<float>(
+	    pacer_.measuredSlowdown(Clock::now(), data_->time, static_cast<double>(sim_state_.measured_slowdown)));
+	pacer_.setNextDeadline(data_->time);
 }
 
 void MujocoEnv::waitForPhysicsJoin()
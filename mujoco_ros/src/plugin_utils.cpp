@@ -36,8 +36,18 @@
 
 #include <mujoco_ros/plugin_utils.h>
 
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
 namespace mujoco_ros::plugin_utils {
 
+namespace {
+// The loader is shared by all environments of the process, it must outlive the plugins of every environment
+std::mutex plugin_loader_mutex;
+unsigned int plugin_loader_users = 0;
+} // namespace
+
 bool parsePlugins(const ros::NodeHandle *nh, XmlRpc::XmlRpcValue &plugin_config_rpc)
 {
 	std::string param_path;
@@ -96,7 +106,11 @@ bool registerPlugin(const std::string &nh_namespace, const XmlRpc::XmlRpcValue &
 	ROS_DEBUG_STREAM_NAMED("mujoco_ros_plugin_loader", "Registering plugin of type " << type);
 
 	try {
-		MujocoPlugin *mjplugin_ptr = plugin_loader_ptr_->createUnmanagedInstance(type);
+		MujocoPlugin *mjplugin_ptr;
+		{
+			std::lock_guard<std::mutex> lock(plugin_loader_mutex);
+			mjplugin_ptr = plugin_loader_ptr_->createUnmanagedInstance(type);
+		}
 		mjplugin_ptr->init(config, nh_namespace, env);
 		plugins.emplace_back(std::unique_ptr<MujocoPlugin>(mjplugin_ptr));
 		ROS_DEBUG_STREAM_NAMED("mujoco_ros_plugin_loader",
@@ -111,8 +125,71 @@ bool registerPlugin(const std::string &nh_namespace, const XmlRpc::XmlRpcValue &
 	return true;
 }
 
+std::vector<std::vector<std::size_t>> computeLoadDependencies(const std::vector<MujocoPluginPtr> &plugins)
+{
+	std::unordered_map<std::string, std::vector<std::size_t>> by_name;
+	for (std::size_t i = 0; i < plugins.size(); ++i) {
+		by_name[plugins[i]->name_].emplace_back(i);
+	}
+
+	// resolved direct dependencies of each plugin, unknown names and self references are dropped
+	std::vector<std::vector<std::size_t>> deps(plugins.size());
+	for (std::size_t i = 0; i < plugins.size(); ++i) {
+		for (const auto &dep : plugins[i]->depends_on_) {
+			const auto it = by_name.find(dep);
+			if (it == by_name.end()) {
+				ROS_WARN_STREAM_NAMED("mujoco_ros_plugin_loader", "Plugin '" << plugins[i]->name_
+				                                                             << "' depends on unknown plugin '" << dep
+				                                                             << "'. Ignoring the dependency");
+				continue;
+			}
+			for (const std::size_t j : it->second) {
+				if (j != i && std::find(deps[i].begin(), deps[i].end(), j) == deps[i].end()) {
+					deps[i].emplace_back(j);
+				}
+			}
+		}
+	}
+
+	// Mark every plugin whose dependencies can be resolved without running into a cycle
+	std::vector<bool> acyclic(plugins.size(), false);
+	bool progress = true;
+	while (progress) {
+		progress = false;
+		for (std::size_t i = 0; i < plugins.size(); ++i) {
+			if (!acyclic[i] && std::all_of(deps[i].begin(), deps[i].end(), [&](std::size_t j) { return acyclic[j]; })) {
+				acyclic[i] = true;
+				progress   = true;
+			}
+		}
+	}
+
+	// Plugins with cyclic dependencies wait for all other plugins and are loaded one at a time in configured order
+	std::vector<std::size_t> finished_first;
+	for (std::size_t i = 0; i < plugins.size(); ++i) {
+		if (acyclic[i]) {
+			finished_first.emplace_back(i);
+		}
+	}
+	for (std::size_t i = 0; i < plugins.size(); ++i) {
+		if (acyclic[i]) {
+			continue;
+		}
+		ROS_WARN_STREAM_NAMED("mujoco_ros_plugin_loader", "Plugin '" << plugins[i]->name_
+		                                                             << "' has cyclic dependencies. Loading it after "
+		                                                                "all other plugins");
+		deps[i] = finished_first;
+		finished_first.emplace_back(i);
+	}
+	return deps;
+}
+
 void initPluginLoader()
 {
+	std::lock_guard<std::mutex> lock(plugin_loader_mutex);
+	if (plugin_loader_users++ > 0) {
+		return;
+	}
 	// NOLINTBEGIN(clang-analyzer-optin.cplusplus.VirtualCall)
 	plugin_loader_ptr_ =
 	    std::make_unique<pluginlib::ClassLoader<mujoco_ros::MujocoPlugin>>("mujoco_ros", "mujoco_ros::MujocoPlugin");
@@ -121,6 +198,10 @@ void initPluginLoader()
 
 void unloadPluginloader()
 {
+	std::lock_guard<std::mutex> lock(plugin_loader_mutex);
+	if (plugin_loader_users == 0 || --plugin_loader_users > 0) {
+		return;
+	}
 	plugin_loader_ptr_.reset();
 }
 
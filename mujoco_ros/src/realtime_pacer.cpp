@@ -0,0 +1,129 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/realtime_pacer.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace mujoco_ros {
+
+namespace {
+
+void sleepUntil(Clock::time_point wake)
+{
+#if defined(__linux__)
+	// std::chrono::steady_clock is based on CLOCK_MONOTONIC
+	const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count();
+	timespec ts;
+	ts.tv_sec  = static_cast<time_t>(ns / 1000000000);
+	ts.tv_nsec = static_cast<long>(ns % 1000000000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+	}
+#else
+	std::this_thread::sleep_until(wake);
+#endif
+}
+
+} // namespace
+
+void RealTimePacer::sync(Clock::time_point now, double sim_time)
+{
+	synced_            = true;
+	sync_wall_         = now;
+	sync_sim_          = sim_time;
+	has_next_deadline_ = false;
+}
+
+void RealTimePacer::resync(Clock::time_point now, double sim_time)
+{
+	resyncs_.fetch_add(1);
+	sync(now, sim_time);
+}
+
+void RealTimePacer::invalidate()
+{
+	synced_            = false;
+	has_next_deadline_ = false;
+}
+
+double RealTimePacer::measuredSlowdown(Clock::time_point now, double sim_time, double fallback) const
+{
+	const double elapsed_sim = sim_time - sync_sim_;
+	if (!synced_ || elapsed_sim <= 0) {
+		return fallback;
+	}
+	return Seconds(now - sync_wall_).count() / elapsed_sim;
+}
+
+void RealTimePacer::setNextDeadline(double sim_time)
+{
+	has_next_deadline_ = synced_ && isBound();
+	if (has_next_deadline_) {
+		next_deadline_ = deadline(sim_time);
+	}
+}
+
+bool RealTimePacer::waitForNextDeadline(Seconds max_wait, bool spin)
+{
+	if (!has_next_deadline_) {
+		return true;
+	}
+	const auto now      = Clock::now();
+	const auto limit    = now + std::chrono::duration_cast<Clock::duration>(max_wait);
+	const auto deadline = std::min(next_deadline_, limit);
+
+	if (!spin && deadline - now > spin_threshold_) {
+		sleepUntil(deadline - spin_threshold_);
+	}
+	while (Clock::now() < deadline) {
+	}
+	return deadline == next_deadline_;
+}
+
+void RealTimePacer::resetStats()
+{
+	jitter_.reset();
+	resyncs_.store(0);
+}
+
+} // namespace mujoco_ros
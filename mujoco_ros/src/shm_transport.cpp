@@ -0,0 +1,489 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/shm_transport.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace mujoco_ros::shm {
+
+static_assert(std::is_same_v<mjtNum, double>, "The transport exchanges mjtNum arrays as double");
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t kCacheLine = 64;
+
+std::size_t roundUp(std::size_t size)
+{
+	return (size + kCacheLine - 1) / kCacheLine * kCacheLine;
+}
+
+// POSIX shared memory names have to start with a slash
+std::string segmentName(const std::string &name)
+{
+	return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+char *slot(Header *header, uint64_t offset, uint64_t slot_size, uint64_t position)
+{
+	return reinterpret_cast<char *>(header) + offset + (position % header->num_slots) * slot_size;
+}
+
+// Futex words in shared memory work across processes as long as the private flag is not set
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected, Seconds timeout)
+{
+#if defined(__linux__)
+	const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+	timespec ts{ static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000) };
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+	(void)word;
+	(void)expected;
+	std::this_thread::sleep_for(std::min(timeout, Seconds(1e-4)));
+#endif
+}
+
+void futexWake(std::atomic<uint32_t> &word)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+	(void)word;
+#endif
+}
+
+/**
+ * @brief Wait on a futex word until ready() returns true or the timeout expires.
+ */
+template <typename Ready>
+bool waitUntil(std::atomic<uint32_t> &word, Seconds timeout, Ready ready)
+{
+	const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout);
+	while (!ready()) {
+		// Load the sequence before checking again, a publish in between makes the wait return immediately
+		const uint32_t seq = word.load(std::memory_order_acquire);
+		if (ready()) {
+			return true;
+		}
+		const auto now = Clock::now();
+		if (now >= deadline) {
+			return false;
+		}
+		futexWait(word, seq, deadline - now);
+	}
+	return true;
+}
+
+/**
+ * @brief Copy the observation at the given ring position.
+ * @return false if the slot does not hold this position (anymore) or was overwritten while copying.
+ */
+bool copyObservation(Header *header, uint64_t position, Observation &obs)
+{
+	const char *entry  = slot(header, header->obs_offset, header->obs_slot_size, position);
+	const auto *info   = reinterpret_cast<const ObservationSlot *>(entry);
+	const uint64_t seq = info->seq.load(std::memory_order_acquire);
+	if (seq != 2 * position + 2) {
+		return false;
+	}
+	obs.step         = info->step;
+	obs.time         = info->time;
+	const auto *data = reinterpret_cast<const double *>(entry + sizeof(ObservationSlot));
+	obs.qpos.assign(data, data + header->nq);
+	data += header->nq;
+	obs.qvel.assign(data, data + header->nv);
+	data += header->nv;
+	obs.sensordata.assign(data, data + header->nsensordata);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return info->seq.load(std::memory_order_relaxed) == seq;
+}
+
+// Marks a call that uses the segment without holding the physics mutex, for the whole scope
+class LockfreeUse
+{
+public:
+	explicit LockfreeUse(std::atomic<unsigned int> &users) : users_(users) { users_.fetch_add(1); }
+	~LockfreeUse() { users_.fetch_sub(1); }
+
+	LockfreeUse(const LockfreeUse &)            = delete;
+	LockfreeUse &operator=(const LockfreeUse &) = delete;
+
+private:
+	std::atomic<unsigned int> &users_;
+};
+
+} // namespace
+
+Server::~Server()
+{
+	close();
+	for (const auto &[header, size] : retired_) {
+		munmap(header, size);
+	}
+}
+
+void Server::releaseRetired()
+{
+	// Calls starting after this check load the current header_, which is not retired
+	if (lockfree_users_.load() != 0) {
+		return;
+	}
+	for (const auto &[header, size] : retired_) {
+		munmap(header, size);
+	}
+	retired_.clear();
+}
+
+void Server::configure(const std::string &name, unsigned int num_slots, bool lockstep)
+{
+	name_      = segmentName(name);
+	num_slots_ = std::max(num_slots, 1u);
+	lockstep_  = lockstep;
+}
+
+bool Server::open(const mjModel *m, const mjData *d, std::string &error)
+{
+	close();
+	if (!isEnabled()) {
+		return true;
+	}
+
+	const auto dim             = [](int n) { return static_cast<std::size_t>(std::max(n, 0)); };
+	const std::size_t obs_size = dim(m->nq) + dim(m->nv) + dim(m->nsensordata);
+
+	const std::size_t header_size      = roundUp(sizeof(Header));
+	const std::size_t obs_slot_size    = roundUp(sizeof(ObservationSlot) + obs_size * sizeof(double));
+	const std::size_t action_slot_size = roundUp(sizeof(ActionSlot) + dim(m->nu) * sizeof(double));
+	const std::size_t total_size       = header_size + num_slots_ * (obs_slot_size + action_slot_size);
+
+	// Remove a stale segment of a previous run
+	shm_unlink(name_.c_str());
+	const int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		error = "shm_open(" + name_ + ") failed: " + std::strerror(errno);
+		return false;
+	}
+	if (ftruncate(fd, static_cast<off_t>(total_size)) != 0) {
+		error = "Resizing " + name_ + " failed: " + std::strerror(errno);
+		::close(fd);
+		shm_unlink(name_.c_str());
+		return false;
+	}
+	void *mem = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mem == MAP_FAILED) {
+		error = "Mapping " + name_ + " failed: " + std::strerror(errno);
+		shm_unlink(name_.c_str());
+		return false;
+	}
+
+	auto *header = new (mem) Header();
+	for (std::size_t i = 0; i < num_slots_; ++i) {
+		new (static_cast<char *>(mem) + header_size + i * obs_slot_size) ObservationSlot();
+	}
+	header->version          = kVersion;
+	header->header_size      = static_cast<uint32_t>(header_size);
+	header->num_slots        = num_slots_;
+	header->nq               = static_cast<uint32_t>(dim(m->nq));
+	header->nv               = static_cast<uint32_t>(dim(m->nv));
+	header->nu               = static_cast<uint32_t>(dim(m->nu));
+	header->nsensordata      = static_cast<uint32_t>(dim(m->nsensordata));
+	header->lockstep         = lockstep_ ? 1 : 0;
+	header->obs_offset       = header_size;
+	header->obs_slot_size    = obs_slot_size;
+	header->action_offset    = header_size + num_slots_ * obs_slot_size;
+	header->action_slot_size = action_slot_size;
+	header->total_size       = total_size;
+	// Clients only use the segment once the magic number is visible
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = kMagic;
+
+	size_          = total_size;
+	num_published_ = 0;
+	header_.store(header, std::memory_order_release);
+
+	publish(d);
+	return true;
+}
+
+void Server::close()
+{
+	Header *header = header_.exchange(nullptr);
+	if (header != nullptr) {
+		header->closed.store(1, std::memory_order_release);
+		// Wake blocked clients and a physics thread waiting for an action, so they notice
+		header->obs_futex.fetch_add(1, std::memory_order_release);
+		futexWake(header->obs_futex);
+		header->action_futex.fetch_add(1, std::memory_order_release);
+		futexWake(header->action_futex);
+
+		shm_unlink(name_.c_str());
+		retired_.emplace_back(header, size_);
+		size_ = 0;
+	}
+	releaseRetired();
+}
+
+bool Server::hasAction() const
+{
+	const LockfreeUse use(lockfree_users_);
+	const Header *header = header_.load();
+	return header != nullptr && header->action_head.load(std::memory_order_acquire) !=
+	                                header->action_tail.load(std::memory_order_relaxed);
+}
+
+bool Server::waitForAction(Seconds max_wait) const
+{
+	const LockfreeUse use(lockfree_users_);
+	Header *header = header_.load();
+	if (header == nullptr) {
+		return false;
+	}
+	return waitUntil(header->action_futex, max_wait, [header]() {
+		return header->closed.load(std::memory_order_acquire) != 0 ||
+		       header->action_head.load(std::memory_order_acquire) !=
+		           header->action_tail.load(std::memory_order_relaxed);
+	}) && hasAction();
+}
+
+bool Server::applyAction(mjData *d)
+{
+	Header *header = header_.load(std::memory_order_acquire);
+	if (header == nullptr) {
+		return false;
+	}
+	uint64_t tail       = header->action_tail.load(std::memory_order_relaxed);
+	const uint64_t head = header->action_head.load(std::memory_order_acquire);
+	if (tail == head) {
+		return false;
+	}
+	if (!lockstep_) {
+		// Only the newest action matters when streaming
+		tail = head - 1;
+	}
+
+	const char *entry = slot(header, header->action_offset, header->action_slot_size, tail);
+	std::memcpy(d->ctrl, entry + sizeof(ActionSlot), header->nu * sizeof(double));
+	header->action_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+void Server::publish(const mjData *d)
+{
+	Header *header = header_.load(std::memory_order_acquire);
+	if (header == nullptr) {
+		return;
+	}
+	const uint64_t step = num_published_++;
+	const uint64_t head = header->obs_head.load(std::memory_order_relaxed);
+	uint64_t tail       = header->obs_tail.load(std::memory_order_acquire);
+	while (head - tail >= header->num_slots) {
+		if (lockstep_) {
+			header->obs_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		// A streaming client wants the newest state, so discard the oldest observation instead. Fails if the client
+		// freed it in the meantime, tail is reloaded then.
+		if (header->obs_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel,
+		                                           std::memory_order_acquire)) {
+			header->obs_dropped.fetch_add(1, std::memory_order_relaxed);
+			++tail;
+		}
+	}
+
+	char *entry = slot(header, header->obs_offset, header->obs_slot_size, head);
+	auto *obs   = reinterpret_cast<ObservationSlot *>(entry);
+	obs->seq.store(2 * head + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	obs->step  = step;
+	obs->time  = d->time;
+	auto *data = reinterpret_cast<double *>(entry + sizeof(ObservationSlot));
+	data       = std::copy_n(d->qpos, header->nq, data);
+	data       = std::copy_n(d->qvel, header->nv, data);
+	std::copy_n(d->sensordata, header->nsensordata, data);
+	obs->seq.store(2 * head + 2, std::memory_order_release);
+
+	header->obs_head.store(head + 1, std::memory_order_release);
+	header->obs_futex.fetch_add(1, std::memory_order_release);
+	futexWake(header->obs_futex);
+}
+
+uint64_t Server::dropped() const
+{
+	const Header *header = header_.load(std::memory_order_acquire);
+	return header != nullptr ? header->obs_dropped.load(std::memory_order_relaxed) : 0;
+}
+
+Client::~Client()
+{
+	detach();
+}
+
+bool Client::attach(const std::string &name, std::string &error)
+{
+	detach();
+	const std::string segment = segmentName(name);
+	const int fd              = shm_open(segment.c_str(), O_RDWR, 0);
+	if (fd < 0) {
+		error = "shm_open(" + segment + ") failed: " + std::strerror(errno);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+		error = segment + " is not initialized yet";
+		::close(fd);
+		return false;
+	}
+	const auto size = static_cast<std::size_t>(st.st_size);
+	void *mem       = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mem == MAP_FAILED) {
+		error = "Mapping " + segment + " failed: " + std::strerror(errno);
+		return false;
+	}
+
+	auto *header         = static_cast<Header *>(mem);
+	const uint32_t magic = header->magic;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (magic != kMagic) {
+		error = segment + " is not initialized yet";
+	} else if (header->version != kVersion) {
+		error = segment + " has version " + std::to_string(header->version) + ", expected " + std::to_string(kVersion);
+	} else if (header->total_size > size) {
+		error = segment + " is truncated";
+	} else {
+		header_   = header;
+		size_     = size;
+		num_sent_ = 0;
+		return true;
+	}
+	munmap(mem, size);
+	return false;
+}
+
+void Client::detach()
+{
+	if (header_ != nullptr) {
+		munmap(header_, size_);
+		header_ = nullptr;
+		size_   = 0;
+	}
+}
+
+bool Client::isClosed() const
+{
+	return header_ == nullptr || header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool Client::sendAction(const double *ctrl)
+{
+	if (isClosed()) {
+		return false;
+	}
+	const uint64_t head = header_->action_head.load(std::memory_order_relaxed);
+	if (head - header_->action_tail.load(std::memory_order_acquire) >= header_->num_slots) {
+		return false;
+	}
+
+	char *entry  = slot(header_, header_->action_offset, header_->action_slot_size, head);
+	auto *action = reinterpret_cast<ActionSlot *>(entry);
+	action->seq  = num_sent_++;
+	std::memcpy(entry + sizeof(ActionSlot), ctrl, header_->nu * sizeof(double));
+
+	header_->action_head.store(head + 1, std::memory_order_release);
+	header_->action_futex.fetch_add(1, std::memory_order_release);
+	futexWake(header_->action_futex);
+	return true;
+}
+
+bool Client::hasObservation() const
+{
+	return header_ != nullptr &&
+	       header_->obs_head.load(std::memory_order_acquire) != header_->obs_tail.load(std::memory_order_relaxed);
+}
+
+bool Client::waitForObservation(Seconds timeout) const
+{
+	if (header_ == nullptr) {
+		return false;
+	}
+	return waitUntil(header_->obs_futex, timeout, [this]() { return hasObservation() || isClosed(); }) &&
+	       hasObservation();
+}
+
+bool Client::readObservation(Observation &obs, bool latest /* = false*/)
+{
+	if (header_ == nullptr) {
+		return false;
+	}
+	while (true) {
+		uint64_t tail       = header_->obs_tail.load(std::memory_order_acquire);
+		const uint64_t head = header_->obs_head.load(std::memory_order_acquire);
+		if (tail == head) {
+			return false;
+		}
+		const uint64_t position = latest ? head - 1 : tail;
+		if (!copyObservation(header_, position, obs)) {
+			// Overwritten by the simulation, continue with the now oldest one
+			continue;
+		}
+		// Free the entry, unless the simulation already discarded it while streaming
+		while (tail <= position && !header_->obs_tail.compare_exchange_weak(tail, position + 1, std::memory_order_acq_rel,
+		                                                                     std::memory_order_acquire)) {
+		}
+		return true;
+	}
+}
+
+} // namespace mujoco_ros::shm
@@ -0,0 +1,177 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/step_profiler.h>
+
+#include <algorithm>
+
+namespace mujoco_ros {
+
+namespace {
+
+// millisecond timer for the MuJoCo built-in profiler, same unit as the viewer uses
+mjtNum profilerTimer()
+{
+	static const auto start = Clock::now();
+	return std::chrono::duration<mjtNum, std::milli>(Clock::now() - start).count();
+}
+
+// mjData::timer entries reported as mj_step sub-phases
+constexpr std::array<std::pair<StepProfiler::Phase, mjtTimer>, 6> kTimerPhases = {
+	{ { StepProfiler::kPosition, mjTIMER_POSITION },
+	  { StepProfiler::kCollision, mjTIMER_POS_COLLISION },
+	  { StepProfiler::kVelocity, mjTIMER_VELOCITY },
+	  { StepProfiler::kActuation, mjTIMER_ACTUATION },
+	  { StepProfiler::kConstraint, mjTIMER_CONSTRAINT },
+	  { StepProfiler::kAdvance, mjTIMER_ADVANCE } }
+};
+
+} // namespace
+
+const char *StepProfiler::phaseName(Phase phase)
+{
+	switch (phase) {
+		case kStep:
+			return "step";
+		case kMjStep:
+			return "mj_step";
+		case kPosition:
+			return "mj_step/position";
+		case kCollision:
+			return "mj_step/position/collision";
+		case kVelocity:
+			return "mj_step/velocity";
+		case kActuation:
+			return "mj_step/actuation";
+		case kConstraint:
+			return "mj_step/constraint";
+		case kAdvance:
+			return "mj_step/advance";
+		case kPublishSimTime:
+			return "publish_sim_time";
+		case kLastStageCbs:
+			return "last_stage_cbs";
+		case kCheckpoint:
+			return "checkpoint";
+		case kOffscreenWait:
+			return "offscreen_wait";
+		case kOffscreenUpdate:
+			return "offscreen_scene_update";
+		default:
+			return "unknown";
+	}
+}
+
+void StepProfiler::configure(double period)
+{
+	period_ = period;
+	if (!isEnabled()) {
+		return;
+	}
+	if (mjcb_time == nullptr) {
+		mjcb_time = profilerTimer;
+	}
+	window_start_ = Clock::now();
+	steps_        = 0;
+	lock_wait_    = 0;
+	sum_.fill(0);
+	max_.fill(0);
+}
+
+Clock::time_point StepProfiler::beginStep(const mjData *d)
+{
+	if (!isEnabled()) {
+		return {};
+	}
+	current_.fill(0);
+	for (const auto &entry : kTimerPhases) {
+		timer_start_[entry.second] = d->timer[entry.second].duration;
+	}
+	step_start_ = Clock::now();
+	return step_start_;
+}
+
+void StepProfiler::endStep(const mjData *d)
+{
+	if (!isEnabled()) {
+		return;
+	}
+	current_[kStep] = Seconds(Clock::now() - step_start_).count();
+	for (const auto &entry : kTimerPhases) {
+		// timers are cleared on reset, in that case everything measured belongs to this step
+		mjtNum delta = d->timer[entry.second].duration - timer_start_[entry.second];
+		if (delta < 0) {
+			delta = d->timer[entry.second].duration;
+		}
+		current_[entry.first] = delta * 1e-3;
+	}
+
+	for (int i = 0; i < kNumPhases; ++i) {
+		sum_[i] += current_[i];
+		max_[i] = std::max(max_[i], current_[i]);
+	}
+	steps_++;
+}
+
+bool StepProfiler::windowElapsed() const
+{
+	return isEnabled() && steps_ > 0 && Seconds(Clock::now() - window_start_).count() >= period_;
+}
+
+void StepProfiler::flush(mujoco_ros_msgs::StepProfile &msg)
+{
+	const auto now      = Clock::now();
+	msg.window_duration = Seconds(now - window_start_).count();
+	msg.steps           = steps_;
+	msg.lock_wait       = lock_wait_;
+	msg.phases.resize(kNumPhases);
+	msg.mean.resize(kNumPhases);
+	msg.max.resize(kNumPhases);
+	for (int i = 0; i < kNumPhases; ++i) {
+		msg.phases[i] = phaseName(static_cast<Phase>(i));
+		msg.mean[i]   = steps_ > 0 ? sum_[i] / steps_ : 0.0;
+		msg.max[i]    = max_[i];
+	}
+
+	window_start_ = now;
+	steps_        = 0;
+	lock_wait_    = 0;
+	sum_.fill(0);
+	max_.fill(0);
+}
+
+} // namespace mujoco_ros
@@ -0,0 +1,102 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/sync_env.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace mujoco_ros {
+
+SyncEnv::~SyncEnv()
+{
+	shutdown();
+}
+
+bool SyncEnv::load(const std::string &model, double timeout)
+{
+	startEventLoop();
+	if (!queueModel(model)) {
+		return false;
+	}
+
+	const auto start = Clock::now();
+	while (getOperationalStatus() != 0 && Seconds(Clock::now() - start).count() < timeout) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return getOperationalStatus() == 0 && sim_state_.model_valid;
+}
+
+double SyncEnv::step(int num_steps, std::vector<double> *latencies)
+{
+	if (latencies != nullptr) {
+		latencies->clear();
+		latencies->reserve(static_cast<size_t>(std::max(num_steps, 0)));
+	}
+	const double start_time = data_->time;
+	for (int i = 0; i < num_steps; ++i) {
+		const auto start = Clock::now();
+		{
+			std::lock_guard<MujocoEnvMutex> lk(physics_thread_mutex_);
+			physicsStep();
+		}
+		if (latencies != nullptr) {
+			latencies->emplace_back(Seconds(Clock::now() - start).count());
+		}
+	}
+	return data_->time - start_time;
+}
+
+std::vector<std::string> SyncEnv::cameraNames() const
+{
+	std::vector<std::string> names;
+	for (int i = 0; i < model_->ncam; ++i) {
+		names.emplace_back(mj_id2name(model_.get(), mjOBJ_CAMERA, i));
+	}
+	return names;
+}
+
+void SyncEnv::shutdown()
+{
+	settings_.exit_request = 1;
+	waitForEventsJoin();
+	// usually done by the physics thread, which is not running here
+	finishPhysics();
+}
+
+} // namespace mujoco_ros
@@ -0,0 +1,356 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/thread_config.h>
+
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace mujoco_ros {
+
+namespace {
+
+constexpr std::array<const char *, ThreadConfig::kNumThreadClasses> kClassNames = { "physics", "event", "render",
+	                                                                                  "threadpool" };
+
+std::string describeSettings(const ThreadConfig::Settings &settings)
+{
+	std::ostringstream out;
+	if (settings.cpus.empty()) {
+		out << "any cpu";
+	} else {
+		out << "cpus [";
+		for (size_t i = 0; i < settings.cpus.size(); ++i) {
+			out << (i > 0 ? ", " : "") << settings.cpus[i];
+		}
+		out << "]";
+	}
+	if (settings.priority > 0) {
+		out << ", SCHED_FIFO priority " << settings.priority;
+	} else {
+		out << ", default scheduling";
+	}
+	return out.str();
+}
+
+// Applies the settings to the calling thread. Returns an error description on failure.
+bool applySettings(const ThreadConfig::Settings &settings, std::string &error)
+{
+#if defined(__linux__)
+	bool success = true;
+	if (!settings.cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu : settings.cpus) {
+			CPU_SET(cpu, &set);
+		}
+		const int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (rc != 0) {
+			error += std::string("setting cpu affinity failed: ") + std::strerror(rc) + ". ";
+			success = false;
+		}
+	}
+	if (settings.priority > 0) {
+		sched_param param;
+		param.sched_priority = settings.priority;
+		const int rc         = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (rc != 0) {
+			error += std::string("setting SCHED_FIFO priority failed: ") + std::strerror(rc) + ".";
+			if (rc == EPERM) {
+				error += " Requires CAP_SYS_NICE or a sufficient rtprio limit (see /etc/security/limits.conf).";
+			}
+			success = false;
+		}
+	}
+	return success;
+#else
+	error = "thread configuration is only supported on Linux.";
+	return settings.cpus.empty() && settings.priority <= 0;
+#endif
+}
+
+bool parseCpus(const XmlRpc::XmlRpcValue &value, std::vector<int> &cpus)
+{
+	if (value.getType() == XmlRpc::XmlRpcValue::TypeInt) {
+		cpus.emplace_back(static_cast<int>(const_cast<XmlRpc::XmlRpcValue &>(value)));
+		return true;
+	}
+	if (value.getType() != XmlRpc::XmlRpcValue::TypeArray) {
+		return false;
+	}
+	auto &list = const_cast<XmlRpc::XmlRpcValue &>(value);
+	for (int i = 0; i < list.size(); ++i) {
+		if (list[i].getType() != XmlRpc::XmlRpcValue::TypeInt) {
+			return false;
+		}
+		cpus.emplace_back(static_cast<int>(list[i]));
+	}
+	return true;
+}
+
+struct PoolTaskArgs
+{
+	const ThreadConfig::Settings *settings;
+	int num_workers;
+	std::atomic_int started = { 0 };
+	std::atomic_int failed  = { 0 };
+	std::mutex error_mutex;
+	std::string error;
+};
+
+void *applyToWorker(void *args)
+{
+	auto *pool_args = static_cast<PoolTaskArgs *>(args);
+	std::string error;
+	if (!applySettings(*pool_args->settings, error)) {
+		pool_args->failed.fetch_add(1);
+		std::lock_guard<std::mutex> lock(pool_args->error_mutex);
+		pool_args->error = error;
+	}
+
+	// Block this worker until every worker picked up a task, so no worker runs two of them
+	pool_args->started.fetch_add(1);
+	const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (pool_args->started.load() < pool_args->num_workers && std::chrono::steady_clock::now() < timeout) {
+		std::this_thread::yield();
+	}
+	return nullptr;
+}
+
+} // namespace
+
+const char *ThreadConfig::className(ThreadClass cls)
+{
+	return kClassNames[cls];
+}
+
+bool ThreadConfig::load(const ros::NodeHandle &nh)
+{
+	bool valid = true;
+	nh.param<bool>("threads/lock_memory", lock_memory_, false);
+
+#if defined(__linux__)
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		CPU_ZERO(&allowed);
+	}
+	const int min_priority = sched_get_priority_min(SCHED_FIFO);
+	const int max_priority = sched_get_priority_max(SCHED_FIFO);
+	rlimit rtprio_limit;
+	const bool is_root = geteuid() == 0;
+	if (getrlimit(RLIMIT_RTPRIO, &rtprio_limit) != 0) {
+		rtprio_limit.rlim_cur = RLIM_INFINITY;
+	}
+#else
+	const int min_priority = 1;
+	const int max_priority = 99;
+#endif
+
+	for (int i = 0; i < kNumThreadClasses; ++i) {
+		const auto cls   = static_cast<ThreadClass>(i);
+		auto &settings   = settings_[i];
+		const auto param = std::string("threads/") + className(cls);
+		settings         = Settings();
+
+		XmlRpc::XmlRpcValue cpus;
+		if (nh.getParam(param + "/cpus", cpus) && !parseCpus(cpus, settings.cpus)) {
+			ROS_WARN_STREAM(param << "/cpus should be an integer or a list of integers. Ignoring it");
+			settings.cpus.clear();
+			valid = false;
+		}
+		for (auto it = settings.cpus.begin(); it != settings.cpus.end();) {
+#if defined(__linux__)
+			const bool cpu_valid = *it >= 0 && *it < CPU_SETSIZE && CPU_ISSET(*it, &allowed);
+#else
+			const bool cpu_valid = *it >= 0 && *it < static_cast<int>(std::thread::hardware_concurrency());
+#endif
+			if (!cpu_valid) {
+				ROS_WARN_STREAM(param << "/cpus: cpu " << *it << " does not exist or is not available to the process");
+				it    = settings.cpus.erase(it);
+				valid = false;
+			} else {
+				++it;
+			}
+		}
+
+		nh.param<int>(param + "/priority", settings.priority, 0);
+		if (settings.priority != 0 && (settings.priority < min_priority || settings.priority > max_priority)) {
+			ROS_WARN_STREAM(param << "/priority must be in [" << min_priority << ", " << max_priority << "] (got "
+			                      << settings.priority << "). Keeping the default scheduling policy");
+			settings.priority = 0;
+			valid             = false;
+		}
+#if defined(__linux__)
+		if (settings.priority > 0 && !is_root && rtprio_limit.rlim_cur != RLIM_INFINITY &&
+		    static_cast<rlim_t>(settings.priority) > rtprio_limit.rlim_cur) {
+			ROS_WARN_STREAM(param << "/priority " << settings.priority << " exceeds the rtprio limit of "
+			                      << rtprio_limit.rlim_cur << ", setting it will likely fail");
+		}
+#endif
+	}
+
+	const auto &physics = settings_[kPhysics];
+	for (int i = kEvent; i < kNumThreadClasses; ++i) {
+		const auto &other = settings_[i];
+		if (other.priority > physics.priority) {
+			ROS_WARN_STREAM("The " << kClassNames[i] << " threads have a higher priority (" << other.priority
+			                       << ") than the physics thread (" << physics.priority
+			                       << ") and may preempt stepping");
+		}
+		for (int cpu : other.cpus) {
+			if (physics.priority > 0 && std::find(physics.cpus.begin(), physics.cpus.end(), cpu) != physics.cpus.end()) {
+				ROS_WARN_STREAM("The " << kClassNames[i] << " threads share cpu " << cpu
+				                       << " with the real-time physics thread and may be starved");
+				break;
+			}
+		}
+	}
+
+#if defined(__linux__)
+	rlimit memlock_limit;
+	if (lock_memory_ && !is_root && getrlimit(RLIMIT_MEMLOCK, &memlock_limit) == 0 &&
+	    memlock_limit.rlim_cur != RLIM_INFINITY) {
+		ROS_WARN_STREAM("threads/lock_memory is set but the memlock limit is " << memlock_limit.rlim_cur
+		                                                                       << " bytes, locking will likely fail");
+	}
+#endif
+
+	bool any_configured = lock_memory_;
+	for (int i = 0; i < kNumThreadClasses; ++i) {
+		any_configured |= isConfigured(static_cast<ThreadClass>(i));
+	}
+	ROS_INFO_STREAM_COND(any_configured, "Thread configuration: " << describe());
+	return valid;
+}
+
+bool ThreadConfig::applyToCurrentThread(ThreadClass cls) const
+{
+	if (!isConfigured(cls)) {
+		return true;
+	}
+	std::string error;
+	if (!applySettings(settings_[cls], error)) {
+		ROS_WARN_STREAM("Could not configure the " << className(cls) << " thread: " << error);
+		return false;
+	}
+	ROS_INFO_STREAM("Configured the " << className(cls) << " thread: " << describeSettings(settings_[cls]));
+	return true;
+}
+
+bool ThreadConfig::applyToThreadPool(mjThreadPool *pool, int num_workers) const
+{
+	if (!isConfigured(kThreadPool) || pool == nullptr || num_workers < 1) {
+		return true;
+	}
+
+	PoolTaskArgs args;
+	args.settings    = &settings_[kThreadPool];
+	args.num_workers = num_workers;
+
+	std::vector<mjTask> tasks(static_cast<size_t>(num_workers));
+	for (auto &task : tasks) {
+		mju_defaultTask(&task);
+		task.func = applyToWorker;
+		task.args = &args;
+		mju_threadPoolEnqueue(pool, &task);
+	}
+	for (auto &task : tasks) {
+		mju_taskJoin(&task);
+	}
+
+	if (args.started.load() < num_workers) {
+		ROS_WARN_STREAM("Only " << args.started.load() << " of " << num_workers
+		                        << " threadpool workers could be configured in time");
+		return false;
+	}
+	if (args.failed.load() > 0) {
+		ROS_WARN_STREAM("Could not configure " << args.failed.load() << " of " << num_workers
+		                                       << " threadpool workers: " << args.error);
+		return false;
+	}
+	ROS_INFO_STREAM("Configured " << num_workers
+	                              << " threadpool workers: " << describeSettings(settings_[kThreadPool]));
+	return true;
+}
+
+bool ThreadConfig::applyMemoryLock() const
+{
+	if (!lock_memory_) {
+		return true;
+	}
+#if defined(__linux__)
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		ROS_WARN_STREAM("Locking memory failed: " << std::strerror(errno)
+		                                          << ". Requires CAP_IPC_LOCK or a sufficient memlock limit");
+		return false;
+	}
+	ROS_INFO("Locked process memory");
+	return true;
+#else
+	ROS_WARN("Memory locking is only supported on Linux");
+	return false;
+#endif
+}
+
+std::string ThreadConfig::describe() const
+{
+	std::ostringstream out;
+	for (int i = 0; i < kNumThreadClasses; ++i) {
+		out << kClassNames[i] << ": " << describeSettings(settings_[i]) << "; ";
+	}
+	out << "memory locking " << (lock_memory_ ? "enabled" : "disabled");
+	return out.str();
+}
+
+} // namespace mujoco_ros
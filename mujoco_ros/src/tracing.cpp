@@ -0,0 +1,263 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Authors: David P. Leins */
+
+#include <mujoco_ros/tracing.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace mujoco_ros::tracing {
+
+namespace detail {
+std::atomic_bool enabled = { false };
+} // namespace detail
+
+namespace {
+
+struct Event
+{
+	const char *name;
+	const char *category;
+	int64_t start_ns;
+	int64_t end_ns;
+};
+
+struct ThreadBuffer
+{
+	// only contended while writing a trace
+	std::mutex mutex;
+	std::vector<Event> events;
+	std::size_t capacity = 0;
+	// next slot to overwrite once the buffer is full
+	std::size_t next = 0;
+	uint32_t tid     = 0;
+	std::string name;
+	// the thread exited, the buffer is dropped once its events have been written or cleared
+	bool orphaned = false;
+};
+
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+std::unordered_set<std::string> interned;
+std::size_t buffer_capacity = 65536;
+uint32_t next_tid           = 1;
+
+void unregister(const std::shared_ptr<ThreadBuffer> &buffer)
+{
+	std::lock_guard<std::mutex> lk(registry_mutex);
+	buffers.erase(std::remove(buffers.begin(), buffers.end(), buffer), buffers.end());
+}
+
+// Owns the buffer of a thread and flags it as orphaned when the thread exits, so buffers of short-lived threads
+// (e.g. model compilation or plugin loading) do not accumulate
+struct LocalBuffer
+{
+	std::shared_ptr<ThreadBuffer> buffer;
+
+	~LocalBuffer()
+	{
+		if (!buffer) {
+			return;
+		}
+		bool empty;
+		{
+			std::lock_guard<std::mutex> lk(buffer->mutex);
+			buffer->orphaned = true;
+			empty            = buffer->events.empty();
+		}
+		if (empty) {
+			unregister(buffer);
+		}
+	}
+};
+
+thread_local LocalBuffer local_buffer;
+
+ThreadBuffer &localBuffer()
+{
+	if (!local_buffer.buffer) {
+		auto buffer = std::make_shared<ThreadBuffer>();
+		std::lock_guard<std::mutex> lk(registry_mutex);
+		buffer->capacity = buffer_capacity;
+		buffer->tid      = next_tid++;
+		buffers.emplace_back(buffer);
+		local_buffer.buffer = std::move(buffer);
+	}
+	return *local_buffer.buffer;
+}
+
+void writeEscaped(std::ostream &out, const char *str)
+{
+	out << '"';
+	for (const char *c = str; *c != '\0'; ++c) {
+		if (*c == '"' || *c == '\\') {
+			out << '\\' << *c;
+		} else if (static_cast<unsigned char>(*c) < 0x20) {
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(*c) << std::dec;
+		} else {
+			out << *c;
+		}
+	}
+	out << '"';
+}
+
+} // namespace
+
+void configure(bool enabled, std::size_t events_per_thread)
+{
+	{
+		std::lock_guard<std::mutex> lk(registry_mutex);
+		buffer_capacity = std::max<std::size_t>(1, events_per_thread);
+	}
+	detail::enabled.store(enabled);
+}
+
+void setThreadName(const std::string &name)
+{
+	ThreadBuffer &buffer = localBuffer();
+	std::lock_guard<std::mutex> lk(buffer.mutex);
+	buffer.name = name;
+}
+
+const char *intern(const std::string &str)
+{
+	std::lock_guard<std::mutex> lk(registry_mutex);
+	// elements of unordered containers are never moved, so the pointer stays valid
+	return interned.insert(str).first->c_str();
+}
+
+int64_t now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+}
+
+void record(const char *name, const char *category, int64_t start_ns, int64_t end_ns)
+{
+	ThreadBuffer &buffer = localBuffer();
+	std::lock_guard<std::mutex> lk(buffer.mutex);
+	if (buffer.events.size() < buffer.capacity) {
+		buffer.events.push_back({ name, category, start_ns, end_ns });
+	} else {
+		buffer.events[buffer.next] = { name, category, start_ns, end_ns };
+		buffer.next                = (buffer.next + 1) % buffer.capacity;
+	}
+}
+
+bool writeChromeTrace(const std::string &path, bool clear, std::size_t &num_events, std::string &error)
+{
+	num_events = 0;
+	std::ofstream out(path, std::ios::trunc);
+	if (!out) {
+		error = "Could not open '" + path + "' for writing";
+		return false;
+	}
+
+	std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+	{
+		std::lock_guard<std::mutex> lk(registry_mutex);
+		snapshot = buffers;
+	}
+
+	const int pid = static_cast<int>(getpid());
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+	bool first           = true;
+	const auto separator = [&]() {
+		if (!first) {
+			out << ",\n";
+		}
+		first = false;
+	};
+
+	std::vector<Event> events;
+	for (const auto &buffer : snapshot) {
+		std::string thread_name;
+		bool orphaned;
+		{
+			std::lock_guard<std::mutex> lk(buffer->mutex);
+			orphaned = buffer->orphaned;
+			// oldest events first
+			events.assign(buffer->events.begin() + static_cast<std::ptrdiff_t>(buffer->next), buffer->events.end());
+			events.insert(events.end(), buffer->events.begin(),
+			              buffer->events.begin() + static_cast<std::ptrdiff_t>(buffer->next));
+			thread_name = buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name;
+			if (clear) {
+				buffer->events.clear();
+				buffer->next = 0;
+			}
+		}
+
+		separator();
+		out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+		    << ",\"args\":{\"name\":";
+		writeEscaped(out, thread_name.c_str());
+		out << "}}";
+
+		for (const auto &event : events) {
+			separator();
+			out << "{\"ph\":\"X\",\"name\":";
+			writeEscaped(out, event.name);
+			out << ",\"cat\":";
+			writeEscaped(out, event.category);
+			out << ",\"ts\":" << static_cast<double>(event.start_ns) * 1e-3
+			    << ",\"dur\":" << static_cast<double>(event.end_ns - event.start_ns) * 1e-3 << ",\"pid\":" << pid
+			    << ",\"tid\":" << buffer->tid << "}";
+		}
+		num_events += events.size();
+
+		if (orphaned) {
+			unregister(buffer);
+		}
+	}
+	out << "],\"displayTimeUnit\":\"ms\"}\n";
+
+	if (!out) {
+		error = "Failed writing to '" + path + "'";
+		return false;
+	}
+	return true;
+}
+
+} // namespace mujoco_ros::tracing
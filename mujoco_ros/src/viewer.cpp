@@ -1889,6 +1889,7 @@ void Viewer::Sync()
 
 	if (pending_.ui_update_speed) {
 		env_->settings_.real_time_index = real_time_index;
+		env_->settings_.rt_factor       = MujocoEnv::percentRealTime[real_time_index] / 100.f;
 		env_->settings_.speed_changed   = true;
 		pending_.ui_update_speed        = false;
 	} else {
@@ -1941,9 +1942,8 @@ void Viewer::Sync()
 	}
 
 	if (dropload_request.load()) {
-		mju::strcpy_arr(env_->queued_filename_, dropfilename);
+		env_->queueModel(dropfilename, 3);
 		dropload_request.store(0);
-		env_->settings_.load_request.store(3);
 		update_profiler = true;
 		update_sensor   = true;
 	}
@@ -2499,7 +2499,8 @@ void Viewer::Render()
 	}
 
 	// Get desired and actual percent-of-realtime
-	float desired_real_time = MujocoEnv::percentRealTime[env_->settings_.real_time_index];
+	const float rt_factor   = env_->settings_.rt_factor.load();
+	float desired_real_time = rt_factor > 0 ? 100.f * rt_factor : -1;
 	float actual_real_time  = 100.f / env_->sim_state_.measured_slowdown;
 
 	// If running, check for misalignment of more than 10%
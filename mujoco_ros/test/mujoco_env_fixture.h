@@ -46,7 +46,10 @@ namespace mju = ::mujoco::sample_util;
 class MujocoEnvTestWrapper : public MujocoEnv
 {
 public:
-	MujocoEnvTestWrapper(const std::string &admin_hash = std::string()) : MujocoEnv(admin_hash) {}
+	MujocoEnvTestWrapper(const std::string &admin_hash = std::string(), const std::string &ns = "~")
+	    : MujocoEnv(admin_hash, ns)
+	{
+	}
 	mjModel *getModelPtr() { return model_.get(); }
 	mjData *getDataPtr() { return data_.get(); }
 	MujocoEnvMutex *getMutexPtr() { return &physics_thread_mutex_; }
@@ -57,16 +60,34 @@ public:
 
 	std::string getFilename() { return { filename_ }; }
 	int isPhysicsRunning() { return is_physics_running_; }
+	boost::thread::native_handle_type getPhysicsThreadHandle() { return physics_thread_handle_.native_handle(); }
 	int isEventRunning() { return is_event_running_; }
 	int isRenderingRunning() { return is_rendering_running_; }
 
 	int getNumCBReadyPlugins() { return cb_ready_plugins_.size(); }
+	bool hasThreadpool() { return threadpool_ != nullptr; }
+	std::vector<MujocoPlugin *> getCBReadyPlugins() { return cb_ready_plugins_; }
+	// Replaces the plugins that receive callbacks and partitions their control callbacks again
+	void setCBReadyPlugins(const std::vector<MujocoPlugin *> &plugins)
+	{
+		cb_ready_plugins_ = plugins;
+		partitionControlCbs();
+	}
+	std::vector<MujocoPlugin *> getParallelControlPlugins()
+	{
+		std::vector<MujocoPlugin *> plugins;
+		for (const auto &task : parallel_control_tasks_) {
+			plugins.emplace_back(task.plugin);
+		}
+		return plugins;
+	}
+	std::vector<MujocoPlugin *> getSerialControlPlugins() { return serial_control_plugins_; }
+	const mujoco_ros::DomainRandomizer &getDomainRandomizer() { return domain_randomizer_; }
 	void notifyGeomChange() { notifyGeomChanged(0); }
 
 	void load_filename(const std::string &filename)
 	{
-		mju::strcpy_arr(queued_filename_, filename.c_str());
-		settings_.load_request = 2;
+		queueModel(filename);
 	}
 
 	void shutdown()
@@ -80,8 +101,7 @@ public:
 
 	void startWithXML(const std::string &xml_path)
 	{
-		mju::strcpy_arr(queued_filename_, xml_path.c_str());
-		settings_.load_request = 2;
+		queueModel(xml_path);
 		startPhysicsLoop();
 		startEventLoop();
 	}
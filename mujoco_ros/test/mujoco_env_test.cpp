@@ -43,7 +43,16 @@
 #include <mujoco_ros/util.h>
 
 #include <ros/ros.h>
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include <pthread.h>
+#include <unistd.h>
 
 int main(int argc, char **argv)
 {
@@ -528,6 +537,471 @@ TEST_F(BaseEnvFixture, Reset)
 	env.shutdown();
 }
 
+TEST_F(BaseEnvFixture, DomainRandomization)
+{
+	nh->setParam("unpause", false);
+
+	XmlRpc::XmlRpcValue config;
+	config["seed"]                          = 42;
+	config["log_path"]                      = "/tmp/mujoco_ros_randomization_test.csv";
+	config["parameters"][0]["field"]        = "opt_gravity";
+	config["parameters"][0]["component"]    = 2;
+	config["parameters"][0]["low"]          = -12.0;
+	config["parameters"][0]["high"]         = -8.0;
+	config["parameters"][1]["field"]        = "geom_friction";
+	config["parameters"][1]["names"][0]     = "ball";
+	config["parameters"][1]["component"]    = 0;
+	config["parameters"][1]["mode"]         = "scale";
+	config["parameters"][1]["low"]          = 0.5;
+	config["parameters"][1]["high"]         = 1.5;
+	config["parameters"][2]["field"]        = "body_mass";
+	config["parameters"][2]["names"][0]     = "body_ball";
+	config["parameters"][2]["distribution"] = "normal";
+	config["parameters"][2]["mean"]         = 0.2;
+	config["parameters"][2]["std"]          = 0.0;
+	std::remove("/tmp/mujoco_ros_randomization_test.csv");
+	nh->setParam("domain_randomization", config);
+
+	MujocoEnvTestWrapper env;
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	env.startWithXML(xml_path);
+	while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+	EXPECT_TRUE(env.getDomainRandomizer().isEnabled()) << "Domain randomization should be enabled!";
+
+	mjModel *m       = env.getModelPtr();
+	int ball_geom_id = mj_name2id(m, mjOBJ_GEOM, "ball");
+	int ball_body_id = mj_name2id(m, mjOBJ_BODY, "body_ball");
+	EXPECT_NEAR(m->opt.gravity[2], -9.81, 1e-6) << "Gravity should not be randomized on load!";
+	const mjtNum nominal_friction = m->geom_friction[3 * ball_geom_id];
+	const mjtNum nominal_inertia  = m->body_inertia[3 * ball_body_id];
+	const mjtNum nominal_mass     = m->body_mass[ball_body_id];
+
+	mjtNum last_gravity = m->opt.gravity[2];
+	for (int episode = 1; episode <= 3; ++episode) {
+		env.settings_.reset_request.store(1);
+		while (env.settings_.reset_request != 0) { // wait for reset to be done
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		EXPECT_EQ(env.getDomainRandomizer().episode(), episode);
+		EXPECT_EQ(env.getDomainRandomizer().lastSamples().size(), 3) << "Unexpected number of sampled values!";
+
+		EXPECT_GE(m->opt.gravity[2], -12.0);
+		EXPECT_LE(m->opt.gravity[2], -8.0);
+		EXPECT_NE(m->opt.gravity[2], last_gravity) << "Gravity should be resampled on every reset!";
+		last_gravity = m->opt.gravity[2];
+
+		// Scaled relative to the nominal value, not the last sample
+		EXPECT_GE(m->geom_friction[3 * ball_geom_id], 0.5 * nominal_friction - 1e-9);
+		EXPECT_LE(m->geom_friction[3 * ball_geom_id], 1.5 * nominal_friction + 1e-9);
+
+		EXPECT_NEAR(m->body_mass[ball_body_id], 0.2, 1e-9);
+		EXPECT_NEAR(m->body_inertia[3 * ball_body_id], nominal_inertia * 0.2 / nominal_mass, 1e-9)
+		    << "Inertia should be scaled along with the mass!";
+	}
+
+	env.shutdown();
+
+	std::ifstream log("/tmp/mujoco_ros_randomization_test.csv");
+	std::string line;
+	int num_lines = 0;
+	while (std::getline(log, line)) {
+		num_lines++;
+	}
+	EXPECT_EQ(num_lines, 9) << "Every sampled value should be logged!";
+
+	nh->deleteParam("domain_randomization");
+	std::remove("/tmp/mujoco_ros_randomization_test.csv");
+}
+
+TEST_F(BaseEnvFixture, DomainRandomizationClamped)
+{
+	nh->setParam("unpause", false);
+
+	XmlRpc::XmlRpcValue config;
+	config["seed"]                          = 42;
+	config["parameters"][0]["field"]        = "body_mass";
+	config["parameters"][0]["names"][0]     = "body_ball";
+	config["parameters"][0]["distribution"] = "normal";
+	config["parameters"][0]["mean"]         = -1.0;
+	config["parameters"][0]["std"]          = 0.0;
+	config["parameters"][1]["field"]        = "geom_friction";
+	config["parameters"][1]["names"][0]     = "ball";
+	config["parameters"][1]["component"]    = 0;
+	config["parameters"][1]["mode"]         = "offset";
+	config["parameters"][1]["low"]          = -20.0;
+	config["parameters"][1]["high"]         = -10.0;
+	config["parameters"][2]["field"]        = "opt_gravity";
+	config["parameters"][2]["component"]    = 2;
+	config["parameters"][2]["low"]          = -12.0;
+	config["parameters"][2]["high"]         = -8.0;
+	nh->setParam("domain_randomization", config);
+
+	MujocoEnvTestWrapper env;
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	env.startWithXML(xml_path);
+	while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+
+	env.settings_.reset_request.store(1);
+	while (env.settings_.reset_request != 0) { // wait for reset to be done
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	mjModel *m       = env.getModelPtr();
+	int ball_geom_id = mj_name2id(m, mjOBJ_GEOM, "ball");
+	int ball_body_id = mj_name2id(m, mjOBJ_BODY, "body_ball");
+	EXPECT_GT(m->body_mass[ball_body_id], 0) << "Mass should be clamped to a positive value!";
+	EXPECT_GT(m->body_inertia[3 * ball_body_id], 0) << "Inertia should stay positive!";
+	EXPECT_EQ(m->geom_friction[3 * ball_geom_id], 0) << "Friction should be clamped to 0!";
+	EXPECT_LT(m->opt.gravity[2], 0) << "Fields without a lower bound should not be clamped!";
+	for (const auto &sample : env.getDomainRandomizer().lastSamples()) {
+		if (sample.field != "opt_gravity") {
+			EXPECT_GE(sample.value, 0) << "Reported samples should be clamped!";
+		}
+	}
+
+	env.shutdown();
+	nh->deleteParam("domain_randomization");
+}
+
+TEST_F(BaseEnvFixture, ModelCache)
+{
+	const std::string cache_dir = "/tmp/mujoco_ros_model_cache_test";
+	boost::filesystem::remove_all(cache_dir);
+	nh->setParam("unpause", false);
+	nh->setParam("model_cache/enabled", true);
+	nh->setParam("model_cache/path", cache_dir);
+
+	MujocoEnvTestWrapper env;
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	env.startWithXML(xml_path);
+	while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+	ASSERT_TRUE(env.getModelPtr());
+	const int nq = env.getModelPtr()->nq;
+
+	int num_cached = 0;
+	for (const auto &entry : boost::filesystem::directory_iterator(cache_dir)) {
+		EXPECT_EQ(entry.path().extension(), ".mjb") << "Only compiled models should be in the cache directory!";
+		num_cached++;
+	}
+	EXPECT_EQ(num_cached, 1) << "Compiled model should have been stored on disk!";
+
+	// Reloading the same model uses the cache and yields an equivalent model
+	env.load_filename(xml_path);
+	while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+	ASSERT_TRUE(env.getModelPtr());
+	EXPECT_TRUE(env.sim_state_.model_valid);
+	EXPECT_EQ(env.getModelPtr()->nq, nq);
+	EXPECT_EQ(mujoco_ros::ModelCache::keyForFile(xml_path), mujoco_ros::ModelCache::keyForFile(xml_path))
+	    << "Keys should be deterministic!";
+	EXPECT_NE(mujoco_ros::ModelCache::keyForString("<mujoco/>"), mujoco_ros::ModelCache::keyForString("<mujoco />"));
+
+	env.shutdown();
+	nh->deleteParam("model_cache");
+	boost::filesystem::remove_all(cache_dir);
+}
+
+TEST(ModelCache, KeyCoversAllFileAttributes)
+{
+	namespace fs = boost::filesystem;
+	const fs::path dir = "/tmp/mujoco_ros_model_cache_deps_test";
+	fs::remove_all(dir);
+	fs::create_directories(dir / "textures");
+	const auto write = [](const fs::path &path, const std::string &content) {
+		std::ofstream file(path.string());
+		file << content;
+	};
+
+	// Cube textures referenced from the second texturedir
+	const fs::path model = dir / "model.xml";
+	write(model, "<mujoco><compiler texturedir=\"missing\"/><compiler texturedir=\"textures\"/><asset>"
+	             "<texture name=\"sky\" type=\"skybox\" fileright=\"right.png\" fileleft=\"left.png\"/>"
+	             "</asset></mujoco>");
+	write(dir / "textures" / "right.png", "right");
+	write(dir / "textures" / "left.png", "left");
+
+	const uint64_t key = mujoco_ros::ModelCache::keyForFile(model.string());
+	write(dir / "textures" / "right.png", "changed");
+	const uint64_t key_right = mujoco_ros::ModelCache::keyForFile(model.string());
+	EXPECT_NE(key, key_right) << "Changing a cube texture face should change the key";
+	write(dir / "textures" / "left.png", "changed");
+	EXPECT_NE(key_right, mujoco_ros::ModelCache::keyForFile(model.string()));
+
+	EXPECT_TRUE(mujoco_ros::ModelCache::referencesFiles("<mujoco><asset><mesh file=\"a.stl\"/></asset></mujoco>"));
+	EXPECT_TRUE(mujoco_ros::ModelCache::referencesFiles("<mujoco><asset><texture fileup='up.png'/></asset></mujoco>"));
+	EXPECT_FALSE(mujoco_ros::ModelCache::referencesFiles("<mujoco/>"));
+
+	fs::remove_all(dir);
+}
+
+TEST(ModelCache, KeyResolvesAssetsPerType)
+{
+	namespace fs = boost::filesystem;
+	const fs::path dir = "/tmp/mujoco_ros_model_cache_dirs_test";
+	fs::remove_all(dir);
+	fs::create_directories(dir / "meshes");
+	fs::create_directories(dir / "textures");
+	const auto write = [](const fs::path &path, const std::string &content) {
+		std::ofstream file(path.string());
+		file << content;
+	};
+
+	// Mesh and texture with the same basename, each has to be looked up in the directory of its type
+	const fs::path model = dir / "model.xml";
+	write(model, "<mujoco><compiler meshdir=\"meshes\" texturedir=\"textures\"/><asset>"
+	             "<mesh name=\"shape\" file=\"shape.bin\"/><texture name=\"tex\" type=\"2d\" file=\"shape.bin\"/>"
+	             "</asset></mujoco>");
+	write(dir / "meshes" / "shape.bin", "mesh");
+	write(dir / "textures" / "shape.bin", "texture");
+
+	const uint64_t key = mujoco_ros::ModelCache::keyForFile(model.string());
+	write(dir / "textures" / "shape.bin", "changed");
+	const uint64_t key_texture = mujoco_ros::ModelCache::keyForFile(model.string());
+	EXPECT_NE(key, key_texture) << "Changing the texture should change the key";
+	write(dir / "meshes" / "shape.bin", "changed");
+	EXPECT_NE(key_texture, mujoco_ros::ModelCache::keyForFile(model.string()))
+	    << "Changing the mesh should change the key";
+
+	fs::remove_all(dir);
+}
+
+TEST_F(BaseEnvFixture, FastReset)
+{
+	nh->setParam("unpause", false);
+	nh->setParam("fast_reset", true);
+
+	std::map<std::string, std::string> pos_map, vel_map;
+	pos_map.insert({ "joint1", "-1.57" });
+	pos_map.insert({ "joint2", "-0.66" });
+	vel_map.insert({ "joint2", "1.05" });
+	nh->setParam("initial_joint_positions/joint_map", pos_map);
+	nh->setParam("initial_joint_velocities/joint_map", vel_map);
+
+	MujocoEnvTestWrapper env;
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	env.startWithXML(xml_path);
+	while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+	EXPECT_TRUE(env.settings_.fast_reset) << "Fast reset should be enabled!";
+
+	mjModel *m = env.getModelPtr();
+	mjData *d  = env.getDataPtr();
+	int id1    = mujoco_ros::util::jointName2id(m, "joint1");
+	int id2    = mujoco_ros::util::jointName2id(m, "joint2");
+	EXPECT_NE(id1, -1) << "joint1 should exist in model!";
+	EXPECT_NE(id2, -1) << "joint2 should exist in model!";
+
+	EXPECT_TRUE(env.step(100)) << "Stepping failed!";
+	EXPECT_NEAR(d->time, 100 * m->opt.timestep, 1e-6) << "Time should have been running!";
+
+	// Changes to the parameter server should not have an effect on fast resets
+	pos_map["joint1"] = "0.5";
+	nh->setParam("initial_joint_positions/joint_map", pos_map);
+
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env.getMutexPtr());
+		d->qpos[m->jnt_qposadr[id2]] = 0.5;
+		d->qvel[m->jnt_dofadr[id1]]  = 0.3;
+		d->qfrc_applied[m->nv - 1]   = 2.0;
+		env.settings_.reset_request.store(1);
+	}
+
+	float seconds = 0;
+	while (env.settings_.reset_request != 0 && seconds < 2) { // wait for reset to be done
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	EXPECT_LT(seconds, 2) << "Reset should have been executed but ran into 2 seconds timeout!";
+
+	EXPECT_NEAR(d->time, 0, 1e-6) << "Time should have been reset to 0!";
+	EXPECT_NEAR(d->qpos[m->jnt_qposadr[id1]], -1.57, 1e-6) << "joint1 position should have been restored!";
+	EXPECT_NEAR(d->qpos[m->jnt_qposadr[id2]], -0.66, 1e-6) << "joint2 position should have been restored!";
+	EXPECT_NEAR(d->qvel[m->jnt_dofadr[id1]], 0, 1e-6) << "joint1 velocity should have been restored!";
+	EXPECT_NEAR(d->qvel[m->jnt_dofadr[id2]], 1.05, 1e-6) << "joint2 velocity should have been restored!";
+	EXPECT_EQ(d->qfrc_applied[m->nv - 1], 0) << "Applied forces should have been reset!";
+
+	env.shutdown();
+
+	nh->deleteParam("initial_joint_positions/joint_map");
+	nh->deleteParam("initial_joint_velocities/joint_map");
+	nh->setParam("fast_reset", false);
+	nh->setParam("unpause", true);
+}
+
+TEST_F(PendulumEnvFixture, SaveAndRestoreState)
+{
+	mjModel *m = env_ptr->getModelPtr();
+	mjData *d  = env_ptr->getDataPtr();
+	int id2    = mujoco_ros::util::jointName2id(m, "joint2");
+	EXPECT_NE(id2, -1) << "joint2 should exist in model!";
+
+	EXPECT_FALSE(env_ptr->restoreState("branch")) << "Restoring a slot that was never saved should fail!";
+
+	EXPECT_TRUE(env_ptr->step(10)) << "Stepping failed!";
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env_ptr->getMutexPtr());
+		d->qpos[m->jnt_qposadr[id2]] = 0.3;
+		d->qvel[m->jnt_dofadr[id2]]  = -0.2;
+	}
+	const mjtNum saved_time = d->time;
+	EXPECT_TRUE(env_ptr->saveState("branch")) << "Saving state failed!";
+
+	std::vector<mjtNum> qpos_expected(d->qpos, d->qpos + m->nq);
+	std::vector<mjtNum> qvel_expected(d->qvel, d->qvel + m->nv);
+
+	// Branch off multiple times from the same state
+	for (int i = 0; i < 3; i++) {
+		EXPECT_TRUE(env_ptr->step(50)) << "Stepping failed!";
+		EXPECT_GT(d->time, saved_time) << "Time should have moved on!";
+
+		EXPECT_TRUE(env_ptr->restoreState("branch")) << "Restoring state failed!";
+		EXPECT_DOUBLE_EQ(d->time, saved_time) << "Time should have been restored!";
+		for (int j = 0; j < m->nq; j++) {
+			EXPECT_DOUBLE_EQ(d->qpos[j], qpos_expected[j]) << "qpos[" << j << "] should have been restored!";
+		}
+		for (int j = 0; j < m->nv; j++) {
+			EXPECT_DOUBLE_EQ(d->qvel[j], qvel_expected[j]) << "qvel[" << j << "] should have been restored!";
+		}
+	}
+
+	// Reloading invalidates all slots
+	load_queued_model(*env_ptr);
+	EXPECT_FALSE(env_ptr->restoreState("branch")) << "Slots should have been cleared on reload!";
+}
+
+TEST_F(BaseEnvFixture, ResumeFromCheckpoint)
+{
+	const boost::filesystem::path checkpoint_dir =
+	    boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mujoco_ros_checkpoint_%%%%-%%%%");
+	boost::filesystem::create_directories(checkpoint_dir);
+	const std::string checkpoint_path = (checkpoint_dir / "checkpoint.bin").string();
+
+	nh->setParam("unpause", false);
+	nh->setParam("checkpoint/path", checkpoint_path);
+	nh->setParam("checkpoint/period", 0.0095);
+	nh->setParam("checkpoint/count", 3);
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+
+	mjtNum checkpoint_time;
+	std::vector<mjtNum> checkpoint_qpos;
+	{
+		MujocoEnvTestWrapper env;
+		env.startWithXML(xml_path);
+		while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+
+		mjModel *m = env.getModelPtr();
+		mjData *d  = env.getDataPtr();
+		// step until one checkpoint has been written
+		const int steps = static_cast<int>(std::round(0.01 / m->opt.timestep));
+		EXPECT_TRUE(env.step(steps)) << "Stepping failed!";
+		checkpoint_time = d->time;
+		checkpoint_qpos.assign(d->qpos, d->qpos + m->nq);
+
+		// not enough time passed for another checkpoint
+		EXPECT_TRUE(env.step(1)) << "Stepping failed!";
+		env.shutdown();
+	}
+
+	// Checkpoints of another model must not replace the ones of the pendulum
+	{
+		MujocoEnvTestWrapper env;
+		env.startWithXML(ros::package::getPath("mujoco_ros") + "/test/empty_world.xml");
+		while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+		EXPECT_TRUE(env.step(static_cast<int>(std::round(0.01 / env.getModelPtr()->opt.timestep))))
+		    << "Stepping failed!";
+		env.shutdown();
+	}
+
+	nh->setParam("checkpoint/resume_on_load", true);
+	{
+		MujocoEnvTestWrapper env;
+		env.startWithXML(xml_path);
+		while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+
+		mjModel *m = env.getModelPtr();
+		mjData *d  = env.getDataPtr();
+		EXPECT_DOUBLE_EQ(d->time, checkpoint_time) << "Simulation should have resumed from the last checkpoint!";
+		for (int i = 0; i < m->nq; i++) {
+			EXPECT_DOUBLE_EQ(d->qpos[i], checkpoint_qpos[i]) << "qpos[" << i << "] should have been restored!";
+		}
+		env.shutdown();
+	}
+
+	nh->deleteParam("checkpoint");
+	boost::filesystem::remove_all(checkpoint_dir);
+	nh->setParam("unpause", true);
+}
+
+TEST_F(BaseEnvFixture, CheckpointsOfSameSizedModelsAreSeparate)
+{
+	const boost::filesystem::path checkpoint_dir =
+	    boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("mujoco_ros_checkpoint_%%%%-%%%%");
+	boost::filesystem::create_directories(checkpoint_dir);
+
+	nh->setParam("unpause", false);
+	nh->setParam("checkpoint/path", (checkpoint_dir / "checkpoint.bin").string());
+	nh->setParam("checkpoint/period", 0.0095);
+	nh->setParam("checkpoint/count", 3);
+
+	// Same layout (one free body), different content
+	const auto scene = [](double height) {
+		return "<mujoco><worldbody><body pos=\"0 0 " + std::to_string(height) +
+		       "\"><freejoint/><geom type=\"sphere\" size=\"0.1\"/></body></worldbody></mujoco>";
+	};
+	const std::string xml_a = scene(1.0);
+	const std::string xml_b = scene(2.0);
+
+	{
+		MujocoEnvTestWrapper env;
+		env.startWithXML(xml_a);
+		while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+		EXPECT_TRUE(env.step(static_cast<int>(std::round(0.01 / env.getModelPtr()->opt.timestep))))
+		    << "Stepping failed!";
+		env.shutdown();
+	}
+
+	nh->setParam("checkpoint/resume_on_load", true);
+	{
+		MujocoEnvTestWrapper env;
+		env.startWithXML(xml_b);
+		while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+		EXPECT_DOUBLE_EQ(env.getDataPtr()->time, 0) << "Checkpoints of another model should not be resumed!";
+		EXPECT_DOUBLE_EQ(env.getDataPtr()->qpos[2], 2.0) << "State of another model should not be restored!";
+		env.shutdown();
+	}
+	{
+		MujocoEnvTestWrapper env;
+		env.startWithXML(xml_a);
+		while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		}
+		EXPECT_GT(env.getDataPtr()->time, 0) << "Checkpoint of the same model should be resumed!";
+		env.shutdown();
+	}
+
+	nh->deleteParam("checkpoint");
+	boost::filesystem::remove_all(checkpoint_dir);
+	nh->setParam("unpause", true);
+}
+
 // Test reloading
 TEST_F(BaseEnvFixture, Reload)
 {
@@ -550,9 +1024,7 @@ TEST_F(BaseEnvFixture, Reload)
 
 	// Load new model in paused state
 	std::string xml_path2 = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
-	mju::strcpy_arr(env.queued_filename_, xml_path2.c_str());
-
-	load_queued_model(env);
+	load_queued_model(env, xml_path2);
 	EXPECT_EQ(env.getFilename(), xml_path2) << "Wrong content in filename_!";
 
 	env.settings_.run.store(1);
@@ -629,3 +1101,252 @@ TEST_F(BaseEnvFixture, InitModelFromInvalidQueuedBuffer)
 
 	env.shutdown();
 }
+
+TEST_F(BaseEnvFixture, NewerLoadRequestSupersedes)
+{
+	MujocoEnvTestWrapper env;
+	const std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/empty_world.xml";
+	env.startWithXML(xml_path);
+
+	while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+
+	// Queue two models back to back, the second one has to win regardless of when the first one is compiled
+	const std::string first  = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	const std::string second = ros::package::getPath("mujoco_ros") + "/test/batch_world.xml";
+	ASSERT_TRUE(env.queueModel(first));
+	ASSERT_TRUE(env.queueModel(second));
+
+	float seconds = 0;
+	while (env.getOperationalStatus() != 0 && seconds < 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	ASSERT_LT(seconds, 2) << "Env loading ran into 2 seconds timeout!";
+
+	EXPECT_EQ(env.getFilename(), second) << "Superseded model should not be loaded";
+	EXPECT_EQ(env.getModelPtr()->nu, 1) << "Model of the second request should be loaded";
+	EXPECT_TRUE(env.sim_state_.model_valid);
+
+	EXPECT_FALSE(env.queueModel(std::string(MujocoEnv::kMaxFilenameLength, 'x')))
+	    << "Models exceeding the queue size should be rejected";
+	EXPECT_EQ(env.getOperationalStatus(), 0) << "Rejected models should not issue a load request";
+
+	env.shutdown();
+}
+
+TEST_F(BaseEnvFixture, EventLoopRunsHeadless)
+{
+	MujocoEnvTestWrapper env;
+	const std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/empty_world.xml";
+	env.startWithXML(xml_path);
+
+	while (env.getOperationalStatus() != 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+
+	// Same state as after the last viewer disconnected
+	env.settings_.headless = true;
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_EQ(env.isEventRunning(), 1) << "Event loop should keep running without viewers";
+
+	const std::string xml_path2 = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	load_queued_model(env, xml_path2);
+	EXPECT_EQ(env.getFilename(), xml_path2) << "Load requests should be handled in headless mode";
+
+	env.settings_.reset_request.store(1);
+	float seconds = 0;
+	while (env.settings_.reset_request.load() != 0 && seconds < 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	EXPECT_LT(seconds, 2) << "Reset requests should be handled in headless mode";
+
+	env.shutdown();
+}
+
+TEST_F(BaseEnvFixture, ThreadConfigValidation)
+{
+	nh->setParam("threads/physics/cpus", std::vector<int>{ 0, 100000 });
+	nh->setParam("threads/physics/priority", 500);
+	nh->setParam("threads/event/cpus", "not a list");
+
+	ThreadConfig config;
+	EXPECT_FALSE(config.load(*nh)) << "Invalid entries should be reported";
+
+	const auto &physics = config.settings(ThreadConfig::kPhysics);
+	EXPECT_EQ(std::count(physics.cpus.begin(), physics.cpus.end(), 100000), 0) << "Non-existent cpu should be dropped";
+	EXPECT_EQ(physics.priority, 0) << "Out of range priority should fall back to default scheduling";
+	EXPECT_TRUE(config.settings(ThreadConfig::kEvent).cpus.empty()) << "Malformed cpu list should be ignored";
+	EXPECT_FALSE(config.isConfigured(ThreadConfig::kRender));
+	EXPECT_TRUE(config.applyToCurrentThread(ThreadConfig::kRender)) << "Unconfigured classes should be a no-op";
+
+	nh->deleteParam("threads");
+}
+
+TEST_F(BaseEnvFixture, ShmTransportLockstep)
+{
+	const std::string shm_name = "mujoco_ros_test_" + std::to_string(getpid());
+	nh->setParam("shm/name", shm_name);
+	nh->setParam("shm/lockstep", true);
+	nh->setParam("realtime", -1.0);
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/batch_world.xml";
+
+	MujocoEnvTestWrapper env;
+	env.startWithXML(xml_path);
+
+	float seconds = 0;
+	while (env.getOperationalStatus() != 0 && seconds < 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	ASSERT_LT(seconds, 2) << "Env loading ran into 2 seconds timeout!";
+
+	shm::Client client;
+	std::string error;
+	ASSERT_TRUE(client.attach(shm_name, error)) << error;
+	EXPECT_TRUE(client.isLockstep());
+	EXPECT_EQ(client.nq(), 1u);
+	EXPECT_EQ(client.nv(), 1u);
+	EXPECT_EQ(client.nu(), 1u);
+	EXPECT_EQ(client.nsensordata(), 1u);
+
+	shm::Observation obs;
+	ASSERT_TRUE(client.waitForObservation(shm::Seconds(1.0))) << "Initial observation should be published on load";
+	ASSERT_TRUE(client.readObservation(obs, true));
+	const double start_time = obs.time;
+
+	// Without actions the simulation does not advance
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_FALSE(client.hasObservation());
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env.getMutexPtr());
+		EXPECT_DOUBLE_EQ(env.getDataPtr()->time, start_time);
+	}
+
+	// One step per action
+	const double ctrl = 2.0;
+	for (int i = 1; i <= 10; ++i) {
+		ASSERT_TRUE(client.sendAction(&ctrl));
+		ASSERT_TRUE(client.waitForObservation(shm::Seconds(1.0))) << "No observation for action " << i;
+		ASSERT_TRUE(client.readObservation(obs));
+		EXPECT_NEAR(obs.time, start_time + i * env.getModelPtr()->opt.timestep, 1e-9);
+	}
+	EXPECT_GT(obs.qpos[0], 0) << "Positive torque should rotate the pendulum forwards";
+	EXPECT_GT(obs.qvel[0], 0);
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env.getMutexPtr());
+		EXPECT_DOUBLE_EQ(env.getDataPtr()->ctrl[0], ctrl);
+	}
+
+	env.shutdown();
+	nh->deleteParam("shm");
+	nh->deleteParam("realtime");
+}
+
+TEST_F(BaseEnvFixture, ShmTransportLockstepBoundRate)
+{
+	const std::string shm_name = "mujoco_ros_test_bound_" + std::to_string(getpid());
+	nh->setParam("shm/name", shm_name);
+	nh->setParam("shm/lockstep", true);
+	// 10 ms of wall time per step
+	nh->setParam("realtime", 0.1);
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/batch_world.xml";
+
+	MujocoEnvTestWrapper env;
+	env.startWithXML(xml_path);
+
+	float seconds = 0;
+	while (env.getOperationalStatus() != 0 && seconds < 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	ASSERT_LT(seconds, 2) << "Env loading ran into 2 seconds timeout!";
+
+	shm::Client client;
+	std::string error;
+	ASSERT_TRUE(client.attach(shm_name, error)) << error;
+	shm::Observation obs;
+	ASSERT_TRUE(client.waitForObservation(shm::Seconds(1.0)));
+	ASSERT_TRUE(client.readObservation(obs, true));
+	const double start_time = obs.time;
+
+	clockid_t physics_clock;
+	ASSERT_EQ(pthread_getcpuclockid(env.getPhysicsThreadHandle(), &physics_clock), 0);
+	const auto cpuTime = [physics_clock]() {
+		timespec ts;
+		clock_gettime(physics_clock, &ts);
+		return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+	};
+
+	const int num_actions  = 10;
+	const double ctrl      = 1.0;
+	const double cpu_start = cpuTime();
+	const auto wall_start  = std::chrono::steady_clock::now();
+	for (int i = 1; i <= num_actions; ++i) {
+		ASSERT_TRUE(client.sendAction(&ctrl));
+		ASSERT_TRUE(client.waitForObservation(shm::Seconds(1.0))) << "No observation for action " << i;
+		ASSERT_TRUE(client.readObservation(obs));
+		EXPECT_NEAR(obs.time, start_time + i * 0.001, 1e-9) << "Each action should advance exactly one step";
+	}
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	const double cpu  = cpuTime() - cpu_start;
+
+	EXPECT_GT(wall, 0.5 * num_actions * 0.01) << "Lockstep steps should still be paced";
+	EXPECT_LT(cpu, 0.5 * wall) << "Physics thread should sleep until the deadline of a pending action";
+
+	env.shutdown();
+	nh->deleteParam("shm");
+	nh->deleteParam("realtime");
+}
+
+TEST(ShmTransport, RingFullAndClose)
+{
+	char error_buf[1000];
+	const std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/batch_world.xml";
+	mjModel *m                 = mj_loadXML(xml_path.c_str(), nullptr, error_buf, 1000);
+	ASSERT_NE(m, nullptr) << error_buf;
+	mjData *d = mj_makeData(m);
+
+	const std::string shm_name = "mujoco_ros_ring_test_" + std::to_string(getpid());
+	shm::Server server;
+	server.configure(shm_name, 4, false);
+	std::string error;
+	ASSERT_TRUE(server.open(m, d, error)) << error;
+
+	shm::Client client;
+	EXPECT_FALSE(client.isLockstep()) << "A detached client has no segment to read the mode from";
+	EXPECT_EQ(client.nq(), 0u);
+	ASSERT_TRUE(client.attach(shm_name, error)) << error;
+	EXPECT_FALSE(client.isLockstep());
+
+	// The initial observation plus 3 fill the ring, further ones replace the oldest when streaming
+	for (int i = 0; i < 5; ++i) {
+		server.publish(d);
+	}
+	EXPECT_EQ(server.dropped(), 2u);
+	shm::Observation obs;
+	ASSERT_TRUE(client.readObservation(obs));
+	EXPECT_EQ(obs.step, 2u) << "The two oldest observations should have been discarded";
+	ASSERT_TRUE(client.readObservation(obs, true));
+	EXPECT_EQ(obs.step, 5u) << "The newest published observation should be returned";
+	EXPECT_FALSE(client.hasObservation());
+
+	// When streaming, only the newest action is applied
+	for (const double ctrl : { 1.0, 2.0, 3.0 }) {
+		EXPECT_TRUE(client.sendAction(&ctrl));
+	}
+	EXPECT_TRUE(server.hasAction());
+	EXPECT_TRUE(server.applyAction(d));
+	EXPECT_DOUBLE_EQ(d->ctrl[0], 3.0);
+	EXPECT_FALSE(server.hasAction());
+
+	server.close();
+	EXPECT_TRUE(client.isClosed());
+	shm::Client late_client;
+	EXPECT_FALSE(late_client.attach(shm_name, error)) << "Closed segments should be removed";
+
+	mj_deleteData(d);
+	mj_deleteModel(m);
+}
@@ -42,7 +42,9 @@
 #include "test_plugin/test_plugin.h"
 
 #include <mujoco_ros/mujoco_env.h>
+#include <mujoco_ros/env_pool.h>
 #include <mujoco_ros/plugin_utils.h>
+#include <mujoco_ros/latency_histogram.h>
 #include <string>
 
 int main(int argc, char **argv)
@@ -389,3 +391,314 @@ TEST_F(LoadedPluginFixture, PluginStats_ResetTimeOnReset)
 	EXPECT_EQ(srv.response.stats[0].plugin_type, "mujoco_ros/TestPlugin") << "Should be TestPlugin!";
 	EXPECT_GT(srv.response.stats[0].reset_time, -1) << "Reset time should be unset!";
 }
+
+TEST_F(LoadedPluginFixture, PluginStats_LatencyHistograms)
+{
+	env_ptr->step(100);
+
+	mujoco_ros_msgs::GetPluginStats srv;
+	srv.request.reset = true;
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/get_plugin_stats", srv))
+	    << "Get plugin stats service call failed!";
+	ASSERT_EQ(srv.response.stats.size(), 1) << "Should have 1 plugin stats!";
+
+	const auto &control = srv.response.stats[0].control_latency;
+	// mj_forward calls outside of steps also run the control callback
+	EXPECT_GE(control.count, 100) << "Control callback should have been recorded once per step!";
+	EXPECT_GE(srv.response.stats[0].last_stage_latency.count, 100)
+	    << "Last stage callback should have been recorded once per step!";
+	EXPECT_LE(control.p50, control.p90);
+	EXPECT_LE(control.p90, control.p99);
+	EXPECT_LE(control.p99, control.p999);
+	EXPECT_LE(control.p999, control.max);
+	EXPECT_GT(control.max, 0);
+
+	srv.request.reset = false;
+	srv.response.stats.clear();
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/get_plugin_stats", srv))
+	    << "Get plugin stats service call failed!";
+	ASSERT_EQ(srv.response.stats.size(), 1) << "Should have 1 plugin stats!";
+	EXPECT_EQ(srv.response.stats[0].control_latency.count, 0) << "Histograms should have been reset!";
+	EXPECT_EQ(srv.response.stats[0].control_latency.max, 0) << "Histograms should have been reset!";
+}
+
+TEST_F(BaseEnvFixture, MultipleEnvsRouteCallbacks)
+{
+	nh->setParam("unpause", false);
+	nh->setParam("env_b/unpause", false);
+	nh->setParam("env_b/no_x", true);
+	nh->setParam("env_b/publish_clock", false);
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/empty_world.xml";
+
+	MujocoEnvTestWrapper env_a;
+	MujocoEnvTestWrapper env_b("", "~env_b");
+	EXPECT_NE(env_a.getHandleNamespace(), env_b.getHandleNamespace());
+
+	env_a.load_filename(xml_path);
+	env_b.load_filename(xml_path);
+	env_a.startEventLoop();
+	env_b.startEventLoop();
+
+	float seconds = 0;
+	while ((env_a.getOperationalStatus() != 0 || env_b.getOperationalStatus() != 0) && seconds < 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	ASSERT_LT(seconds, 2) << "Env loading ran into 2 seconds timeout!";
+
+	const auto find_test_plugin = [](MujocoEnvTestWrapper &env) -> TestPlugin * {
+		for (const auto &p : env.getPlugins()) {
+			if (auto *plugin = dynamic_cast<TestPlugin *>(p.get())) {
+				return plugin;
+			}
+		}
+		return nullptr;
+	};
+	TestPlugin *plugin_a = find_test_plugin(env_a);
+	TestPlugin *plugin_b = find_test_plugin(env_b);
+	ASSERT_NE(plugin_a, nullptr);
+	ASSERT_NE(plugin_b, nullptr);
+	EXPECT_EQ(MujocoEnv::lookup(env_a.getDataPtr()), &env_a);
+	EXPECT_EQ(MujocoEnv::lookup(env_b.getDataPtr()), &env_b);
+
+	plugin_a->ran_control_cb = false;
+	plugin_b->ran_control_cb = false;
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env_a.getMutexPtr());
+		mj_step(env_a.getModelPtr(), env_a.getDataPtr());
+	}
+	EXPECT_TRUE(plugin_a->ran_control_cb.load());
+	EXPECT_FALSE(plugin_b->ran_control_cb.load()) << "Control callback of env_a was routed to env_b!";
+
+	plugin_a->ran_control_cb = false;
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env_b.getMutexPtr());
+		mj_step(env_b.getModelPtr(), env_b.getDataPtr());
+	}
+	EXPECT_FALSE(plugin_a->ran_control_cb.load()) << "Control callback of env_b was routed to env_a!";
+	EXPECT_TRUE(plugin_b->ran_control_cb.load());
+
+	// Data not owned by any environment is ambiguous with two environments, unless it is registered
+	mjData *copy = mj_copyData(nullptr, env_a.getModelPtr(), env_a.getDataPtr());
+	plugin_a->ran_control_cb = false;
+	plugin_b->ran_control_cb = false;
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env_a.getMutexPtr());
+		mj_step(env_a.getModelPtr(), copy);
+	}
+	EXPECT_FALSE(plugin_a->ran_control_cb.load()) << "Unregistered data should not be routed to any env!";
+	EXPECT_FALSE(plugin_b->ran_control_cb.load()) << "Unregistered data should not be routed to any env!";
+
+	env_a.registerData(copy);
+	EXPECT_EQ(MujocoEnv::lookup(copy), &env_a);
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env_a.getMutexPtr());
+		mj_step(env_a.getModelPtr(), copy);
+	}
+	EXPECT_TRUE(plugin_a->ran_control_cb.load()) << "Registered data should be routed to env_a!";
+	EXPECT_FALSE(plugin_b->ran_control_cb.load());
+	env_a.unregisterData(copy);
+	EXPECT_EQ(MujocoEnv::lookup(copy), nullptr);
+	mj_deleteData(copy);
+
+	env_a.shutdown();
+	env_b.shutdown();
+	nh->deleteParam("env_b");
+}
+
+TEST_F(BaseEnvFixture, EnvPoolTicksEnvsIndependently)
+{
+	nh->setParam("realtime", -1.0);
+	nh->setParam("env_0/num_steps", 50);
+	nh->setParam("env_1/num_steps", 120);
+	const std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/empty_world.xml";
+
+	{
+		EnvPool pool(2, 2);
+		ASSERT_EQ(pool.size(), 2u);
+		pool.start(xml_path);
+
+		float seconds = 0;
+		while ((pool.env(0)->getOperationalStatus() != 0 || pool.env(1)->getOperationalStatus() != 0) && seconds < 2) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			seconds += 0.001;
+		}
+		ASSERT_LT(seconds, 2) << "Env loading ran into 2 seconds timeout!";
+
+		// The test plugin keeps the data of its env, the pool does not expose it
+		const auto find_data = [](MujocoEnv *env) -> const mjData * {
+			for (const auto &p : env->getPlugins()) {
+				if (auto *plugin = dynamic_cast<TestPlugin *>(p.get())) {
+					return plugin->d_;
+				}
+			}
+			return nullptr;
+		};
+		const mjData *d0 = find_data(pool.env(0));
+		const mjData *d1 = find_data(pool.env(1));
+		ASSERT_NE(d0, nullptr);
+		ASSERT_NE(d1, nullptr);
+		EXPECT_NE(d0, d1);
+
+		// A tick runs at most max_steps steps. It is skipped if the event loop holds the physics mutex, so retry
+		for (int i = 0; i < 100 && d0->time == 0; ++i) {
+			pool.env(0)->tickPhysics(3);
+		}
+		EXPECT_NEAR(d0->time, 3 * 0.001, 1e-9) << "A single tick should run max_steps steps!";
+		EXPECT_EQ(d1->time, 0) << "Ticking env_0 should not step env_1!";
+
+		// run() returns once both envs reached their step limit
+		std::atomic_bool finished = { false };
+		std::thread runner([&pool, &finished]() {
+			pool.run();
+			finished = true;
+		});
+		seconds = 0;
+		while (!finished.load() && seconds < 5) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			seconds += 0.001;
+		}
+		if (!finished.load()) {
+			pool.requestExit();
+		}
+		runner.join();
+		ASSERT_TRUE(finished.load());
+		EXPECT_LT(seconds, 5) << "Env pool did not finish within 5 seconds!";
+
+		EXPECT_NEAR(d0->time, 50 * 0.001, 1e-9) << "env_0 should have stopped after its 50 steps!";
+		EXPECT_NEAR(d1->time, 120 * 0.001, 1e-9) << "env_1 should have stopped after its 120 steps!";
+	}
+
+	nh->deleteParam("realtime");
+	nh->deleteParam("env_0");
+	nh->deleteParam("env_1");
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+	mujoco_ros::LatencyHistogram hist;
+	EXPECT_EQ(hist.percentile(0.5), 0);
+
+	for (int i = 1; i <= 1000; ++i) {
+		hist.record(i * 1e-6);
+	}
+	EXPECT_EQ(hist.count(), 1000);
+	EXPECT_NEAR(hist.percentile(0.5), 500e-6, 500e-6 * 0.04);
+	EXPECT_NEAR(hist.percentile(0.9), 900e-6, 900e-6 * 0.04);
+	EXPECT_NEAR(hist.percentile(0.99), 990e-6, 990e-6 * 0.04);
+	EXPECT_NEAR(hist.max(), 1e-3, 1e-9);
+	EXPECT_LE(hist.percentile(1.0), hist.max());
+
+	hist.reset();
+	EXPECT_EQ(hist.count(), 0);
+	EXPECT_EQ(hist.percentile(0.99), 0);
+}
+
+TEST(PluginUtils, ComputeLoadDependencies)
+{
+	const auto make_plugin = [](const std::string &name, const std::vector<std::string> &deps) {
+		XmlRpc::XmlRpcValue config;
+		config["type"] = "mujoco_ros/TestPlugin";
+		config["name"] = name;
+		for (std::size_t i = 0; i < deps.size(); ++i) {
+			config["depends_on"][static_cast<int>(i)] = deps[i];
+		}
+		auto plugin = std::make_unique<TestPlugin>();
+		plugin->init(config, "~", nullptr);
+		return plugin;
+	};
+
+	std::vector<MujocoPluginPtr> plugins;
+	plugins.emplace_back(make_plugin("control", { "description" }));
+	plugins.emplace_back(make_plugin("description", {}));
+	plugins.emplace_back(make_plugin("sensors", {}));
+	plugins.emplace_back(make_plugin("logger", { "control", "sensors", "unknown" }));
+	plugins.emplace_back(make_plugin("cycle_a", { "cycle_b" }));
+	plugins.emplace_back(make_plugin("cycle_b", { "cycle_a" }));
+
+	const auto deps = mujoco_ros::plugin_utils::computeLoadDependencies(plugins);
+	ASSERT_EQ(deps.size(), plugins.size());
+	EXPECT_EQ(deps[0], std::vector<std::size_t>({ 1 }));
+	EXPECT_TRUE(deps[1].empty());
+	EXPECT_TRUE(deps[2].empty());
+	// unknown dependencies are ignored
+	EXPECT_EQ(deps[3], std::vector<std::size_t>({ 0, 2 }));
+	// cyclic dependencies are loaded last, one at a time
+	EXPECT_EQ(deps[4], std::vector<std::size_t>({ 0, 1, 2, 3 }));
+	EXPECT_EQ(deps[5], std::vector<std::size_t>({ 0, 1, 2, 3, 4 }));
+}
+
+// Test plugin that declares a fixed set of dofs as write set of its control callback
+class WriteSetPlugin : public TestPlugin
+{
+public:
+	explicit WriteSetPlugin(std::vector<int> dofs) : dofs_(std::move(dofs)) {}
+	bool getControlWriteSet(const mjModel * /*m*/, std::vector<int> & /*qpos*/, std::vector<int> &dofs,
+	                        std::vector<int> & /*actuators*/) const override
+	{
+		dofs = dofs_;
+		return true;
+	}
+
+private:
+	std::vector<int> dofs_;
+};
+
+TEST_F(BaseEnvFixture, PartitionControlCbsByWriteSet)
+{
+	nh->setParam("unpause", false);
+	nh->setParam("num_mj_threads", 2);
+	nh->setParam("parallel_control_cbs", true);
+	MujocoEnvTestWrapper env;
+	nh->deleteParam("num_mj_threads");
+	nh->deleteParam("parallel_control_cbs");
+	if (!env.hasThreadpool()) {
+		GTEST_SKIP() << "Parallel control callbacks require at least 3 cores";
+	}
+
+	env.load_filename(ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml");
+	env.startEventLoop();
+	float seconds = 0;
+	while (env.getOperationalStatus() != 0 && seconds < 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	ASSERT_LT(seconds, 2) << "Env loading ran into 2 seconds timeout!";
+
+	XmlRpc::XmlRpcValue config;
+	config["type"] = "mujoco_ros/TestPlugin";
+	WriteSetPlugin overlap_a({ 3, 4 });
+	WriteSetPlugin overlap_b({ 4, 5 });
+	WriteSetPlugin disjoint_a({ 0, 1, 2 });
+	WriteSetPlugin disjoint_b({ 6 });
+	std::vector<MujocoPlugin *> plugins = { &overlap_a, &disjoint_a, &overlap_b, &disjoint_b };
+	for (auto *plugin : plugins) {
+		plugin->init(config, "~", nullptr);
+	}
+
+	const auto loaded_plugins = env.getCBReadyPlugins();
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env.getMutexPtr());
+		env.setCBReadyPlugins(plugins);
+	}
+	EXPECT_EQ(env.getParallelControlPlugins(), std::vector<MujocoPlugin *>({ &disjoint_a, &disjoint_b }))
+	    << "Plugins with disjoint write sets should run in parallel!";
+	EXPECT_EQ(env.getSerialControlPlugins(), std::vector<MujocoPlugin *>({ &overlap_a, &overlap_b }))
+	    << "Both plugins of an overlapping pair should run serially!";
+
+	// Parallel and serial control callbacks all run once per step
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env.getMutexPtr());
+		mj_step(env.getModelPtr(), env.getDataPtr());
+	}
+	EXPECT_TRUE(overlap_a.ran_control_cb.load());
+	EXPECT_TRUE(overlap_b.ran_control_cb.load());
+	EXPECT_TRUE(disjoint_a.ran_control_cb.load());
+	EXPECT_TRUE(disjoint_b.ran_control_cb.load());
+
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env.getMutexPtr());
+		env.setCBReadyPlugins(loaded_plugins);
+	}
+	env.shutdown();
+}
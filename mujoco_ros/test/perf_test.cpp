@@ -0,0 +1,267 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Authors: David P. Leins */
+
+// Opt-in throughput regression tests (build with -DMUJOCO_ROS_PERF_TESTS=ON). Every test runs a fixed number of steps
+// through the same code path as the physics loop and fails if the throughput is more than `tolerance` percent below
+// the value stored in the baseline JSON.
+
+#include "mujoco_env_fixture.h"
+
+#include <mujoco_ros/sync_env.h>
+
+#include <sensor_msgs/Image.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Number of timed runs per test, the fastest one is compared against the baseline to reduce noise
+constexpr int kRepetitions = 3;
+
+std::map<std::string, double> baseline;
+std::map<std::string, double> measured;
+double tolerance = 20.;
+
+std::map<std::string, double> readBaseline(const std::string &path)
+{
+	std::map<std::string, double> values;
+	std::ifstream in(path);
+	if (!in.good()) {
+		ROS_WARN_STREAM("Could not open baseline file '" << path << "'");
+		return values;
+	}
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	const std::string content = buffer.str();
+
+	// The baseline is a flat object of "name": steps/s pairs
+	static const std::regex entry(R"rgx("([^"]+)"\s*:\s*([-+0-9.eE]+))rgx");
+	for (auto it = std::sregex_iterator(content.begin(), content.end(), entry); it != std::sregex_iterator(); ++it) {
+		values[(*it)[1].str()] = std::stod((*it)[2].str());
+	}
+	return values;
+}
+
+void writeMeasured(const std::string &path)
+{
+	std::ofstream out(path, std::ios::trunc);
+	out << "{\n";
+	for (auto it = measured.begin(); it != measured.end(); ++it) {
+		out << "  \"" << it->first << "\": " << static_cast<int64_t>(it->second)
+		    << (std::next(it) != measured.end() ? "," : "") << "\n";
+	}
+	out << "}\n";
+}
+
+class PerfEnvWrapper : public mujoco_ros::SyncEnv
+{
+public:
+	double stepsPerSecond(int num_steps)
+	{
+		const auto start = Clock::now();
+		step(num_steps);
+		const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		return elapsed > 0 ? num_steps / elapsed : 0;
+	}
+
+	int getNumCBReadyPlugins() { return cb_ready_plugins_.size(); }
+};
+
+class PerfFixture : public ::testing::Test
+{
+protected:
+	std::unique_ptr<ros::NodeHandle> nh;
+	std::unique_ptr<PerfEnvWrapper> env_ptr;
+
+	void SetUp() override
+	{
+		nh = std::make_unique<ros::NodeHandle>("~");
+		nh->setParam("unpause", false);
+		nh->setParam("no_x", true);
+		nh->setParam("render_offscreen", false);
+		nh->setParam("use_sim_time", true);
+		nh->deleteParam(mujoco_ros::plugin_utils::MUJOCO_PLUGIN_PARAM_NAME);
+	}
+
+	void TearDown() override
+	{
+		if (env_ptr) {
+			env_ptr->shutdown();
+			env_ptr.reset();
+		}
+		nh->deleteParam(mujoco_ros::plugin_utils::MUJOCO_PLUGIN_PARAM_NAME);
+	}
+
+	void loadEnv(const std::string &xml_path)
+	{
+		env_ptr = std::make_unique<PerfEnvWrapper>();
+		ASSERT_TRUE(env_ptr->load(xml_path, 10.)) << "Model '" << xml_path << "' was not loaded correctly!";
+	}
+
+	void runAndCompare(const std::string &name, int num_steps, int warmup_steps = 500)
+	{
+		env_ptr->stepsPerSecond(warmup_steps);
+		double best = 0;
+		for (int i = 0; i < kRepetitions; ++i) {
+			best = std::max(best, env_ptr->stepsPerSecond(num_steps));
+		}
+		measured[name] = best;
+
+		const auto it = baseline.find(name);
+		if (it == baseline.end() || it->second <= 0) {
+			ROS_WARN_STREAM("[" << name << "] " << best << " steps/s (no baseline)");
+			return;
+		}
+		const double threshold = it->second * (1. - tolerance / 100.);
+		ROS_INFO_STREAM("[" << name << "] " << best << " steps/s (baseline " << it->second << ", threshold "
+		                    << threshold << ")");
+		EXPECT_GE(best, threshold) << "Throughput of '" << name << "' dropped more than " << tolerance
+		                           << "% below the baseline (" << best << " < " << it->second << " steps/s)";
+	}
+};
+
+} // namespace
+
+TEST_F(PerfFixture, SteppingPendulum)
+{
+	loadEnv(ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml");
+	runAndCompare("stepping_pendulum", 20000);
+}
+
+TEST_F(PerfFixture, SteppingEquality)
+{
+	loadEnv(ros::package::getPath("mujoco_ros") + "/test/equality_world.xml");
+	runAndCompare("stepping_equality", 20000);
+}
+
+TEST_F(PerfFixture, Sensors)
+{
+	const std::string pkg_path = ros::package::getPath("mujoco_ros_sensors");
+	if (pkg_path.empty()) {
+		GTEST_SKIP() << "mujoco_ros_sensors is not available";
+	}
+
+	XmlRpc::XmlRpcValue plugins;
+	plugins[0]["type"] = "mujoco_ros_sensors/MujocoRosSensorsPlugin";
+	nh->setParam(mujoco_ros::plugin_utils::MUJOCO_PLUGIN_PARAM_NAME, plugins);
+
+	loadEnv(pkg_path + "/test/sensors_world.xml");
+	EXPECT_EQ(env_ptr->getNumCBReadyPlugins(), 1) << "Sensors plugin was not loaded";
+	runAndCompare("sensors", 20000);
+}
+
+TEST_F(PerfFixture, Laser)
+{
+	const std::string pkg_path = ros::package::getPath("mujoco_ros_laser");
+	if (pkg_path.empty()) {
+		GTEST_SKIP() << "mujoco_ros_laser is not available";
+	}
+
+	XmlRpc::XmlRpcValue sensor;
+	sensor["site_attached"]      = "laser_site";
+	sensor["frame_id"]           = "scan";
+	sensor["update_rate"]        = 1000.; // cast on every step
+	sensor["min_range"]          = 0.1;
+	sensor["max_range"]          = 30.;
+	sensor["range_resolution"]   = 0.01;
+	sensor["angular_resolution"] = 0.02;
+	sensor["min_angle"]          = -1.57;
+	sensor["max_angle"]          = 1.57;
+	XmlRpc::XmlRpcValue plugins;
+	plugins[0]["type"]       = "mujoco_ros_laser/LaserPlugin";
+	plugins[0]["sensors"][0] = sensor;
+	nh->setParam(mujoco_ros::plugin_utils::MUJOCO_PLUGIN_PARAM_NAME, plugins);
+
+	loadEnv(pkg_path + "/assets/laser_world.xml");
+	EXPECT_EQ(env_ptr->getNumCBReadyPlugins(), 1) << "Laser plugin was not loaded";
+	runAndCompare("laser", 5000);
+}
+
+TEST_F(PerfFixture, Cameras)
+{
+	if (std::getenv("DISPLAY") == nullptr) {
+		GTEST_SKIP() << "Offscreen rendering requires a display";
+	}
+	nh->setParam("no_x", false);
+	nh->setParam("render_offscreen", true);
+
+	loadEnv(ros::package::getPath("mujoco_ros") + "/test/camera_world.xml");
+
+	// Cameras only render if someone is subscribed
+	std::vector<ros::Subscriber> subs;
+	for (const auto &cam : env_ptr->cameraNames()) {
+		subs.emplace_back(nh->subscribe<sensor_msgs::Image>(env_ptr->getNamespace() + "/cameras/" + cam +
+		                                                        "/rgb/image_raw",
+		                                                    1, [](const sensor_msgs::ImageConstPtr &) {}));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+	runAndCompare("cameras", 2000, 100);
+}
+
+int main(int argc, char **argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+	ros::init(argc, argv, "mujoco_ros_perf_test");
+
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+	ros::NodeHandle nh("~");
+
+	std::string baseline_path, record_path;
+	nh.param<std::string>("baseline", baseline_path, ros::package::getPath("mujoco_ros") + "/test/perf_baseline.json");
+	nh.param<double>("tolerance", tolerance, 20.);
+	nh.param<std::string>("record", record_path, "");
+	baseline = readBaseline(baseline_path);
+
+	int ret = RUN_ALL_TESTS();
+
+	if (!record_path.empty()) {
+		writeMeasured(record_path);
+		ROS_INFO_STREAM("Wrote measured throughput to " << record_path);
+	}
+
+	spinner.stop();
+	ros::shutdown();
+	return ret;
+}
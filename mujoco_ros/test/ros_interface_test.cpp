@@ -43,8 +43,21 @@
 #include <mujoco_ros_msgs/SetPause.h>
 #include <mujoco_ros_msgs/SetBodyState.h>
 #include <mujoco_ros_msgs/GetBodyState.h>
+#include <mujoco_ros_msgs/SetBodyStates.h>
+#include <mujoco_ros_msgs/GetBodyStates.h>
 #include <mujoco_ros_msgs/SetGeomProperties.h>
+#include <mujoco_ros_msgs/SetGeomPropertiesArray.h>
+#include <mujoco_ros_msgs/SetEqualityConstraintsCompact.h>
+#include <mujoco_ros_msgs/GetEqualityConstraintIds.h>
 #include <mujoco_ros_msgs/GeomType.h>
+#include <mujoco_ros_msgs/SaveState.h>
+#include <mujoco_ros_msgs/RestoreState.h>
+#include <mujoco_ros_msgs/BodyStates.h>
+#include <mujoco_ros_msgs/StepProfile.h>
+#include <mujoco_ros_msgs/DumpTrace.h>
+#include <mujoco_ros_msgs/BatchReset.h>
+#include <mujoco_ros_msgs/BatchStep.h>
+#include <mujoco_ros_msgs/BatchObserve.h>
 
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/TwistStamped.h>
@@ -55,6 +68,10 @@
 #include <mujoco_ros/util.h>
 #include <ros/ros.h>
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
 int main(int argc, char **argv)
 {
 	testing::InitGoogleTest(&argc, argv);
@@ -447,6 +464,183 @@ TEST_F(BaseEnvFixture, CustomInitialJointStates)
 	nh->setParam("unpause", true);
 }
 
+TEST_F(BaseEnvFixture, BodyStatesPublisher)
+{
+	nh->setParam("unpause", false);
+	nh->setParam("body_state_publisher/rate", 100.0);
+
+	MujocoEnvTestWrapper env;
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	env.startWithXML(xml_path);
+	while (env.getOperationalStatus() > 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	std::mutex msg_mutex;
+	mujoco_ros_msgs::BodyStates last_msg;
+	int num_msgs        = 0;
+	ros::Subscriber sub = nh->subscribe<mujoco_ros_msgs::BodyStates>(
+	    env.getHandleNamespace() + "/body_states", 10, [&](const mujoco_ros_msgs::BodyStatesConstPtr &msg) {
+		    std::lock_guard<std::mutex> lk(msg_mutex);
+		    last_msg = *msg;
+		    num_msgs++;
+	    });
+	for (int i = 0; i < 100 && sub.getNumPublishers() == 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_GT(sub.getNumPublishers(), 0) << "Body states should be published!";
+
+	// 100 steps with a timestep of 0.001 yield 10 messages at 100 Hz (9 if rounding of time delays one)
+	EXPECT_TRUE(env.step(100)) << "Stepping failed!";
+	for (int i = 0; i < 100; ++i) {
+		{
+			std::lock_guard<std::mutex> lk(msg_mutex);
+			if (num_msgs >= 10) {
+				break;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(msg_mutex);
+		EXPECT_GE(num_msgs, 9) << "Unexpected number of body state messages!";
+		EXPECT_LE(num_msgs, 10) << "Unexpected number of body state messages!";
+		// Only free bodies are published by default
+		ASSERT_EQ(last_msg.states.size(), 1);
+		EXPECT_EQ(last_msg.states[0].name, "body_ball");
+		EXPECT_EQ(last_msg.states[0].pose.header.frame_id, "world");
+
+		mjData *d  = env.getDataPtr();
+		mjModel *m = env.getModelPtr();
+		int id     = mj_name2id(m, mjOBJ_BODY, "body_ball");
+		EXPECT_NEAR(last_msg.states[0].pose.pose.position.x, d->xpos[3 * id], 1e-3);
+		EXPECT_NEAR(last_msg.states[0].pose.pose.position.y, d->xpos[3 * id + 1], 1e-3);
+		// States are computed before integrating and stamped with the time they belong to
+		EXPECT_LE(last_msg.header.stamp.toSec(), d->time - m->opt.timestep + 1e-9);
+		EXPECT_EQ(last_msg.states[0].pose.header.stamp, last_msg.header.stamp);
+	}
+
+	env.shutdown();
+	nh->deleteParam("body_state_publisher/rate");
+	nh->setParam("unpause", true);
+}
+
+TEST_F(BaseEnvFixture, StepProfiler)
+{
+	nh->setParam("unpause", false);
+	nh->setParam("step_profiler/rate", 1000.0);
+
+	MujocoEnvTestWrapper env;
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	env.startWithXML(xml_path);
+	while (env.getOperationalStatus() > 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	std::mutex msg_mutex;
+	mujoco_ros_msgs::StepProfile last_msg;
+	int num_msgs        = 0;
+	ros::Subscriber sub = nh->subscribe<mujoco_ros_msgs::StepProfile>(
+	    env.getHandleNamespace() + "/step_profile", 10, [&](const mujoco_ros_msgs::StepProfileConstPtr &msg) {
+		    std::lock_guard<std::mutex> lk(msg_mutex);
+		    last_msg = *msg;
+		    num_msgs++;
+	    });
+	for (int i = 0; i < 100 && sub.getNumPublishers() == 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	ASSERT_GT(sub.getNumPublishers(), 0) << "Step profiles should be published!";
+
+	EXPECT_TRUE(env.step(1000)) << "Stepping failed!";
+	for (int i = 0; i < 100; ++i) {
+		{
+			std::lock_guard<std::mutex> lk(msg_mutex);
+			if (num_msgs > 0) {
+				break;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(msg_mutex);
+		ASSERT_GT(num_msgs, 0) << "No step profile received!";
+		EXPECT_GT(last_msg.steps, 0);
+		EXPECT_GT(last_msg.window_duration, 0);
+		ASSERT_EQ(last_msg.phases.size(), last_msg.mean.size());
+		ASSERT_EQ(last_msg.phases.size(), last_msg.max.size());
+		ASSERT_GE(last_msg.phases.size(), 2);
+		EXPECT_EQ(last_msg.phases[0], "step");
+		EXPECT_EQ(last_msg.phases[1], "mj_step");
+		EXPECT_GT(last_msg.mean[1], 0) << "mj_step should take some time!";
+		EXPECT_GE(last_msg.mean[0], last_msg.mean[1]) << "mj_step is part of the whole step!";
+		for (std::size_t i = 0; i < last_msg.phases.size(); ++i) {
+			EXPECT_GE(last_msg.max[i], last_msg.mean[i]) << "Max of " << last_msg.phases[i] << " below mean!";
+		}
+	}
+
+	env.shutdown();
+	nh->deleteParam("step_profiler/rate");
+	nh->setParam("unpause", true);
+}
+
+TEST_F(BaseEnvFixture, DumpTrace)
+{
+	nh->setParam("unpause", false);
+	nh->setParam("tracing/enabled", true);
+
+	MujocoEnvTestWrapper env;
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/pendulum_world.xml";
+	env.startWithXML(xml_path);
+	while (env.getOperationalStatus() > 0) { // wait for model to be loaded
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_TRUE(env.step(10)) << "Stepping failed!";
+
+	mujoco_ros_msgs::DumpTrace srv;
+	srv.request.path  = "/tmp/mujoco_ros_test_trace.json";
+	srv.request.clear = true;
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/dump_trace", srv)) << "Dump trace service call failed!";
+	EXPECT_TRUE(srv.response.success) << srv.response.status_message;
+	EXPECT_EQ(srv.response.path, srv.request.path);
+	EXPECT_GE(srv.response.num_events, 20) << "Each step should record at least physics_step and mj_step!";
+
+	std::ifstream file(srv.request.path);
+	std::stringstream content;
+	content << file.rdbuf();
+	EXPECT_EQ(content.str().rfind("{\"traceEvents\":[", 0), 0) << "Trace should be Chrome trace JSON!";
+	EXPECT_NE(content.str().find("\"name\":\"physics_step\""), std::string::npos);
+	EXPECT_NE(content.str().find("\"name\":\"mj_step\""), std::string::npos);
+	EXPECT_NE(content.str().find("\"args\":{\"name\":\"physics\"}"), std::string::npos)
+	    << "Physics thread should be named!";
+
+	// Events have been cleared
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/dump_trace", srv)) << "Dump trace service call failed!";
+	EXPECT_TRUE(srv.response.success) << srv.response.status_message;
+	EXPECT_LT(srv.response.num_events, 20) << "Events should have been cleared!";
+
+	// Buffers of exited threads are written once and released afterwards
+	std::thread([] { MUJOCO_ROS_TRACE_SCOPE("exited_thread", "test"); }).join();
+	const auto traceContains = [&](const std::string &str) {
+		std::ifstream trace(srv.request.path);
+		std::stringstream trace_content;
+		trace_content << trace.rdbuf();
+		return trace_content.str().find(str) != std::string::npos;
+	};
+	srv.request.clear = false;
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/dump_trace", srv)) << "Dump trace service call failed!";
+	EXPECT_TRUE(traceContains("\"name\":\"exited_thread\"")) << "Events of an exited thread should be written!";
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/dump_trace", srv)) << "Dump trace service call failed!";
+	EXPECT_FALSE(traceContains("\"name\":\"exited_thread\"")) << "Buffer of an exited thread should be released!";
+
+	env.shutdown();
+	mujoco_ros::tracing::configure(false);
+	std::remove(srv.request.path.c_str());
+	nh->deleteParam("tracing/enabled");
+	nh->setParam("unpause", true);
+}
+
 TEST_F(PendulumEnvFixture, CustomInitialJointStatesOnReset)
 {
 	std::map<std::string, std::string> pos_map, vel_map;
@@ -513,6 +707,90 @@ TEST_F(PendulumEnvFixture, CustomInitialJointStatesOnReset)
 	nh->deleteParam("initial_joint_velocities/joint_map");
 }
 
+TEST_F(PendulumEnvFixture, SaveAndRestoreStateCallbacks)
+{
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/save_state", true))
+	    << "Save state service should be available!";
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/restore_state", true))
+	    << "Restore state service should be available!";
+
+	mujoco_ros_msgs::RestoreState restore_srv;
+	restore_srv.request.slot = "unknown";
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/restore_state", restore_srv))
+	    << "restore state service call failed!";
+	EXPECT_FALSE(restore_srv.response.success) << "Restoring an unknown slot should fail!";
+
+	mujoco_ros_msgs::SaveState save_srv;
+	save_srv.request.slot = "start";
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/save_state", save_srv))
+	    << "save state service call failed!";
+	EXPECT_TRUE(save_srv.response.success) << "Saving state should succeed!";
+
+	EXPECT_TRUE(env_ptr->step(100)) << "Stepping failed!";
+	EXPECT_GT(env_ptr->getDataPtr()->time, 0) << "Time should have moved on!";
+
+	restore_srv.request.slot = "start";
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/restore_state", restore_srv))
+	    << "restore state service call failed!";
+	EXPECT_TRUE(restore_srv.response.success) << "Restoring a saved slot should succeed!";
+	EXPECT_NEAR(env_ptr->getDataPtr()->time, 0, 1e-6) << "Time should have been restored!";
+
+	// Not allowed without hash in eval mode
+	env_ptr->setEvalMode(true);
+	env_ptr->setAdminHash("right_hash");
+	restore_srv.request.admin_hash = "wrong_hash";
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/restore_state", restore_srv))
+	    << "restore state service call failed!";
+	EXPECT_FALSE(restore_srv.response.success) << "Restoring should not be allowed with a wrong hash!";
+	env_ptr->setEvalMode(false);
+}
+
+TEST_F(PendulumEnvFixture, BodyStatesBatch)
+{
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/set_body_states", true))
+	    << "Set body states service should be available!";
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/get_body_states", true))
+	    << "Get body states service should be available!";
+
+	mujoco_ros_msgs::SetBodyStates set_srv;
+	set_srv.request.set_pose = true;
+	set_srv.request.states.resize(2);
+	set_srv.request.states[0].name                    = "body_ball";
+	set_srv.request.states[0].pose.pose.position.x    = 0.5;
+	set_srv.request.states[0].pose.pose.position.y    = -0.5;
+	set_srv.request.states[0].pose.pose.position.z    = 1.0;
+	set_srv.request.states[0].pose.pose.orientation.w = 1.0;
+	set_srv.request.states[1].name                    = "unknown";
+
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_body_states", set_srv))
+	    << "set body states service call failed!";
+	EXPECT_FALSE(set_srv.response.success) << "Setting an unknown body should fail!";
+	ASSERT_EQ(set_srv.response.entry_success.size(), 2);
+	EXPECT_TRUE(set_srv.response.entry_success[0]);
+	EXPECT_FALSE(set_srv.response.entry_success[1]);
+
+	mujoco_ros_msgs::GetBodyStates get_srv;
+	get_srv.request.names = { "body_ball", "middle_link" };
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/get_body_states", get_srv))
+	    << "get body states service call failed!";
+	EXPECT_TRUE(get_srv.response.success);
+	ASSERT_EQ(get_srv.response.states.size(), 2);
+	EXPECT_EQ(get_srv.response.states[0].name, "body_ball");
+	EXPECT_NEAR(get_srv.response.states[0].pose.pose.position.x, 0.5, 1e-6);
+	EXPECT_NEAR(get_srv.response.states[0].pose.pose.position.y, -0.5, 1e-6);
+	EXPECT_NEAR(get_srv.response.states[0].pose.pose.position.z, 1.0, 1e-6);
+	EXPECT_EQ(get_srv.response.states[1].name, "middle_link");
+
+	// Not allowed without hash in eval mode
+	env_ptr->setEvalMode(true);
+	env_ptr->setAdminHash("right_hash");
+	set_srv.request.admin_hash = "wrong_hash";
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_body_states", set_srv))
+	    << "set body states service call failed!";
+	EXPECT_FALSE(set_srv.response.success) << "Setting should not be allowed with a wrong hash!";
+	env_ptr->setEvalMode(false);
+}
+
 TEST_F(PendulumEnvFixture, SetBodyStateNotAllowed)
 {
 	EXPECT_FALSE(env_ptr->settings_.run) << "Simulation should be paused!";
@@ -1159,6 +1437,85 @@ TEST_F(PendulumEnvFixture, SetGeomPropertiesSize)
 	EXPECT_NEAR(m->geom_size[ball_geom_id * 3 + 2], 0.01, 9e-4) << "Size 2 unchanged";
 }
 
+TEST_F(PendulumEnvFixture, SetGeomPropertiesArray)
+{
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/set_geom_properties_array", true))
+	    << "Set geom properties array service should be available!";
+
+	mjModel *m = env_ptr->getModelPtr();
+
+	int ball_geom_id = mj_name2id(m, mjOBJ_GEOM, "ball");
+	int ee_geom_id   = mj_name2id(m, mjOBJ_GEOM, "EE");
+	EXPECT_NE(ball_geom_id, -1) << "'ball' should be found as geom in model!";
+	EXPECT_NE(ee_geom_id, -1) << "'EE' should be found as geom in model!";
+
+	mujoco_ros_msgs::SetGeomPropertiesArray srv;
+	srv.request.set_size = true;
+	srv.request.properties.resize(3);
+	srv.request.properties[0].name   = "ball";
+	srv.request.properties[0].size_0 = 0.2f;
+	srv.request.properties[1].name   = "EE";
+	srv.request.properties[1].size_0 = 0.05f;
+	srv.request.properties[1].size_1 = 0.1f;
+	srv.request.properties[2].name   = "unknown";
+
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_geom_properties_array", srv))
+	    << "Set geom properties array service call failed!";
+	EXPECT_FALSE(srv.response.success) << "Setting an unknown geom should fail!";
+	ASSERT_EQ(srv.response.entry_success.size(), 3);
+	EXPECT_TRUE(srv.response.entry_success[0]);
+	EXPECT_TRUE(srv.response.entry_success[1]);
+	EXPECT_FALSE(srv.response.entry_success[2]);
+
+	// Bounding volumes follow the new sizes
+	EXPECT_NEAR(m->geom_size[ball_geom_id * 3], 0.2, 1e-6);
+	EXPECT_NEAR(m->geom_rbound[ball_geom_id], 0.2, 1e-6) << "Sphere rbound not recomputed";
+	EXPECT_NEAR(m->geom_aabb[ball_geom_id * 6 + 3], 0.2, 1e-6) << "Sphere AABB not recomputed";
+	EXPECT_NEAR(m->geom_rbound[ee_geom_id], 0.15, 1e-6) << "Capsule rbound not recomputed";
+	EXPECT_NEAR(m->geom_aabb[ee_geom_id * 6 + 5], 0.15, 1e-6) << "Capsule AABB not recomputed";
+}
+
+TEST_F(PendulumEnvFixture, SetGeomPropertiesArrayMass)
+{
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/set_geom_properties_array", true))
+	    << "Set geom properties array service should be available!";
+
+	mjModel *m = env_ptr->getModelPtr();
+
+	int ball_geom_id = mj_name2id(m, mjOBJ_GEOM, "ball");
+	int ball_body_id = mj_name2id(m, mjOBJ_BODY, "body_ball");
+	int ball_jnt_id  = mj_name2id(m, mjOBJ_JOINT, "ball_freejoint");
+	EXPECT_NE(ball_geom_id, -1) << "'ball' should be found as geom in model!";
+	EXPECT_NE(ball_body_id, -1) << "'body_ball' should be found as body in model!";
+	ASSERT_NE(ball_jnt_id, -1) << "'ball_freejoint' should be found as joint in model!";
+
+	const int dof            = m->jnt_dofadr[ball_jnt_id];
+	const mjtNum old_mass    = m->body_mass[ball_body_id];
+	const mjtNum inertia     = m->body_inertia[3 * ball_body_id];
+	const mjtNum world_mass  = m->body_subtreemass[0];
+	const mjtNum invweight0  = m->dof_invweight0[dof];
+	const mjtNum body_weight = m->body_invweight0[2 * ball_body_id];
+
+	mujoco_ros_msgs::SetGeomPropertiesArray srv;
+	srv.request.set_mass = true;
+	srv.request.properties.resize(1);
+	srv.request.properties[0].name      = "ball";
+	srv.request.properties[0].body_mass = 0.5f;
+
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_geom_properties_array", srv))
+	    << "Set geom properties array service call failed!";
+	EXPECT_TRUE(srv.response.success);
+
+	EXPECT_NEAR(m->body_mass[ball_body_id], 0.5, 1e-6) << "Mass unchanged";
+	EXPECT_NEAR(m->body_inertia[3 * ball_body_id], inertia * 0.5 / old_mass, 1e-9)
+	    << "Inertia should be scaled along with the mass!";
+	EXPECT_NEAR(m->body_subtreemass[0], world_mass + 0.5 - old_mass, 1e-6) << "Subtree mass of the world not updated";
+	// Constants derived from the mass have been recomputed
+	EXPECT_NEAR(m->dof_invweight0[dof], invweight0 * old_mass / 0.5, 1e-6 * invweight0)
+	    << "dof_invweight0 should follow the new mass!";
+	EXPECT_NE(m->body_invweight0[2 * ball_body_id], body_weight) << "body_invweight0 should be recomputed!";
+}
+
 TEST_F(PendulumEnvFixture, GetGeomPropertiesNotAllowed)
 {
 	EXPECT_FALSE(env_ptr->settings_.run) << "Simulation should be paused!";
@@ -1491,6 +1848,59 @@ TEST_F(EqualityEnvFixture, SetEqConstraintInvalidName)
 	EXPECT_FALSE(srv.response.success);
 }
 
+TEST_F(EqualityEnvFixture, SetEqConstraintsCompact)
+{
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/get_eq_constraint_ids", true))
+	    << "Get eq constraint ids service should be available!";
+	EXPECT_TRUE(ros::service::exists(env_ptr->getHandleNamespace() + "/set_eq_constraints_compact", true))
+	    << "Set eq constraints compact service should be available!";
+
+	mujoco_ros_msgs::GetEqualityConstraintIds ids_srv;
+	ids_srv.request.names = { "weld_eq", "connect_eq", "unknown_eqc" };
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/get_eq_constraint_ids", ids_srv))
+	    << "Get eq constraint ids service call failed!";
+	EXPECT_FALSE(ids_srv.response.success) << "Unknown constraint should not be found!";
+	ASSERT_EQ(ids_srv.response.ids.size(), 3);
+	EXPECT_EQ(ids_srv.response.ids[0], mj_name2id(m, mjOBJ_EQUALITY, "weld_eq"));
+	EXPECT_EQ(ids_srv.response.ids[1], mj_name2id(m, mjOBJ_EQUALITY, "connect_eq"));
+	EXPECT_EQ(ids_srv.response.ids[2], -1);
+
+	const int weld_id    = ids_srv.response.ids[0];
+	const int connect_id = ids_srv.response.ids[1];
+
+	mujoco_ros_msgs::SetEqualityConstraintsCompact srv;
+	srv.request.ids    = { weld_id, connect_id };
+	srv.request.active = { false, false };
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_eq_constraints_compact", srv))
+	    << "Set eq constraints compact service call failed!";
+	EXPECT_TRUE(srv.response.success);
+	EXPECT_FALSE(d->eq_active[weld_id]);
+	EXPECT_FALSE(d->eq_active[connect_id]);
+
+	srv.request.ids    = { weld_id };
+	srv.request.active = { true };
+	srv.request.data.assign(mjNEQDATA, 0.5);
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_eq_constraints_compact", srv))
+	    << "Set eq constraints compact service call failed!";
+	EXPECT_TRUE(srv.response.success);
+	EXPECT_TRUE(d->eq_active[weld_id]);
+	for (int i = 0; i < mjNEQDATA; ++i) {
+		EXPECT_EQ(m->eq_data[weld_id * mjNEQDATA + i], 0.5);
+	}
+
+	// Mismatching sizes and invalid ids are rejected
+	srv.request.data.resize(3);
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_eq_constraints_compact", srv))
+	    << "Set eq constraints compact service call failed!";
+	EXPECT_FALSE(srv.response.success);
+
+	srv.request.ids = { m->neq };
+	srv.request.data.clear();
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_eq_constraints_compact", srv))
+	    << "Set eq constraints compact service call failed!";
+	EXPECT_FALSE(srv.response.success);
+}
+
 TEST_F(EqualityEnvFixture, SetEqConstraintConnect)
 {
 	mujoco_ros_msgs::EqualityConstraintParameters connect_eqc;
@@ -2254,6 +2664,58 @@ TEST_F(PendulumEnvFixture, SetRTFactor_RoundDownClosest)
 	    << "Real-time factor should be clipped to the maximum boundary value!";
 }
 
+TEST_F(PendulumEnvFixture, SetRTFactor_Continuous)
+{
+	mujoco_ros_msgs::SetFloat srv;
+	srv.request.value = 0.37; // Not one of the viewer presets
+
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_rt_factor", srv))
+	    << "Set RT factor service call failed!";
+	EXPECT_TRUE(srv.response.success) << "Service call was not successful!";
+	EXPECT_FLOAT_EQ(env_ptr->settings_.rt_factor.load(), 0.37f) << "Real-time factor should not be rounded!";
+	EXPECT_FLOAT_EQ(env_ptr->percentRealTime[env_ptr->settings_.real_time_index], 40.0f)
+	    << "Viewer preset should be the closest available value!";
+
+	mujoco_ros_msgs::GetSimInfo sim_info_srv;
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/get_sim_info", sim_info_srv))
+	    << "Get sim info service call failed!";
+	EXPECT_FLOAT_EQ(sim_info_srv.response.state.rt_setting, 0.37f) << "RT setting should report the exact factor!";
+}
+
+TEST_F(PendulumEnvFixture, RealTimePacing)
+{
+	mujoco_ros_msgs::SetFloat srv;
+	srv.request.value = 1.0;
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/set_rt_factor", srv))
+	    << "Set RT factor service call failed!";
+
+	mjtNum start_time;
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env_ptr->getMutexPtr());
+		start_time = env_ptr->getDataPtr()->time;
+	}
+
+	const auto wall_start = std::chrono::steady_clock::now();
+	env_ptr->settings_.run = 1;
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	env_ptr->settings_.run = 0;
+	const double wall_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+	mjtNum sim_elapsed;
+	{
+		std::lock_guard<MujocoEnvMutex> lock(*env_ptr->getMutexPtr());
+		sim_elapsed = env_ptr->getDataPtr()->time - start_time;
+	}
+	// generous bound to be robust on loaded CI machines
+	EXPECT_NEAR(sim_elapsed, wall_elapsed, 0.05) << "Simulation should advance with wall time at 1x real-time!";
+
+	mujoco_ros_msgs::GetSimInfo sim_info_srv;
+	EXPECT_TRUE(ros::service::call(env_ptr->getHandleNamespace() + "/get_sim_info", sim_info_srv))
+	    << "Get sim info service call failed!";
+	EXPECT_GT(sim_info_srv.response.state.pacing_jitter.count, 0u) << "Paced steps should have been recorded!";
+	EXPECT_LE(sim_info_srv.response.state.pacing_jitter.p50, sim_info_srv.response.state.pacing_jitter.max);
+}
+
 TEST_F(PendulumEnvFixture, GetSimInfo_ModelPath)
 {
 	mujoco_ros_msgs::GetSimInfo srv;
@@ -2316,3 +2778,76 @@ TEST_F(PendulumEnvFixture, GetSimInfo_RTSettingChanges)
 	EXPECT_FLOAT_EQ(sim_info_srv.response.state.rt_setting, 1.5f)
 	    << "RT setting should change when RT factor is changed!";
 }
+
+TEST_F(BaseEnvFixture, BatchResetStepObserve)
+{
+	nh->setParam("unpause", false);
+	nh->setParam("batch/size", 3);
+	std::string xml_path = ros::package::getPath("mujoco_ros") + "/test/batch_world.xml";
+
+	MujocoEnvTestWrapper env;
+	env.startWithXML(xml_path);
+
+	float seconds = 0;
+	while (env.getOperationalStatus() != 0 && seconds < 2) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		seconds += 0.001;
+	}
+	ASSERT_LT(seconds, 2) << "Env loading ran into 2 seconds timeout!";
+
+	mujoco_ros_msgs::BatchObserve observe_srv;
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/batch/observe", observe_srv))
+	    << "Batch observe service call failed!";
+	const auto &obs = observe_srv.response.observation;
+	EXPECT_EQ(obs.num_envs, 3);
+	EXPECT_EQ(obs.nq, 1);
+	EXPECT_EQ(obs.nv, 1);
+	EXPECT_EQ(obs.nsensordata, 1);
+	ASSERT_EQ(obs.data.size(), 3 * 3);
+	ASSERT_EQ(obs.time.size(), 3);
+
+	// Wrong number of actions is rejected
+	mujoco_ros_msgs::BatchStep step_srv;
+	step_srv.request.actions   = { 1.0, 2.0 };
+	step_srv.request.num_steps = 10;
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/batch/step", step_srv))
+	    << "Batch step service call failed!";
+	EXPECT_FALSE(step_srv.response.success) << "Actions of the wrong size should be rejected!";
+
+	// Environments with different actions diverge, the main simulation is not stepped
+	const mjtNum main_time     = env.getDataPtr()->time;
+	step_srv.request.actions   = { -2.0, 0.0, 2.0 };
+	step_srv.request.num_steps = 100;
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/batch/step", step_srv))
+	    << "Batch step service call failed!";
+	EXPECT_TRUE(step_srv.response.success) << step_srv.response.status_message;
+	const auto &stepped = step_srv.response.observation;
+	ASSERT_EQ(stepped.data.size(), 3 * 3);
+	for (std::size_t i = 0; i < 3; ++i) {
+		EXPECT_NEAR(stepped.time[i], 0.1, 1e-9);
+	}
+	EXPECT_LT(stepped.data[0], 0) << "Negative torque should rotate env 0 backwards";
+	EXPECT_NEAR(stepped.data[3], 0, 1e-9) << "Env 1 should not move without torque";
+	EXPECT_GT(stepped.data[6], 0) << "Positive torque should rotate env 2 forwards";
+	EXPECT_NEAR(stepped.data[6], -stepped.data[0], 1e-9) << "Envs 0 and 2 should be mirrored";
+	EXPECT_LT(stepped.data[2], 0) << "Joint position sensor should follow qpos";
+	EXPECT_EQ(env.getDataPtr()->time, main_time) << "Main simulation should not be stepped";
+
+	// Reset a single environment
+	mujoco_ros_msgs::BatchReset reset_srv;
+	reset_srv.request.env_ids = { 2 };
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/batch/reset", reset_srv))
+	    << "Batch reset service call failed!";
+	EXPECT_TRUE(reset_srv.response.success) << reset_srv.response.status_message;
+	EXPECT_NEAR(reset_srv.response.observation.time[2], 0, 1e-9);
+	EXPECT_NEAR(reset_srv.response.observation.data[6], 0, 1e-9);
+	EXPECT_NEAR(reset_srv.response.observation.data[0], stepped.data[0], 1e-9) << "Env 0 should not be reset";
+
+	reset_srv.request.env_ids = { 3 };
+	EXPECT_TRUE(ros::service::call(env.getHandleNamespace() + "/batch/reset", reset_srv))
+	    << "Batch reset service call failed!";
+	EXPECT_FALSE(reset_srv.response.success) << "Out of range ids should be rejected!";
+
+	env.shutdown();
+	nh->deleteParam("batch");
+}
@@ -39,10 +39,14 @@
 #include <mujoco_ros/common_types.h>
 using namespace mujoco_ros;
 
-void load_queued_model(MujocoEnv &env)
+void load_queued_model(MujocoEnv &env, const std::string &model = std::string())
 {
-	env.settings_.load_request = 2;
-	float seconds              = 0;
+	if (model.empty()) {
+		env.settings_.load_request = 2;
+	} else {
+		env.queueModel(model);
+	}
+	float seconds = 0;
 	while (env.getOperationalStatus() != 0 && seconds < 2) { // wait for model to be loaded or timeout
 		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		seconds += 0.001;
@@ -70,6 +70,8 @@ public:
 
 	void eStopActive(const bool Active) override;
 
+	bool getWriteSet(std::vector<int> &qpos, std::vector<int> &dofs, std::vector<int> &actuators) const override;
+
 protected:
 	// Methods used to control a joint.
 	enum ControlMethod
@@ -78,11 +80,25 @@ protected:
 		POSITION,
 		POSITION_PID,
 		VELOCITY,
-		VELOCITY_PID
+		VELOCITY_PID,
+		// Commands are forwarded to an MJCF actuator via mjData::ctrl
+		EFFORT_ACTUATOR,
+		POSITION_ACTUATOR,
+		VELOCITY_ACTUATOR
 	};
 
 	void getJointData(const int &joint_id, double &position, double &velocity, double &effort);
 
+	/**
+	 * Find the MJCF actuator that should receive the commands for the given joint. An explicit mapping in
+	 * `<robot_namespace>/mujoco_ros_control/actuators/<joint_name>` takes precedence. Otherwise, if
+	 * `<robot_namespace>/mujoco_ros_control/use_actuators` is true, the actuator transmitting to the joint that matches
+	 * the control method best is chosen. actuator_id is set to -1 if the joint should not be controlled through an
+	 * actuator. Returns false if the configuration is invalid.
+	 */
+	bool findActuator(const std::string &robot_namespace, const std::string &joint_name, const int joint_id,
+	                  const ControlMethod ctrl_method, int &actuator_id) const;
+
 	/**
 	 * Register the limits of the joint specified by joint_name and joint_handle. The limits are
 	 * retrieved from joint_limit_nh. If urdf_model is not NULL, limits are retrieved from it also.
@@ -124,6 +140,7 @@ protected:
 	std::vector<double> joint_velocity_command_;
 
 	std::vector<uint> mujoco_joint_ids_;
+	std::vector<int> mujoco_actuator_ids_;
 
 	bool e_stop_active_, last_e_stop_active_;
 };
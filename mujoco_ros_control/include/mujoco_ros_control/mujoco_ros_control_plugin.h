@@ -78,11 +78,30 @@ public:
 
 	void controlCallback(const mjModel *model, mjData *data) override;
 
+	bool getControlWriteSet(const mjModel *m, std::vector<int> &qpos, std::vector<int> &dofs,
+	                        std::vector<int> &actuators) const override;
+
 protected:
 	void eStopCB(const std_msgs::BoolConstPtr &e_stop_active);
 
-	// Interface loader
-	std::unique_ptr<pluginlib::ClassLoader<mujoco_ros::control::RobotHWSim>> robot_hw_sim_loader_;
+	// Parse additional controller groups with their own update rate from the 'hardware' rosparam
+	bool parseControllerGroups(const mjModel *m);
+
+	// A controller manager running at its own rate. All groups share the same robot hw sim instance.
+	struct ControllerGroup
+	{
+		std::string name;
+		ros::Duration control_period;
+		ros::Time last_update_sim_time_ros;
+		bool reset_pending = false;
+		std::unique_ptr<controller_manager::ControllerManager> controller_manager;
+	};
+
+	// Interface loader, shared by all instances and kept alive across reloads
+	std::shared_ptr<pluginlib::ClassLoader<mujoco_ros::control::RobotHWSim>> robot_hw_sim_loader_;
+
+	// Parsed URDF, shared with the description cache
+	std::shared_ptr<const urdf::Model> urdf_model_;
 
 	std::string robot_description_;
 	std::string robot_namespace_;
@@ -93,12 +112,12 @@ protected:
 	std::string robot_hw_sim_type_str_;
 	std::unique_ptr<mujoco_ros::control::RobotHWSim> robot_hw_sim_;
 
-	// Controller manager
-	std::unique_ptr<controller_manager::ControllerManager> controller_manager_;
+	// Controller managers, the first entry is the default group in the robot namespace
+	std::vector<ControllerGroup> controller_groups_;
 
 	// Timing
 	ros::Duration control_period_;
-	ros::Time last_update_sim_time_ros_;
+	ros::Time last_read_sim_time_ros_;
 	ros::Time last_write_sim_time_ros_;
 
 	bool e_stop_active_, last_e_stop_active_;
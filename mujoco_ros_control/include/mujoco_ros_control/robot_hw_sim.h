@@ -110,6 +110,23 @@ public:
 	 */
 	virtual void eStopActive(const bool active) {}
 
+	/**
+	 * @brief Get the parts of mjData written to in writeSim
+	 *
+	 *  Used to decide whether control callbacks of multiple robots can run in parallel. The default implementation
+	 *  reports an unknown write set.
+	 *
+	 * @param qpos qpos addresses written to.
+	 * @param dofs dof ids written to (qvel, qfrc_applied).
+	 * @param actuators actuator ids written to (ctrl).
+	 * @return \c true if the write set is complete, \c false if unknown.
+	 */
+	virtual bool getWriteSet(std::vector<int> & /*qpos*/, std::vector<int> & /*dofs*/,
+	                         std::vector<int> & /*actuators*/) const
+	{
+		return false;
+	}
+
 protected:
 	const mjModel *m_ptr_;
 	mjData *d_ptr_;
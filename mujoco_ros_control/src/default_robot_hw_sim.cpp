@@ -44,6 +44,12 @@ double clamp(const double val, const double min_val, const double max_val)
 {
 	return std::min(std::max(val, min_val), max_val);
 }
+
+std::string actuatorName(const mjModel *m, const int id)
+{
+	const char *name = mj_id2name(m, mjOBJ_ACTUATOR, id);
+	return name != nullptr ? std::string(name) : "#" + std::to_string(id);
+}
 } // namespace
 
 namespace mujoco_ros::control {
@@ -77,6 +83,7 @@ bool DefaultRobotHWSim::initSim(const mjModel *m_ptr, mjData *d_ptr, MujocoEnv *
 	joint_velocity_command_.resize(n_dof_);
 
 	mujoco_joint_ids_.resize(n_dof_);
+	mujoco_actuator_ids_.assign(n_dof_, -1);
 
 	ROS_DEBUG_STREAM_NAMED("default_robot_hw_sim", "Got " << n_dof_ << " transmissions to process ...");
 
@@ -191,7 +198,31 @@ bool DefaultRobotHWSim::initSim(const mjModel *m_ptr, mjData *d_ptr, MujocoEnv *
 
 		registerJointLimits(joint_names_[j], joint_handle, joint_control_methods_[j], joint_limit_nh, urdf_model,
 		                    &joint_types_[j], &joint_lower_limits_[j], &joint_upper_limits_[j], &joint_effort_limits_[j]);
-		if (joint_control_methods_[j] != EFFORT) {
+
+		if (!findActuator(robot_namespace, joint_names_[j], joint_id, joint_control_methods_[j],
+		                  mujoco_actuator_ids_[j])) {
+			return false;
+		}
+
+		if (mujoco_actuator_ids_[j] >= 0) {
+			// MuJoCo runs the actuator dynamics (e.g. position/velocity servos) in every step, no PID needed
+			switch (joint_control_methods_[j]) {
+				case EFFORT:
+					joint_control_methods_[j] = EFFORT_ACTUATOR;
+					break;
+				case POSITION:
+					joint_control_methods_[j] = POSITION_ACTUATOR;
+					break;
+				case VELOCITY:
+					joint_control_methods_[j] = VELOCITY_ACTUATOR;
+					break;
+				default:
+					break;
+			}
+			ROS_DEBUG_STREAM_NAMED("default_robot_hw_sim",
+			                       "Joint " << joint_names_[j] << " is controlled through actuator '"
+			                                << actuatorName(m_ptr_, mujoco_actuator_ids_[j]) << "'");
+		} else if (joint_control_methods_[j] != EFFORT) {
 			// Initialize the PID controller
 			const ros::NodeHandle nh(robot_namespace + "/mujoco_ros_control/pid_gains/" + joint_names_[j]);
 			if (pid_controllers_[j].init(nh)) {
@@ -240,6 +271,10 @@ void DefaultRobotHWSim::readSim(ros::Time time, ros::Duration period)
 		} else {
 			joint_position_[j] += angles::shortest_angular_distance(joint_position_[j], position);
 		}
+		if (mujoco_actuator_ids_[j] >= 0) {
+			// Commands do not end up in qfrc_applied, report the force generated by the actuators instead
+			effort = d_ptr_->qfrc_actuator[m_ptr_->jnt_dofadr[mujoco_joint_ids_[j]]];
+		}
 		joint_velocity_[j] = velocity;
 		joint_effort_[j]   = effort;
 	}
@@ -275,7 +310,7 @@ void DefaultRobotHWSim::writeSim(ros::Time time, ros::Duration period)
 			}
 
 			case POSITION: {
-				d_ptr_->qpos[m_ptr_->jnt_dofadr[mujoco_joint_ids_[j]]]         = joint_position_command_[j];
+				d_ptr_->qpos[m_ptr_->jnt_qposadr[mujoco_joint_ids_[j]]]        = joint_position_command_[j];
 				d_ptr_->qvel[m_ptr_->jnt_dofadr[mujoco_joint_ids_[j]]]         = 0.;
 				d_ptr_->qfrc_applied[m_ptr_->jnt_dofadr[mujoco_joint_ids_[j]]] = 0.;
 				break;
@@ -321,6 +356,22 @@ void DefaultRobotHWSim::writeSim(ros::Time time, ros::Duration period)
 				d_ptr_->qfrc_applied[m_ptr_->jnt_dofadr[mujoco_joint_ids_[j]]] = effort;
 				break;
 			}
+
+			case EFFORT_ACTUATOR: {
+				d_ptr_->ctrl[mujoco_actuator_ids_[j]] = e_stop_active_ ? 0. : joint_effort_command_[j];
+				break;
+			}
+
+			case POSITION_ACTUATOR: {
+				// On E-stop the position command has already been replaced by the last commanded position
+				d_ptr_->ctrl[mujoco_actuator_ids_[j]] = joint_position_command_[j];
+				break;
+			}
+
+			case VELOCITY_ACTUATOR: {
+				d_ptr_->ctrl[mujoco_actuator_ids_[j]] = e_stop_active_ ? 0. : joint_velocity_command_[j];
+				break;
+			}
 		}
 	}
 }
@@ -330,6 +381,42 @@ void DefaultRobotHWSim::eStopActive(const bool active)
 	e_stop_active_ = active;
 }
 
+bool DefaultRobotHWSim::getWriteSet(std::vector<int> &qpos, std::vector<int> &dofs, std::vector<int> &actuators) const
+{
+	for (unsigned int j = 0; j < n_dof_; j++) {
+		if (mujoco_joint_ids_[j] == -1)
+			continue;
+
+		if (mujoco_actuator_ids_[j] >= 0) {
+			actuators.emplace_back(mujoco_actuator_ids_[j]);
+			continue;
+		}
+
+		const int joint_id = static_cast<int>(mujoco_joint_ids_[j]);
+		int num_qpos       = 1;
+		int num_dofs       = 1;
+		switch (m_ptr_->jnt_type[joint_id]) {
+			case mjJNT_FREE:
+				num_qpos = 7;
+				num_dofs = 6;
+				break;
+			case mjJNT_BALL:
+				num_qpos = 4;
+				num_dofs = 3;
+				break;
+			default:
+				break;
+		}
+		for (int i = 0; i < num_qpos; i++) {
+			qpos.emplace_back(m_ptr_->jnt_qposadr[joint_id] + i);
+		}
+		for (int i = 0; i < num_dofs; i++) {
+			dofs.emplace_back(m_ptr_->jnt_dofadr[joint_id] + i);
+		}
+	}
+	return true;
+}
+
 void DefaultRobotHWSim::getJointData(const int &joint_id, double &position, double &velocity, double &effort)
 {
 	position = d_ptr_->qpos[m_ptr_->jnt_qposadr[joint_id]];
@@ -337,6 +424,83 @@ void DefaultRobotHWSim::getJointData(const int &joint_id, double &position, doub
 	effort   = d_ptr_->qfrc_applied[m_ptr_->jnt_dofadr[joint_id]];
 }
 
+bool DefaultRobotHWSim::findActuator(const std::string &robot_namespace, const std::string &joint_name,
+                                     const int joint_id, const ControlMethod ctrl_method, int &actuator_id) const
+{
+	actuator_id = -1;
+	const ros::NodeHandle nh(robot_namespace + "/mujoco_ros_control");
+
+	const auto transmits_to_joint = [&](const int id) {
+		return (m_ptr_->actuator_trntype[id] == mjTRN_JOINT || m_ptr_->actuator_trntype[id] == mjTRN_JOINTINPARENT) &&
+		       m_ptr_->actuator_trnid[2 * id] == joint_id;
+	};
+
+	std::string actuator_name;
+	if (nh.getParam("actuators/" + joint_name, actuator_name)) {
+		actuator_id = mj_name2id(m_ptr_, mjOBJ_ACTUATOR, actuator_name.c_str());
+		if (actuator_id < 0) {
+			ROS_ERROR_STREAM_NAMED("default_robot_hw_sim", "Actuator '" << actuator_name << "' configured for joint '"
+			                                                            << joint_name
+			                                                            << "' is not in the mujoco model!");
+			return false;
+		}
+		if (!transmits_to_joint(actuator_id)) {
+			ROS_WARN_STREAM_NAMED("default_robot_hw_sim", "Actuator '" << actuator_name
+			                                                           << "' does not transmit directly to joint '"
+			                                                           << joint_name << "'. Using it nonetheless.");
+		}
+		return true;
+	}
+
+	bool use_actuators = false;
+	nh.param("use_actuators", use_actuators, false);
+	if (!use_actuators) {
+		return true;
+	}
+
+	// Position servos have an affine bias with a non-zero position gain, velocity servos only a velocity gain, and
+	// plain motors no bias at all.
+	const auto matches_control_method = [&](const int id) {
+		const mjtNum *biasprm = m_ptr_->actuator_biasprm + id * mjNBIAS;
+		const bool affine     = m_ptr_->actuator_biastype[id] == mjBIAS_AFFINE;
+		switch (ctrl_method) {
+			case POSITION:
+				return affine && biasprm[1] != 0;
+			case VELOCITY:
+				return affine && biasprm[1] == 0 && biasprm[2] != 0;
+			case EFFORT:
+				return m_ptr_->actuator_biastype[id] == mjBIAS_NONE;
+			default:
+				return false;
+		}
+	};
+
+	for (int id = 0; id < m_ptr_->nu; id++) {
+		if (!transmits_to_joint(id)) {
+			continue;
+		}
+		if (matches_control_method(id)) {
+			actuator_id = id;
+			return true;
+		}
+		if (actuator_id < 0) {
+			actuator_id = id;
+		}
+	}
+
+	if (actuator_id >= 0) {
+		ROS_WARN_STREAM_NAMED("default_robot_hw_sim", "None of the actuators of joint '"
+		                                                  << joint_name << "' match its hardware interface. Using '"
+		                                                  << actuatorName(m_ptr_, actuator_id)
+		                                                  << "' nonetheless.");
+	} else {
+		ROS_WARN_STREAM_NAMED("default_robot_hw_sim", "No actuator found for joint '"
+		                                                  << joint_name
+		                                                  << "'. Falling back to direct control of the joint.");
+	}
+	return true;
+}
+
 void DefaultRobotHWSim::registerJointLimits(const std::string &joint_name,
                                             const hardware_interface::JointHandle &joint_handle,
                                             const ControlMethod ctrl_method, const ros::NodeHandle &joint_limit_nh,
@@ -43,12 +43,69 @@
 #include <boost/bind/bind.hpp>
 #include <urdf/model.h>
 #include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
 #include <thread>
 
 // clang-tidy complains about ROS_LOG in the pluginlib macros
 // NOLINTBEGIN(clang-analyzer-optin.cplusplus.VirtualCall)
 namespace mujoco_ros::control {
 
+namespace {
+// Parsing results of a robot description, cached across model reloads
+struct ParsedRobotDescription
+{
+	std::string urdf_string;
+	std::shared_ptr<const urdf::Model> urdf_model; // nullptr if the URDF could not be parsed
+	std::vector<transmission_interface::TransmissionInfo> transmissions;
+};
+
+// Every entry holds a full URDF, hence only the most recently used descriptions are kept
+constexpr std::size_t kMaxCachedDescriptions = 4;
+
+std::mutex description_cache_mutex;
+// most recently used first
+std::list<std::pair<size_t, std::shared_ptr<const ParsedRobotDescription>>> description_cache;
+
+std::shared_ptr<const ParsedRobotDescription> findCachedDescription(size_t hash, const std::string &urdf_string)
+{
+	std::lock_guard<std::mutex> lock(description_cache_mutex);
+	for (auto it = description_cache.begin(); it != description_cache.end(); ++it) {
+		if (it->first == hash && it->second->urdf_string == urdf_string) {
+			description_cache.splice(description_cache.begin(), description_cache, it);
+			return description_cache.front().second;
+		}
+	}
+	return nullptr;
+}
+
+void cacheDescription(size_t hash, std::shared_ptr<const ParsedRobotDescription> description)
+{
+	std::lock_guard<std::mutex> lock(description_cache_mutex);
+	description_cache.remove_if([&](const auto &entry) { return entry.first == hash; });
+	description_cache.emplace_front(hash, std::move(description));
+	if (description_cache.size() > kMaxCachedDescriptions) {
+		description_cache.pop_back();
+	}
+}
+
+// Plugin instances keep a reference to the loader. The static reference and the description cache are released when
+// this library is unloaded, which pluginlib only does after all plugin instances have been destroyed.
+std::shared_ptr<pluginlib::ClassLoader<RobotHWSim>> getRobotHWSimLoader()
+{
+	static std::mutex loader_mutex;
+	static std::shared_ptr<pluginlib::ClassLoader<RobotHWSim>> loader;
+
+	std::lock_guard<std::mutex> lock(loader_mutex);
+	if (loader == nullptr) {
+		loader =
+		    std::make_shared<pluginlib::ClassLoader<RobotHWSim>>("mujoco_ros_control", "mujoco_ros::control::RobotHWSim");
+	}
+	return loader;
+}
+} // namespace
+
 MujocoRosControlPlugin::~MujocoRosControlPlugin() = default;
 
 bool MujocoRosControlPlugin::load(const mjModel *m, mjData *d)
@@ -117,21 +174,39 @@ bool MujocoRosControlPlugin::load(const mjModel *m, mjData *d)
 		e_stop_sub_                    = robot_nh_.subscribe(e_stop_topic, 1, &MujocoRosControlPlugin::eStopCB, this);
 	}
 
-	std::string urdf_string = getURDF(robot_description_);
-	if (!parseTransmissionsFromURDF(urdf_string)) {
-		ROS_ERROR_NAMED("mujoco_ros_control",
-		                "Error parsing URDF for transmissions in mujoco_ros_control plugin, plugin not active.");
-		return false;
+	const std::string urdf_string = getURDF(robot_description_);
+	const size_t description_hash = std::hash<std::string>{}(urdf_string);
+
+	std::shared_ptr<const ParsedRobotDescription> parsed_description =
+	    findCachedDescription(description_hash, urdf_string);
+	if (parsed_description != nullptr) {
+		ROS_DEBUG_NAMED("mujoco_ros_control", "Using cached URDF and transmissions");
+		transmissions_ = parsed_description->transmissions;
+	} else {
+		if (!parseTransmissionsFromURDF(urdf_string)) {
+			ROS_ERROR_NAMED("mujoco_ros_control",
+			                "Error parsing URDF for transmissions in mujoco_ros_control plugin, plugin not active.");
+			return false;
+		}
+
+		auto description         = std::make_shared<ParsedRobotDescription>();
+		description->urdf_string = urdf_string;
+		auto urdf_model          = std::make_shared<urdf::Model>();
+		if (urdf_model->initString(urdf_string)) {
+			description->urdf_model = urdf_model;
+		}
+		description->transmissions = transmissions_;
+		parsed_description         = description;
+		cacheDescription(description_hash, parsed_description);
 	}
+	urdf_model_ = parsed_description->urdf_model;
 
 	try {
-		robot_hw_sim_loader_ = std::make_unique<pluginlib::ClassLoader<mujoco_ros::control::RobotHWSim>>(
-		    "mujoco_ros_control", "mujoco_ros::control::RobotHWSim");
+		robot_hw_sim_loader_ = getRobotHWSimLoader();
 
 		robot_hw_sim_ = std::unique_ptr<mujoco_ros::control::RobotHWSim>(
 		    robot_hw_sim_loader_->createUnmanagedInstance(robot_hw_sim_type_str_));
-		urdf::Model urdf_model;
-		const urdf::Model *const urdf_model_ptr = urdf_model.initString(urdf_string) ? &urdf_model : nullptr;
+		const urdf::Model *const urdf_model_ptr = urdf_model_.get();
 
 		ROS_DEBUG_STREAM_NAMED("mujoco_ros_control",
 		                       "Trying to initialize robot hw sim of type '" << robot_hw_sim_type_str_ << "'");
@@ -141,7 +216,15 @@ bool MujocoRosControlPlugin::load(const mjModel *m, mjData *d)
 		}
 
 		ROS_DEBUG_STREAM_NAMED("mujoco_ros_control", "Loading controller manager");
-		controller_manager_ = std::make_unique<controller_manager::ControllerManager>(robot_hw_sim_.get(), robot_nh_);
+		controller_groups_.clear();
+		controller_groups_.emplace_back();
+		controller_groups_.front().control_period = control_period_;
+		controller_groups_.front().controller_manager =
+		    std::make_unique<controller_manager::ControllerManager>(robot_hw_sim_.get(), robot_nh_);
+
+		if (!parseControllerGroups(m)) {
+			return false;
+		}
 	} catch (pluginlib::LibraryLoadException &ex) {
 		ROS_FATAL_STREAM_NAMED("mujoco_ros_control", "Failed to create robot simulation interface loader: " << ex.what());
 		return false;
@@ -153,47 +236,121 @@ bool MujocoRosControlPlugin::load(const mjModel *m, mjData *d)
 
 void MujocoRosControlPlugin::controlCallback(const mjModel * /*model*/, mjData *data)
 {
-	ros::Time sim_time_ros = ros::Time::now();
+	// Scheduling is based on simulation time only, querying ROS time is not necessary
+	const ros::Time sim_time_ros(data->time);
 
-	ROS_WARN_STREAM_COND_NAMED(sim_time_ros < ros::Time(data->time), "mujoco_ros_control",
-	                           "ROS time not in sync with mjData! (" << sim_time_ros << " < " << ros::Time(data->time)
-	                                                                 << ")");
-	if (sim_time_ros < last_update_sim_time_ros_) {
+	if (sim_time_ros < last_read_sim_time_ros_) {
 		ROS_INFO_NAMED("mujoco_ros_control", "Resetting mujoco_ros_control due to time reset");
 		ROS_DEBUG_STREAM_NAMED("mujoco_ros_control",
-		                       "sim time is " << sim_time_ros << " while last time was " << last_update_sim_time_ros_);
-		last_update_sim_time_ros_ = sim_time_ros;
-		last_write_sim_time_ros_  = sim_time_ros;
-		ROS_WARN_STREAM_COND_NAMED(sim_time_ros < ros::Time::now(), "mujoco_ros_control",
-		                           "Current time moved forward within control update! " << sim_time_ros << " -> "
-		                                                                                << ros::Time::now());
+		                       "sim time is " << sim_time_ros << " while last time was " << last_read_sim_time_ros_);
+		last_read_sim_time_ros_  = sim_time_ros;
+		last_write_sim_time_ros_ = sim_time_ros;
+		for (auto &group : controller_groups_) {
+			group.last_update_sim_time_ros = sim_time_ros;
+		}
 	}
 
-	ros::Duration sim_period = sim_time_ros - last_update_sim_time_ros_;
-	bool reset_ctrls         = last_update_sim_time_ros_.isZero();
-
 	robot_hw_sim_->eStopActive(e_stop_active_);
 
-	if (sim_period >= control_period_ || (reset_ctrls && !sim_period.isZero())) {
-		last_update_sim_time_ros_ = sim_time_ros;
-		robot_hw_sim_->readSim(sim_time_ros, sim_period);
-
-		if (e_stop_active_) {
-			last_e_stop_active_ = true;
-		} else if (last_e_stop_active_) {
-			reset_ctrls         = true;
-			last_e_stop_active_ = false;
+	if (e_stop_active_) {
+		last_e_stop_active_ = true;
+	} else if (last_e_stop_active_) {
+		// Controllers should be reset once the E-stop has been released
+		for (auto &group : controller_groups_) {
+			group.reset_pending = true;
 		}
+		last_e_stop_active_ = false;
+	}
 
-		controller_manager_->update(sim_time_ros, sim_period, reset_ctrls);
+	bool state_read = false;
+	for (auto &group : controller_groups_) {
+		const ros::Duration sim_period = sim_time_ros - group.last_update_sim_time_ros;
+		const bool initial_update      = group.last_update_sim_time_ros.isZero();
+
+		if (sim_period >= group.control_period || (initial_update && !sim_period.isZero())) {
+			// Read the state only once per step, even if multiple groups are due
+			if (!state_read) {
+				robot_hw_sim_->readSim(sim_time_ros, sim_time_ros - last_read_sim_time_ros_);
+				last_read_sim_time_ros_ = sim_time_ros;
+				state_read              = true;
+			}
+
+			group.last_update_sim_time_ros = sim_time_ros;
+			group.controller_manager->update(sim_time_ros, sim_period, initial_update || group.reset_pending);
+			group.reset_pending = false;
+		}
 	}
 
-	if (!last_update_sim_time_ros_.isZero() && (sim_time_ros > last_write_sim_time_ros_)) {
+	if (!last_read_sim_time_ros_.isZero() && (sim_time_ros > last_write_sim_time_ros_)) {
 		robot_hw_sim_->writeSim(sim_time_ros, sim_time_ros - last_write_sim_time_ros_);
 		last_write_sim_time_ros_ = sim_time_ros;
 	}
 }
 
+bool MujocoRosControlPlugin::getControlWriteSet(const mjModel * /*m*/, std::vector<int> &qpos, std::vector<int> &dofs,
+                                                std::vector<int> &actuators) const
+{
+	// Controller managers and hardware interfaces are not shared between plugin instances, hence only the hardware
+	// interface's access to mjData matters
+	if (robot_hw_sim_ == nullptr) {
+		return false;
+	}
+	return robot_hw_sim_->getWriteSet(qpos, dofs, actuators);
+}
+
+bool MujocoRosControlPlugin::parseControllerGroups(const mjModel *m)
+{
+	if (!rosparam_config_["hardware"].hasMember("controller_groups")) {
+		return true;
+	}
+
+	XmlRpc::XmlRpcValue &groups = rosparam_config_["hardware"]["controller_groups"];
+	if (groups.getType() != XmlRpc::XmlRpcValue::TypeArray) {
+		ROS_ERROR_NAMED("mujoco_ros_control", "The 'controller_groups' param must be an array of structs with a 'name' "
+		                                      "and a 'control_period'");
+		return false;
+	}
+
+	for (int i = 0; i < groups.size(); i++) {
+		if (groups[i].getType() != XmlRpc::XmlRpcValue::TypeStruct || !groups[i].hasMember("name") ||
+		    !groups[i].hasMember("control_period")) {
+			ROS_ERROR_STREAM_NAMED("mujoco_ros_control",
+			                       "Controller group " << i << " must be a struct with a 'name' and a 'control_period'");
+			return false;
+		}
+
+		const std::string name = static_cast<std::string>(groups[i]["name"]);
+		if (name.empty()) {
+			ROS_ERROR_STREAM_NAMED("mujoco_ros_control", "Controller group " << i << " has an empty name");
+			return false;
+		}
+		for (const auto &group : controller_groups_) {
+			if (group.name == name) {
+				ROS_ERROR_STREAM_NAMED("mujoco_ros_control", "Controller group '" << name << "' is defined more than once");
+				return false;
+			}
+		}
+
+		ControllerGroup group;
+		group.name           = name;
+		group.control_period = ros::Duration(static_cast<double>(groups[i]["control_period"]));
+		if (group.control_period.toSec() < m->opt.timestep) {
+			ROS_WARN_STREAM_NAMED("mujoco_ros_control", "Desired update period of controller group '"
+			                                                << name << "' (" << group.control_period
+			                                                << " s) is faster than the mujoco simulation timestep ("
+			                                                << m->opt.timestep << " s).");
+		}
+
+		// Controllers of this group are managed via the controller_manager services in <robot_namespace>/<name>
+		group.controller_manager = std::make_unique<controller_manager::ControllerManager>(
+		    robot_hw_sim_.get(), ros::NodeHandle(robot_nh_, name));
+		ROS_INFO_STREAM_NAMED("mujoco_ros_control", "Added controller group '" << name << "' with an update period of "
+		                                                                        << group.control_period << " s");
+		controller_groups_.emplace_back(std::move(group));
+	}
+	return true;
+}
+
 void MujocoRosControlPlugin::reset() {}
 
 std::string MujocoRosControlPlugin::getURDF(const std::string &param_name) const
@@ -201,7 +358,7 @@ std::string MujocoRosControlPlugin::getURDF(const std::string &param_name) const
 	std::string urdf_string;
 
 	// search and wait for robot_description on param server
-	while (urdf_string.empty()) {
+	while (true) {
 		std::string search_param_name;
 		if (robot_nh_.searchParam(param_name, search_param_name)) {
 			ROS_INFO_ONCE_NAMED("mujoco_ros_control",
@@ -219,6 +376,9 @@ std::string MujocoRosControlPlugin::getURDF(const std::string &param_name) const
 			robot_nh_.getParam(param_name, urdf_string);
 		}
 
+		if (!urdf_string.empty()) {
+			break;
+		}
 		std::this_thread::sleep_for(std::chrono::microseconds(100000));
 	}
 	ROS_DEBUG_STREAM_NAMED("mujoco_ros_control", "Recieved urdf from param server, parsing...");